@@ -0,0 +1,941 @@
+/*
+*
+ *  Benchmarks.cpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+// Benchmarks of all priority queue backends on the same workloads.
+// Elements are ints equal to their priorities, so every backend is driven through the common
+// PriorityQueue<T> interface, and hold model inserts can depend on the popped element.
+//
+// Every benchmark reports:
+//   time/op     - time of one Insert or Pop
+//   allocs/op   - heap allocations per Insert or Pop
+//   peak_rss_MB - peak resident memory of the process so far
+// Peak RSS only grows, so compare it between separate runs filtered to one benchmark.
+//
+// Tree backends (BST, AVL, 23Tree) also report the shape of the tree after inserting the input:
+//   max_depth, avg_depth - levels of the tree and mean depth of its elements
+// Built with TREE_STATS (LAB1_TREE_STATS in CMake) the trees count their operations, reported as
+//   comparisons/op, rotations/op, splits/op, merges/op, node_allocs/op
+// The trees hold one element per distinct priority, so the narrow range gives small trees.
+// LazyBST, LazyAVL and Lazy23Tree keep the emptied priorities in the tree until the compaction:
+// they gain on the retry workload, which inserts the popped priorities back, and pay for
+// the tombstones on the workloads that don't.
+//
+// Snapshot benchmarks compare the persistent AVL tree with copying the mutable one:
+// the writer replaces the maximum element, taking a snapshot every <interval> changes.
+//   time/snapshot  - time of the changes and the snapshot
+//   bytes/snapshot - memory allocated per snapshot, for the persistent tree it is the copied paths
+//   held_KB        - memory the held snapshots keep alive besides the current tree
+//
+// Resharding benchmarks compare Split/Join/Union of the AVL and 2-3 trees with draining the trees
+// in order and bulk appending the elements to the new ones (Rebuild):
+//   reshard/<Tree>/<Path>/<elements>       - split the tree at a random key and join the parts back
+//   union/<Tree>/<Path>/<elements>/<other> - unite trees of random elements of the given sizes
+//
+// Parallel benchmarks run the bulk build and the set operations of the AVL tree on the task pool:
+//   parallel/<operation>/AVL/<elements>/<threads> - time of one operation, real time
+//   speedup - time of the sequential operation divided by the time on the threads
+// Speedup is bounded by the cores of the machine, run on as many cores as the largest threads value.
+//
+// Concurrent benchmarks run Insert+Pop pairs from every thread on the shared MultiQueue:
+//   concurrent/MultiQueue/<elements>/real_time/threads:<n> - the queue holds about N elements
+//   items_per_second - Insert and Pop calls of all threads, shows the scaling with the threads
+//
+// Top-K benchmarks keep the K highest of N random priorities:
+//   topk/<TopK or Heap>/<elements>/<k> - TopK is bounded by K, Heap holds all N and pops K
+//   time/element - time of one Insert, the pops included
+//
+// Restore benchmarks bring back the queue of N random priorities after a restart:
+//   restore/<Backend>/Reinsert/<elements>/<range>   - Insert of every element again
+//   restore/<Backend>/Load/<elements>/<range>       - Load of the saved queue, the bulk build of the backend
+//   restore/<Backend>/MappedPeek/<elements>/<range> - mapping of the saved file and Peek, nothing is built
+//   time/element - time per element of the queue, file_MB - size of the saved queue
+//
+// JSON for regression tracking:
+//   Benchmarks --benchmark_out=queues.json --benchmark_out_format=json
+// Benchmark names are <workload>/<Backend>/<elements>/<priorities range>.
+
+
+#include <benchmark/benchmark.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <type_traits>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "ArrayPriorityQueue.hpp"
+#include "LinkedListPriorityQueue.hpp"
+#include "BSTPriorityQueue.hpp"
+#include "AVLPriorityQueue.hpp"
+#include "23TreePriorityQueue.hpp"
+#include "HeapPriorityQueue.hpp"
+#include "PairingHeapPriorityQueue.hpp"
+#include "MultiQueuePriorityQueue.hpp"
+#include "BTreePriorityQueue.hpp"
+#include "RBPriorityQueue.hpp"
+#include "BucketPriorityQueue.hpp"
+#include "RadixHeapPriorityQueue.hpp"
+#include "PersistentAVLPriorityQueue.hpp"
+#include "VEBPriorityQueue.hpp"
+#include "SortedVectorPriorityQueue.hpp"
+#include "TopKPriorityQueue.hpp"
+#include "MappedQueueSnapshot.hpp"
+#include "tree_stats.h"
+
+
+// Global allocations counters. Every replaceable operator new form is replaced: the plain,
+// array, nothrow and aligned ones, so the alignas(64) heaps of the MultiQueue are counted too.
+// The replacements are kept out of line: GCC pairs the inlined free with the new expression
+// of the caller and warns about mismatched deallocation otherwise
+static std::atomic<size_t> allocations{ 0 };
+static std::atomic<size_t> allocated_bytes{ 0 };
+
+#if defined(_MSC_VER)
+#define ALLOCATOR_NOINLINE __declspec(noinline)
+#else
+#define ALLOCATOR_NOINLINE __attribute__((noinline))
+#endif
+
+/// @return Counted memory block, nullptr when there is no memory
+static void* CountedAlloc(size_t size, size_t alignment = 0) noexcept
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	size = size ? size : 1;
+	if (!alignment)
+		return std::malloc(size);
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc takes only the sizes multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void CountedFree(void* ptr, bool aligned = false) noexcept
+{
+#ifdef _WIN32
+	if (aligned) {
+		_aligned_free(ptr);
+		return;
+	}
+#endif
+	(void)aligned;
+	std::free(ptr);
+}
+
+static void* CountedNew(size_t size, size_t alignment = 0)
+{
+	if (void* ptr = CountedAlloc(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+ALLOCATOR_NOINLINE void* operator new(size_t size) { return CountedNew(size); }
+ALLOCATOR_NOINLINE void* operator new[](size_t size) { return CountedNew(size); }
+ALLOCATOR_NOINLINE void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+ALLOCATOR_NOINLINE void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+
+ALLOCATOR_NOINLINE void* operator new(size_t size, std::align_val_t alignment) { return CountedNew(size, size_t(alignment)); }
+ALLOCATOR_NOINLINE void* operator new[](size_t size, std::align_val_t alignment) { return CountedNew(size, size_t(alignment)); }
+ALLOCATOR_NOINLINE void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size, size_t(alignment));
+}
+ALLOCATOR_NOINLINE void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAlloc(size, size_t(alignment));
+}
+
+ALLOCATOR_NOINLINE void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+ALLOCATOR_NOINLINE void operator delete(void* ptr, size_t) noexcept { CountedFree(ptr); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr, size_t) noexcept { CountedFree(ptr); }
+ALLOCATOR_NOINLINE void operator delete(void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+
+ALLOCATOR_NOINLINE void operator delete(void* ptr, std::align_val_t) noexcept { CountedFree(ptr, true); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr, std::align_val_t) noexcept { CountedFree(ptr, true); }
+ALLOCATOR_NOINLINE void operator delete(void* ptr, size_t, std::align_val_t) noexcept { CountedFree(ptr, true); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { CountedFree(ptr, true); }
+ALLOCATOR_NOINLINE void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(ptr, true); }
+ALLOCATOR_NOINLINE void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { CountedFree(ptr, true); }
+
+
+/// @return Peak resident set size of the process in megabytes
+static double PeakRssMB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+
+/// @brief True for the queues with the tree instrumentation
+template<typename Queue, typename = void>
+struct HasStats : std::false_type {};
+
+template<typename Queue>
+struct HasStats<Queue, decltype(void(std::declval<const Queue&>().Stats()))> : std::true_type {};
+
+template<typename Queue>
+static TreeStats StatsOf(const Queue& queue, std::true_type) { return queue.Stats(); }
+
+template<typename Queue>
+static TreeStats StatsOf(const Queue&, std::false_type) { return TreeStats(); }
+
+template<typename Queue>
+static TreeStats StatsOf(const Queue& queue) { return StatsOf(queue, HasStats<Queue>()); }
+
+/// @brief Adds the operation counters made between the snapshots to the total
+static void AddCounters(TreeStats& total, const TreeStats& before, const TreeStats& after)
+{
+	total.comparisons += after.comparisons - before.comparisons;
+	total.rotations += after.rotations - before.rotations;
+	total.splits += after.splits - before.splits;
+	total.merges += after.merges - before.merges;
+	total.allocations += after.allocations - before.allocations;
+}
+
+
+enum Workload
+{
+	kRandom,      // Insert N random priorities, pop all
+	kAscending,   // Insert N ascending priorities, pop all
+	kDescending,  // Insert N descending priorities, pop all
+	kHold,        // On N elements: pop the top and insert a lower priority, N times
+	kBursty,      // Random bursts of inserts and pops, then pop the rest
+	kRetry        // On N elements: pop a batch of the top ones and insert them back, N times
+};
+
+// Elements popped and inserted back at once by the retry workload
+static constexpr size_t kRetryBatch = 16;
+
+/// @brief Random input of the workload, generated before the timing starts.
+/// The seed is fixed, so all backends and all runs get the same input
+struct WorkloadInput
+{
+	std::vector<int> priorities;
+	// Decrements of the hold model, burst lengths of the bursty workload
+	std::vector<int> steps;
+
+	WorkloadInput(Workload workload, size_t count, int range)
+	{
+		std::mt19937 mersenne(42);
+		priorities.resize(count);
+
+		switch (workload)
+		{
+		case kAscending:
+			for (size_t i = 0; i < count; i++)
+				priorities[i] = int(i * uint64_t(range) / count);
+			break;
+		case kDescending:
+			for (size_t i = 0; i < count; i++)
+				priorities[i] = int((count - 1 - i) * uint64_t(range) / count);
+			break;
+		default:
+			for (int& priority : priorities)
+				priority = mersenne() % range;
+			break;
+		}
+
+		if (workload == kHold) {
+			steps.resize(count);
+			for (int& step : steps)
+				step = mersenne() % std::max(range / 16, 1);
+		}
+		else if (workload == kBursty) {
+			for (size_t inserted = 0; inserted < count; ) {
+				int burst = 1 + mersenne() % 128;
+				steps.push_back(burst);
+				inserted += burst;
+			}
+		}
+	}
+};
+
+/// @brief Runs the workload on the empty queue
+/// @return Number of Insert and Pop calls
+template<typename Queue>
+static size_t RunWorkload(Queue& queue, Workload workload, const WorkloadInput& input)
+{
+	const std::vector<int>& priorities = input.priorities;
+	size_t size = 0, ops = 0;
+
+	switch (workload)
+	{
+	case kHold:
+		// The queue is filled before the timing, see QueueBenchmark
+		for (int step : input.steps) {
+			int popped = queue.Pop();
+			// Inserted priority is not above the popped one, so the radix heap takes it
+			int priority = std::max(popped - step, 0);
+			queue.Insert(priority, priority);
+		}
+		return 2 * input.steps.size();
+	case kRetry:
+	{
+		// The queue is filled before the timing, as for the hold model
+		int batch[kRetryBatch];
+		for (; ops < 2 * priorities.size(); ops += 2 * kRetryBatch) {
+			for (int& popped : batch)
+				popped = queue.Pop();
+			for (int popped : batch)
+				queue.Insert(popped, popped);
+		}
+		return ops;
+	}
+	case kBursty:
+	{
+		size_t next = 0;
+		for (size_t burst = 0; burst < input.steps.size(); burst++) {
+			int length = input.steps[burst];
+			if (burst % 2 == 0) {
+				for (int i = 0; i < length && next < priorities.size(); i++, next++, size++, ops++)
+					queue.Insert(priorities[next], priorities[next]);
+			}
+			else {
+				for (int i = 0; i < length && size > 0; i++, size--, ops++)
+					benchmark::DoNotOptimize(queue.Pop());
+			}
+		}
+		for (; next < priorities.size(); next++, size++, ops++)
+			queue.Insert(priorities[next], priorities[next]);
+		break;
+	}
+	default:
+		for (int priority : priorities)
+			queue.Insert(priority, priority);
+		size = ops = priorities.size();
+		break;
+	}
+
+	for (; size > 0; size--, ops++)
+		benchmark::DoNotOptimize(queue.Pop());
+	return ops;
+}
+
+/// @brief Benchmark of the queue backend on the workload.
+/// Arguments are the number of elements and the range of priorities [0, range)
+template<typename Queue>
+static void QueueBenchmark(benchmark::State& state, Workload workload)
+{
+	const size_t count = size_t(state.range(0));
+	const WorkloadInput input(workload, count, int(state.range(1)));
+
+	size_t ops = 0;
+	size_t allocated = 0;
+	TreeStats counted;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		Queue* queue = new Queue();
+		if (workload == kHold || workload == kRetry) {
+			for (int priority : input.priorities)
+				queue->Insert(priority, priority);
+		}
+		TreeStats stats_before = StatsOf(*queue);
+		size_t allocated_before = allocations.load(std::memory_order_relaxed);
+		state.ResumeTiming();
+
+		ops += RunWorkload(*queue, workload, input);
+
+		state.PauseTiming();
+		allocated += allocations.load(std::memory_order_relaxed) - allocated_before;
+		AddCounters(counted, stats_before, StatsOf(*queue));
+		delete queue;
+		state.ResumeTiming();
+	}
+
+	state.counters["time/op"] = benchmark::Counter(double(ops), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["allocs/op"] = double(allocated) / double(std::max<size_t>(ops, 1));
+	state.counters["peak_rss_MB"] = PeakRssMB();
+
+	if (HasStats<Queue>::value) {
+#ifdef TREE_STATS
+		const double per_op = 1.0 / double(std::max<size_t>(ops, 1));
+		state.counters["comparisons/op"] = double(counted.comparisons) * per_op;
+		state.counters["rotations/op"] = double(counted.rotations) * per_op;
+		state.counters["splits/op"] = double(counted.splits) * per_op;
+		state.counters["merges/op"] = double(counted.merges) * per_op;
+		state.counters["node_allocs/op"] = double(counted.allocations) * per_op;
+#endif
+		// Shape of the tree holding the whole input
+		Queue queue;
+		for (int priority : input.priorities)
+			queue.Insert(priority, priority);
+		TreeStats shape = StatsOf(queue);
+		state.counters["max_depth"] = double(shape.max_depth);
+		state.counters["avg_depth"] = shape.average_depth;
+	}
+}
+
+
+/// @brief Snapshots of the mutable AVL tree: all elements are copied to a vector
+struct CopiedSnapshots
+{
+	using Tree = AVLTree<int>;
+	using Snapshot = std::vector<int>;
+
+	static Snapshot Take(const Tree& tree)
+	{
+		return Snapshot(tree.begin(), tree.end());
+	}
+
+	static size_t HeldBytes(const Tree&, const std::vector<Snapshot>& held)
+	{
+		size_t bytes = 0;
+		for (const Snapshot& snapshot : held)
+			bytes += snapshot.capacity() * sizeof(int);
+		return bytes;
+	}
+};
+
+/// @brief Snapshots of the persistent AVL tree, they share the nodes with the tree
+struct PersistentSnapshots
+{
+	using Tree = PersistentAVLTree<int>;
+	using Snapshot = PersistentAVLTree<int>;
+
+	static Snapshot Take(const Tree& tree) { return tree.Snapshot(); }
+
+	/// @brief Nodes of the snapshots the tree doesn't share, times the allocation of one node
+	static size_t HeldBytes(const Tree& tree, const std::vector<Snapshot>& held)
+	{
+		std::vector<const Tree*> versions = { &tree };
+		for (const Snapshot& snapshot : held)
+			versions.push_back(&snapshot);
+		size_t nodes = Tree::CountNodes(versions) - Tree::CountNodes({ &tree });
+
+		size_t bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+		Tree probe;
+		probe.append(0);
+		return nodes * (allocated_bytes.load(std::memory_order_relaxed) - bytes_before);
+	}
+};
+
+/// @brief Writer keeps replacing the maximum element of the tree and takes a snapshot
+/// every interval changes. Readers hold the last kHeld snapshots.
+/// Arguments are the number of elements and the interval
+template<typename Snapshots>
+static void SnapshotBenchmark(benchmark::State& state)
+{
+	constexpr size_t kHeld = 4;
+	const size_t count = size_t(state.range(0));
+	const size_t interval = size_t(state.range(1));
+
+	std::mt19937 mersenne(42);
+	typename Snapshots::Tree tree;
+	while (tree.Size() < count)
+		tree.append(int(mersenne() % (1 << 30)));
+
+	std::vector<typename Snapshots::Snapshot> held(kHeld);
+	size_t taken = 0;
+	size_t bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+
+	for (auto _ : state) {
+		for (size_t i = 0; i < interval; i++) {
+			int max = tree.PopMax();
+			int value;
+			do
+				value = int(mersenne() % (1 << 30));
+			while (tree.GetElem(value) || value == max);
+			tree.append(value);
+		}
+		held[taken++ % kHeld] = Snapshots::Take(tree);
+	}
+
+	size_t bytes = allocated_bytes.load(std::memory_order_relaxed) - bytes_before;
+	state.counters["time/snapshot"] = benchmark::Counter(double(taken), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["bytes/snapshot"] = double(bytes) / double(std::max<size_t>(taken, 1));
+	state.counters["held_KB"] = Snapshots::HeldBytes(tree, held) / 1024.0;
+	state.counters["peak_rss_MB"] = PeakRssMB();
+}
+
+/// @brief Registers the snapshot benchmark of the tree
+template<typename Snapshots>
+static void RegisterSnapshots(const std::string& name)
+{
+	auto* bm = benchmark::RegisterBenchmark(("snapshot/" + name).c_str(), SnapshotBenchmark<Snapshots>);
+	bm->ArgNames({ "elements", "interval" })->Unit(benchmark::kMicrosecond);
+	for (int64_t elems = 1000; elems <= 1000000; elems *= 10) {
+		bm->Args({ elems, 16 });
+		bm->Args({ elems, 1024 });
+	}
+}
+
+/// @brief Moves elements between the trees with Split, Join and Union, O(log N) per split or join
+struct JoinPath
+{
+	template<typename Tree>
+	static void Reshard(Tree& tree, int key)
+	{
+		auto parts = tree.Split(key);
+		tree = Tree::Join(std::move(parts.first), std::move(parts.second));
+	}
+
+	template<typename Tree>
+	static Tree Unite(Tree first, Tree second)
+	{
+		return Tree::Union(std::move(first), std::move(second));
+	}
+};
+
+/// @brief Moves elements by draining the trees in order and bulk appending them to the new ones, O(N)
+struct RebuildPath
+{
+	template<typename Tree>
+	static void Reshard(Tree& tree, int key)
+	{
+		Tree left, right;
+		left.AppendRange(std::vector<int>(tree.begin(), tree.lower_bound(key)));
+		right.AppendRange(std::vector<int>(tree.lower_bound(key), tree.end()));
+		tree.clear();
+
+		std::vector<int> elements(left.begin(), left.end());
+		elements.insert(elements.end(), right.begin(), right.end());
+		tree.AppendRange(std::move(elements));
+	}
+
+	template<typename Tree>
+	static Tree Unite(Tree first, Tree second)
+	{
+		std::vector<int> elements(first.begin(), first.end());
+		elements.insert(elements.end(), second.begin(), second.end());
+		first.clear();
+		second.clear();
+
+		Tree united;
+		united.AppendRange(std::move(elements));
+		return united;
+	}
+};
+
+/// @brief Splits the tree at a random key and joins the parts back, as moving a range
+/// of priorities to another worker and back does. Argument is the number of elements
+template<typename Tree, typename Path>
+static void ReshardBenchmark(benchmark::State& state)
+{
+	std::mt19937 mersenne(42);
+	std::vector<int> elements(size_t(state.range(0)));
+	for (int& elem : elements)
+		elem = int(mersenne() % (1 << 30));
+	Tree tree;
+	tree.AppendRange(elements);
+
+	for (auto _ : state)
+		Path::Reshard(tree, int(mersenne() % (1 << 30)));
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["peak_rss_MB"] = PeakRssMB();
+}
+
+/// @brief Unites two trees of random elements, the inputs are built before the timing.
+/// Arguments are the sizes of the trees
+template<typename Tree, typename Path>
+static void UnionBenchmark(benchmark::State& state)
+{
+	std::mt19937 mersenne(42);
+	std::vector<int> first_elements(size_t(state.range(0))), second_elements(size_t(state.range(1)));
+	for (int& elem : first_elements)
+		elem = int(mersenne() % (1 << 30));
+	for (int& elem : second_elements)
+		elem = int(mersenne() % (1 << 30));
+
+	Tree united;
+	for (auto _ : state) {
+		state.PauseTiming();
+		united = Tree();
+		Tree first, second;
+		first.AppendRange(first_elements);
+		second.AppendRange(second_elements);
+		state.ResumeTiming();
+
+		united = Path::Unite(std::move(first), std::move(second));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["peak_rss_MB"] = PeakRssMB();
+}
+
+/// @brief Registers the resharding benchmarks of the tree on the path
+template<typename Tree, typename Path>
+static void RegisterResharding(const std::string& name)
+{
+	auto* reshard = benchmark::RegisterBenchmark(("reshard/" + name).c_str(), ReshardBenchmark<Tree, Path>);
+	reshard->ArgNames({ "elements" })->Unit(benchmark::kMicrosecond);
+	auto* unite = benchmark::RegisterBenchmark(("union/" + name).c_str(), UnionBenchmark<Tree, Path>);
+	unite->ArgNames({ "elements", "other" })->Unit(benchmark::kMicrosecond);
+	for (int64_t elems = 1000; elems <= 1000000; elems *= 10) {
+		reshard->Args({ elems });
+		unite->Args({ elems, elems });
+		unite->Args({ elems, elems / 100 });
+	}
+}
+
+
+enum ParallelOperation
+{
+	kBuild,
+	kUnion,
+	kIntersection,
+	kDifference,
+};
+
+/// @brief Runs the bulk build or the set operation of the AVL trees on the task pool.
+/// The set operations take two trees of random elements, about a half of them are common.
+/// Arguments are the number of elements and the number of threads
+static void ParallelBenchmark(benchmark::State& state, ParallelOperation operation)
+{
+	using Tree = AVLTree<int>;
+	const size_t count = size_t(state.range(0));
+
+	std::mt19937 mersenne(42);
+	std::vector<int> first(count), second(count);
+	for (int& elem : first)
+		elem = int(mersenne() % (count * 2));
+	for (int& elem : second)
+		elem = int(mersenne() % (count * 2));
+
+	TaskPool tasks(size_t(state.range(1)));
+
+	// Runs the operation on the task pool, or sequentially for nullptr
+	// @return Time of the operation in seconds, the inputs are built before it
+	auto run = [&](TaskPool* pool) {
+		std::vector<int> elements;
+		Tree first_tree, second_tree, result;
+		if (operation == kBuild)
+			elements = first;
+		else {
+			first_tree.AppendRange(first, tasks);
+			second_tree.AppendRange(second, tasks);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		switch (operation) {
+		case kBuild:
+			if (pool)
+				result.AppendRange(std::move(elements), *pool);
+			else
+				result.AppendRange(std::move(elements));
+			break;
+		case kUnion:
+			result = pool ? Tree::Union(std::move(first_tree), std::move(second_tree), *pool) :
+				Tree::Union(std::move(first_tree), std::move(second_tree));
+			break;
+		case kIntersection:
+			result = Tree::Intersection(std::move(first_tree), std::move(second_tree), pool);
+			break;
+		case kDifference:
+			result = Tree::Difference(std::move(first_tree), std::move(second_tree), pool);
+			break;
+		}
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	double sequential = run(nullptr);
+	double total = 0;
+	for (auto _ : state) {
+		double seconds = run(&tasks);
+		state.SetIterationTime(seconds);
+		total += seconds;
+	}
+
+	state.counters["speedup"] = sequential * double(state.iterations()) / total;
+	state.counters["peak_rss_MB"] = PeakRssMB();
+}
+
+/// @brief Registers the parallel benchmark on 1, 2, 4... threads up to the hardware threads
+static void RegisterParallel(const std::string& name, ParallelOperation operation, int64_t maxElems)
+{
+	auto* bm = benchmark::RegisterBenchmark(("parallel/" + name + "/AVL").c_str(), ParallelBenchmark, operation);
+	bm->ArgNames({ "elements", "threads" })->Unit(benchmark::kMillisecond)->UseManualTime();
+
+	int64_t max_threads = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+	for (int64_t elems = 1000000; elems <= maxElems; elems *= 10) {
+		for (int64_t threads = 1; threads < max_threads; threads *= 2)
+			bm->Args({ elems, threads });
+		bm->Args({ elems, max_threads });
+	}
+}
+
+
+/// @brief Insert+Pop pairs on the MultiQueue shared by all threads. Argument is the number of elements
+/// inserted before the timing, the queue keeps about that many
+static void ConcurrentBenchmark(benchmark::State& state)
+{
+	static MultiQueuePriorityQueue<int>* queue = nullptr;
+
+	// The first thread prepares the queue, the others wait for it at the start of the loop
+	if (state.thread_index() == 0) {
+		const WorkloadInput input(kRandom, size_t(state.range(0)), 1024);
+		queue = new MultiQueuePriorityQueue<int>();
+		for (int priority : input.priorities)
+			queue->Insert(priority, priority);
+	}
+
+	std::mt19937 mersenne(unsigned(state.thread_index()));
+	for (auto _ : state) {
+		int priority = int(mersenne() % 1024);
+		queue->Insert(priority, priority);
+		try {
+			benchmark::DoNotOptimize(queue->Pop());
+		}
+		catch (std::underflow_error&) {}
+	}
+	state.SetItemsProcessed(state.iterations() * 2);
+
+	if (state.thread_index() == 0) {
+		delete queue;
+		queue = nullptr;
+	}
+}
+
+static void RegisterConcurrent()
+{
+	auto* bm = benchmark::RegisterBenchmark("concurrent/MultiQueue", ConcurrentBenchmark);
+	bm->ArgNames({ "elements" })->UseRealTime()
+		->ThreadRange(1, std::max<int>(std::thread::hardware_concurrency(), 1));
+	for (int64_t elems = 1000; elems <= 1000000; elems *= 10)
+		bm->Arg(elems);
+}
+
+
+/// @brief Keeps the K highest of N random priorities and pops them. The bounded TopK queue
+/// drops the rest on Insert, the unbounded Heap holds all of them. Arguments are N and K
+static void TopKBenchmark(benchmark::State& state, bool bounded)
+{
+	const size_t count = size_t(state.range(0));
+	const size_t k = size_t(state.range(1));
+	const WorkloadInput input(kRandom, count, 1 << 30);
+
+	std::vector<int> top;
+	for (auto _ : state) {
+		std::unique_ptr<PriorityQueue<int>> queue;
+		if (bounded)
+			queue.reset(new TopKPriorityQueue<int>(k));
+		else
+			queue.reset(new HeapPriorityQueue<int>());
+
+		for (int priority : input.priorities)
+			queue->Insert(priority, priority);
+		top.clear();
+		queue->PopN(k, top);
+		benchmark::DoNotOptimize(top.data());
+	}
+
+	state.counters["time/element"] = benchmark::Counter(double(count) * double(state.iterations()),
+		benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["peak_rss_MB"] = PeakRssMB();
+}
+
+static void RegisterTopK()
+{
+	auto* bounded = benchmark::RegisterBenchmark("topk/TopK", TopKBenchmark, true);
+	auto* unbounded = benchmark::RegisterBenchmark("topk/Heap", TopKBenchmark, false);
+	for (auto* bm : { bounded, unbounded }) {
+		bm->ArgNames({ "elements", "k" })->Unit(benchmark::kMillisecond);
+		for (int64_t elems = 100000; elems <= 10000000; elems *= 10) {
+			bm->Args({ elems, 10 });
+			bm->Args({ elems, 1000 });
+		}
+	}
+}
+
+
+enum RestorePath { kReinsert, kLoad, kMappedPeek };
+
+static const char* const kRestorePathNames[] = { "Reinsert", "Load", "MappedPeek" };
+
+/// @brief Brings back the queue of random priorities: inserts the elements again,
+/// loads the saved queue or maps the saved file and peeks it. Arguments are N and the priorities range
+template<typename Queue>
+static void RestoreBenchmark(benchmark::State& state, RestorePath path)
+{
+	const size_t count = size_t(state.range(0));
+	const WorkloadInput input(kRandom, count, int(state.range(1)));
+	const std::string file = "restore_benchmark.bin";
+
+	std::string saved;
+	{
+		Queue queue;
+		for (int priority : input.priorities)
+			queue.Insert(priority, priority);
+		std::ostringstream out;
+		queue.Save(out);
+		saved = out.str();
+	}
+	if (path == kMappedPeek) {
+		std::ofstream out(file, std::ios::binary);
+		out.write(saved.data(), std::streamsize(saved.size()));
+	}
+
+	for (auto _ : state) {
+		switch (path)
+		{
+		case kReinsert:
+		{
+			Queue queue;
+			for (int priority : input.priorities)
+				queue.Insert(priority, priority);
+			benchmark::DoNotOptimize(queue.Peek());
+			break;
+		}
+		case kLoad:
+		{
+			Queue queue;
+			std::istringstream in(saved);
+			queue.Load(in);
+			benchmark::DoNotOptimize(queue.Peek());
+			break;
+		}
+		case kMappedPeek:
+		{
+			MappedQueueSnapshot<int> snapshot(file);
+			benchmark::DoNotOptimize(snapshot.Peek());
+			break;
+		}
+		}
+	}
+	if (path == kMappedPeek)
+		std::remove(file.c_str());
+
+	state.counters["time/element"] = benchmark::Counter(double(count) * double(state.iterations()),
+		benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["file_MB"] = double(saved.size()) / (1024 * 1024);
+}
+
+/// @brief Registers the restore benchmarks of the backend
+template<typename Queue>
+static void RegisterRestore(const std::string& name)
+{
+	for (int path = kReinsert; path <= kMappedPeek; path++) {
+		auto* bm = benchmark::RegisterBenchmark(("restore/" + name + "/" + kRestorePathNames[path]).c_str(),
+			RestoreBenchmark<Queue>, RestorePath(path));
+		bm->ArgNames({ "elements", "range" })->Unit(benchmark::kMillisecond);
+		for (int64_t elems = 100000; elems <= 1000000; elems *= 10) {
+			bm->Args({ elems, 1024 });
+			bm->Args({ elems, 1 << 30 });
+		}
+	}
+}
+
+
+static const char* const kWorkloadNames[] = { "random", "ascending", "descending", "hold", "bursty", "retry" };
+
+/// @brief Tree queue with the lazy deletion of the emptied buckets
+template<typename Queue>
+struct LazyQueue
+	: public Queue
+{
+	LazyQueue() { this->SetLazyDeletion(true); }
+};
+
+/// @brief Registers the backend on the workloads
+/// @param name Backend name for the benchmark names
+/// @param maxElems Largest number of elements, lower for the backends with O(N) operations
+/// @param wideRange Whether the backend takes priorities above 1023
+/// @param monotoneOnly Whether the backend takes only workloads that don't insert above the popped priority
+template<typename Queue>
+static void RegisterBackend(const std::string& name, int64_t maxElems, bool wideRange = true, bool monotoneOnly = false)
+{
+	for (int workload = kRandom; workload <= kRetry; workload++) {
+		if (monotoneOnly && (workload == kBursty || workload == kRetry))
+			continue;
+
+		auto* bm = benchmark::RegisterBenchmark((kWorkloadNames[workload] + ("/" + name)).c_str(),
+			QueueBenchmark<Queue>, Workload(workload));
+		bm->ArgNames({ "elements", "range" })->Unit(benchmark::kMicrosecond);
+		for (int64_t elems = 1000; elems <= maxElems; elems *= 10) {
+			bm->Args({ elems, 1024 });
+			if (wideRange)
+				bm->Args({ elems, 1 << 30 });
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	// Array and linked list have O(N) Pop or Insert, BST degenerates on the sorted workloads
+	RegisterBackend<ArrayPriorityQueue<int>>("Array", 10000);
+	RegisterBackend<LinkedListPriorityQueue<int>>("LinkedList", 10000);
+	RegisterBackend<SortedVectorPriorityQueue<int>>("SortedVector", 1000000);
+	RegisterBackend<BSTPriorityQueue<int>>("BST", 10000);
+	RegisterBackend<AVLPriorityQueue<int>>("AVL", 1000000);
+	RegisterBackend<LazyQueue<BSTPriorityQueue<int>>>("LazyBST", 10000);
+	RegisterBackend<LazyQueue<AVLPriorityQueue<int>>>("LazyAVL", 1000000);
+	RegisterBackend<LazyQueue<B23TreePriorityQueue<int>>>("Lazy23Tree", 1000000);
+	RegisterBackend<RBPriorityQueue<int>>("RB", 1000000);
+	RegisterBackend<B23TreePriorityQueue<int>>("23Tree", 1000000);
+	RegisterBackend<BTreePriorityQueue<int>>("BTree", 1000000);
+	RegisterBackend<HeapPriorityQueue<int>>("Heap", 1000000);
+	RegisterBackend<HeapPriorityQueue<int, 4>>("Heap4", 1000000);
+	RegisterBackend<PairingHeapPriorityQueue<int>>("PairingHeap", 1000000);
+	RegisterBackend<MultiQueuePriorityQueue<int>>("MultiQueue", 1000000);
+	RegisterBackend<BucketPriorityQueue<int>>("Bucket", 1000000, false);
+	RegisterBackend<RadixHeapPriorityQueue<int>>("RadixHeap", 1000000, true, true);
+	RegisterBackend<PersistentAVLPriorityQueue<int>>("PersistentAVL", 1000000);
+	RegisterBackend<VEBPriorityQueue<int>>("vEB", 1000000);
+
+	RegisterSnapshots<CopiedSnapshots>("CopiedAVL");
+	RegisterSnapshots<PersistentSnapshots>("PersistentAVL");
+
+	RegisterResharding<AVLTree<int>, JoinPath>("AVL/Join");
+	RegisterResharding<AVLTree<int>, RebuildPath>("AVL/Rebuild");
+	RegisterResharding<B23Tree<int>, JoinPath>("23Tree/Join");
+	RegisterResharding<B23Tree<int>, RebuildPath>("23Tree/Rebuild");
+
+	RegisterParallel("build", kBuild, 10000000);
+	RegisterParallel("union", kUnion, 1000000);
+	RegisterParallel("intersection", kIntersection, 1000000);
+	RegisterParallel("difference", kDifference, 1000000);
+
+	RegisterConcurrent();
+
+	RegisterTopK();
+
+	RegisterRestore<AVLPriorityQueue<int>>("AVL");
+	RegisterRestore<HeapPriorityQueue<int>>("Heap");
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+}
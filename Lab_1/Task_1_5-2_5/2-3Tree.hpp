@@ -1,7 +1,21 @@
 ﻿#pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <random>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <stdexcept>
+
+#include "NodePool.hpp"
+#include "TreeRange.hpp"
+#include "tree_stats.h"
 
 // For private methods unit testing
 #ifdef _DEBUG
@@ -20,119 +34,147 @@ struct TreeNode {
 
 
     TreeNode(T data1, TreeNode* parent = nullptr) {
-        this->data[0] = data1;
+        this->data[0] = std::move(data1);
         this->size = 1;
         children[0] = children[1] = children[2] = nullptr;
         this->parent = parent;
     }
 
     TreeNode(T data1, T data2, TreeNode* parent = nullptr) {
-        this->data[0] = data1;
-        this->data[1] = data2;
+        this->data[0] = std::move(data1);
+        this->data[1] = std::move(data2);
         this->size = 2;
         children[0] = children[1] = children[2] = nullptr;
         this->parent = parent;
     }
 
-    TreeNode(T data1, T data2, T data3, TreeNode* parent = nullptr) {
+    /// @brief Compares the elements, counted in the allocator when TREE_STATS is defined
+    template<typename Pool>
+    static bool less(Pool& pool, const T& left, const T& right) {
+        TREE_STATS_COUNT(pool, comparisons);
+        return left < right;
+    }
+
+    template<typename Pool>
+    static bool equal(Pool& pool, const T& left, const T& right) {
+        TREE_STATS_COUNT(pool, comparisons);
+        return left == right;
+    }
+
+    /// @brief Creates 2-node with both children as 2-nodes
+    /// @param pool Allocator of the tree nodes
+    /// @return "4-node" with data2 in the root
+    template<typename Pool>
+    static TreeNode* split(Pool& pool, T data1, T data2, T data3) {
         //assert(data1 <= data2);
         //assert(data2 <= data3);
+        TREE_STATS_COUNT(pool, splits);
 
-        this->data[0] = data2;
-        this->size = 1;
-        this->children[0] = new TreeNode(data1, this);
-        this->children[1] = new TreeNode(data3, this);
-        this->children[2] = nullptr;
-
-        this->parent = parent;
+        TreeNode* node = pool.Create(std::move(data2));
+        node->children[0] = pool.Create(std::move(data1), node);
+        node->children[1] = pool.Create(std::move(data3), node);
+        return node;
     }
 
-    void add_single_data(T data) {
+    template<typename Pool>
+    void add_single_data(T& data, Pool& pool) {
         assert(size == 1);
-        if (data > this->data[0]) {
-            this->data[1] = data;
+        if (less(pool, this->data[0], data)) {
+            this->data[1] = std::move(data);
             size = 2;
         }
         else {
-            this->data[1] = this->data[0];
-            this->data[0] = data;
+            this->data[1] = std::move(this->data[0]);
+            this->data[0] = std::move(data);
             size = 2;
         }
     }
 
     /// @brief Adds element to the TreeNode
-    /// @param new_data Value to insert
+    /// @param new_data Value to insert, it is moved into the tree
+    /// @param pool Allocator of the tree nodes
     /// @return Nullptr if added, else "4-node" (2-node with both children as 2-nodes)
-    TreeNode* add_and_split(T new_data) {
+    template<typename Pool>
+    TreeNode* add_and_split(T& new_data, Pool& pool) {
         if (children[0] == nullptr) {
             if (size == 1) {
-                add_single_data(new_data);
+                add_single_data(new_data, pool);
                 return nullptr;
             }
             else {
-                if (new_data < data[0]) {
-                    return new TreeNode(new_data, data[0], data[1]);
+                if (less(pool, new_data, data[0])) {
+                    return split(pool, std::move(new_data), std::move(data[0]), std::move(data[1]));
                 }
-                else if (new_data < data[1]) {
-                    return new TreeNode(data[0], new_data, data[1]);
+                else if (less(pool, new_data, data[1])) {
+                    return split(pool, std::move(data[0]), std::move(new_data), std::move(data[1]));
                 }
                 else {
-                    return new TreeNode(data[0], data[1], new_data);
+                    return split(pool, std::move(data[0]), std::move(data[1]), std::move(new_data));
                 }
             }
         }
         TreeNode* extra = nullptr;
         if (size == 1) {
-            if (new_data < data[0]) {
-                extra = children[0]->add_and_split(new_data);
+            if (less(pool, new_data, data[0])) {
+                extra = children[0]->add_and_split(new_data, pool);
                 if (!extra) { return nullptr; }
-                data[1] = data[0];
-                data[0] = extra->data[0];
+                pool.Destroy(children[0]); // the child is split into extra
+                data[1] = std::move(data[0]);
+                data[0] = std::move(extra->data[0]);
                 children[2] = children[1];
                 children[0] = extra->children[0];
                 children[1] = extra->children[1];
                 size = 2;
+                pool.Destroy(extra);
                 return nullptr;
             }
             else {
-                extra = children[1]->add_and_split(new_data);
+                extra = children[1]->add_and_split(new_data, pool);
                 if (!extra) { return nullptr; }
-                data[1] = extra->data[0];
+                pool.Destroy(children[1]); // the child is split into extra
+                data[1] = std::move(extra->data[0]);
                 children[1] = extra->children[0];
                 children[2] = extra->children[1];
                 size = 2;
+                pool.Destroy(extra);
                 return nullptr;
             }
         }
         else {
-            if (new_data < data[0]) {
-                extra = children[0]->add_and_split(new_data);
+            if (less(pool, new_data, data[0])) {
+                extra = children[0]->add_and_split(new_data, pool);
                 if (!extra) { return nullptr; }
-                TreeNode* result = new TreeNode(extra->data[0], data[0], data[1]);
+                pool.Destroy(children[0]); // the child is split into extra
+                TreeNode* result = split(pool, std::move(extra->data[0]), std::move(data[0]), std::move(data[1]));
                 result->children[0]->children[0] = extra->children[0];
                 result->children[0]->children[1] = extra->children[1];
                 result->children[1]->children[0] = children[1];
                 result->children[1]->children[1] = children[2];
+                pool.Destroy(extra);
                 return result;
             }
-            else if (new_data < data[1]) {
-                extra = children[1]->add_and_split(new_data);
+            else if (less(pool, new_data, data[1])) {
+                extra = children[1]->add_and_split(new_data, pool);
                 if (!extra) { return nullptr; }
-                TreeNode* result = new TreeNode(data[0], extra->data[0], data[1]);
+                pool.Destroy(children[1]); // the child is split into extra
+                TreeNode* result = split(pool, std::move(data[0]), std::move(extra->data[0]), std::move(data[1]));
                 result->children[0]->children[0] = children[0];
                 result->children[0]->children[1] = extra->children[0];
                 result->children[1]->children[0] = extra->children[1];
                 result->children[1]->children[1] = children[2];
+                pool.Destroy(extra);
                 return result;
             }
             else {
-                extra = children[2]->add_and_split(new_data);
+                extra = children[2]->add_and_split(new_data, pool);
                 if (!extra) { return nullptr; }
-                TreeNode* result = new TreeNode(data[0], data[1], extra->data[0]);
+                pool.Destroy(children[2]); // the child is split into extra
+                TreeNode* result = split(pool, std::move(data[0]), std::move(data[1]), std::move(extra->data[0]));
                 result->children[0]->children[0] = children[0];
                 result->children[0]->children[1] = children[1];
                 result->children[1]->children[0] = extra->children[0];
                 result->children[1]->children[1] = extra->children[1];
+                pool.Destroy(extra);
                 return result;
             }
         }
@@ -153,7 +195,7 @@ struct TreeNode {
         return this; // no children
     }
 
-    T get_max_data() const
+    const T& get_max_data() const
     {
         if (size == 2) {
             return data[1];
@@ -166,8 +208,10 @@ struct TreeNode {
 
     /// @brief Reabalance subtree
     /// @param index_current_child 
+    /// @param pool Allocator of the tree nodes
     /// @return True if rebalance complete - no need to rebalance parent
-    bool rebalance(int index_current_child) {
+    template<typename Pool>
+    bool rebalance(int index_current_child, Pool& pool) {
         assert(index_current_child < size + 1);
         TreeNode* current_child = children[index_current_child];
         assert(current_child);
@@ -180,11 +224,13 @@ struct TreeNode {
         assert(left_child != nullptr || right_child != nullptr);
 
         if (left_child && left_child->size == 2) {
-            current_child->data[0] = this->data[index_current_child - 1];
-            this->data[index_current_child - 1] = left_child->data[1];
+            TREE_STATS_COUNT(pool, rotations);
+            current_child->data[0] = std::move(this->data[index_current_child - 1]);
+            this->data[index_current_child - 1] = std::move(left_child->data[1]);
 
             current_child->children[1] = current_child->children[0];
             current_child->children[0] = left_child->children[2];
+            left_child->children[2] = nullptr;
 
             current_child->size = 1;
             left_child->size = 1;
@@ -192,9 +238,10 @@ struct TreeNode {
         }
 
         if (right_child && right_child->size == 2) {
-            current_child->data[0] = this->data[index_current_child + 1];
-            this->data[index_current_child + 1] = right_child->data[0];
-            right_child->data[0] = right_child->data[1];
+            TREE_STATS_COUNT(pool, rotations);
+            current_child->data[0] = std::move(this->data[index_current_child]);
+            this->data[index_current_child] = std::move(right_child->data[0]);
+            right_child->data[0] = std::move(right_child->data[1]);
 
             current_child->children[1] = right_child->children[0];
             right_child->children[0] = right_child->children[1];
@@ -208,31 +255,31 @@ struct TreeNode {
 
         if (left_child) {
             assert(left_child->size == 1);
+            TREE_STATS_COUNT(pool, merges);
 
-            left_child->data[1] = this->data[index_current_child - 1];
+            left_child->data[1] = std::move(this->data[index_current_child - 1]);
 
             left_child->children[2] = current_child->children[0];
 
             left_child->size = 2;
             this->size--;
 
-            if (this->size == 1 && index_current_child == 1) {
-                this->data[0] = this->data[1];
-                this->children[1] = this->children[2];
-                return true;
-            }
-            if (this->size == 0) {
-                return false;
-            }
-            else {
-                return true;
-            }
+            // The empty child is merged, so it is released and the rest are shifted over it
+            pool.Destroy(current_child);
+            for (int i = index_current_child - 1; i < this->size; i++)
+                this->data[i] = std::move(this->data[i + 1]);
+            for (int i = index_current_child; i < 2; i++)
+                this->children[i] = this->children[i + 1];
+            this->children[2] = nullptr;
+
+            return this->size != 0;
         }
         assert(right_child != nullptr);
         assert(right_child->size == 1);
+        TREE_STATS_COUNT(pool, merges);
 
-        right_child->data[1] = right_child->data[0];
-        right_child->data[0] = this->data[index_current_child + 1];
+        right_child->data[1] = std::move(right_child->data[0]);
+        right_child->data[0] = std::move(this->data[index_current_child]);
 
         right_child->children[2] = right_child->children[1];
         right_child->children[1] = right_child->children[0];
@@ -241,29 +288,47 @@ struct TreeNode {
         right_child->size = 2;
         this->size--;
 
-        if (this->size == 1 && index_current_child == 0) {
-            this->data[0] = this->data[1];
-            this->children[1] = this->children[2];
-        }
+        pool.Destroy(current_child);
+        for (int i = index_current_child; i < this->size; i++)
+            this->data[i] = std::move(this->data[i + 1]);
+        for (int i = index_current_child; i < 2; i++)
+            this->children[i] = this->children[i + 1];
+        this->children[2] = nullptr;
 
-        if (this->size == 0) {
-            this->children[0] = this->children[1];
-            return false;
-        }
-        else {
-            return true;
+        return this->size != 0;
+    }
+
+    /// @brief Removes maximum element of the subtree. Can set size to 0, this means parent needs to fix it
+    /// @param max Storage for the removed element
+    /// @param pool Allocator of the tree nodes
+    /// @return Removed or NeedParentRemove
+    template<typename Pool>
+    RemoveResult remove_max(T& max, Pool& pool)
+    {
+        if (children[0] == nullptr) {
+            max = std::move(data[size - 1]);
+            size--;
+            return size == 0 ? NeedParentRemove : Removed;
         }
 
+        RemoveResult result = children[size]->remove_max(max, pool);
+        if (result == NeedParentRemove) {
+            rebalance(size, pool);
+            if (this->size == 0) { return NeedParentRemove; }
+        }
+        return Removed;
     }
 
     /// @brief Removes specified element. Can set size to 0, this means parent needs to fix it
     /// @param data_to_remove 
+    /// @param pool Allocator of the tree nodes
     /// @return 
-    RemoveResult remove(T data_to_remove) 
+    template<typename Pool>
+    RemoveResult remove(const T& data_to_remove, Pool& pool) 
     {
         if (children[0] == nullptr) {
             if (size == 1) {
-                if (data[0] == data_to_remove) {
+                if (equal(pool, data[0], data_to_remove)) {
                     size = 0;
                     return NeedParentRemove;
                 }
@@ -272,12 +337,12 @@ struct TreeNode {
                 }
             }
             else { // size == 2
-                if (data[0] == data_to_remove) {
-                    data[0] = data[1];
+                if (equal(pool, data[0], data_to_remove)) {
+                    data[0] = std::move(data[1]);
                     size = 1;
                     return Removed;
                 }
-                else if (data[1] == data_to_remove) {
+                else if (equal(pool, data[1], data_to_remove)) {
                     size = 1;
                     return Removed;
                 }
@@ -287,10 +352,10 @@ struct TreeNode {
             }
         }
         if (size == 1) {
-            if (data_to_remove < data[0]) {
-                RemoveResult result = children[0]->remove(data_to_remove);
+            if (less(pool, data_to_remove, data[0])) {
+                RemoveResult result = children[0]->remove(data_to_remove, pool);
                 if (result == NeedParentRemove) {
-                    rebalance(0);
+                    rebalance(0, pool);
                     if (this->size == 0) { return NeedParentRemove; }
                     else { return Removed; }
                 }
@@ -298,10 +363,10 @@ struct TreeNode {
                     return result;
                 }
             }
-            else if (data_to_remove > data[0]) {
-                RemoveResult result = children[1]->remove(data_to_remove);
+            else if (less(pool, data[0], data_to_remove)) {
+                RemoveResult result = children[1]->remove(data_to_remove, pool);
                 if (result == NeedParentRemove) {
-                    rebalance(1);
+                    rebalance(1, pool);
                     if (this->size == 0) { return NeedParentRemove; }
                     else { return Removed; }
                 }
@@ -309,25 +374,19 @@ struct TreeNode {
                     return result;
                 }
             }
-            else { // removing our only data
-                TreeNode* prev = children[0]->find_max_subtree();
-                assert(prev->children[0] == nullptr);
-                T prev_data = prev->get_max_data();
-                data[0] = prev_data;
-                //prev->remove(prev_data, parent???)
-                RemoveResult result = this->children[0]->remove(prev_data); // because we know prev, but don't know full sequence of parents
-                //assert(result != NotFound);
+            else { // removing our only data, predecessor takes its place
+                RemoveResult result = this->children[0]->remove_max(data[0], pool);
                 if (result == Removed) { return Removed; }
-                rebalance(0);
+                rebalance(0, pool);
                 if (this->size == 0) { return NeedParentRemove; }
                 else { return Removed; }
             }
         }
         if (size == 2) {
-            if (data_to_remove < data[0]) {
-                RemoveResult result = children[0]->remove(data_to_remove);
+            if (less(pool, data_to_remove, data[0])) {
+                RemoveResult result = children[0]->remove(data_to_remove, pool);
                 if (result == NeedParentRemove) {
-                    rebalance(0);
+                    rebalance(0, pool);
                     assert(this->size > 0);
                     return Removed;
                 }
@@ -335,22 +394,17 @@ struct TreeNode {
                     return result;
                 }
             }
-            else if (data_to_remove == data[0]) {
-                TreeNode* prev = children[0]->find_max_subtree();
-                assert(prev->children[0] == nullptr);
-                T prev_data = prev->get_max_data();
-                data[0] = prev_data;
-                RemoveResult result = this->children[0]->remove(prev_data); // because we know prev, but don't know full sequence of parents
-                assert(result != NotFound);
+            else if (equal(pool, data_to_remove, data[0])) {
+                RemoveResult result = this->children[0]->remove_max(data[0], pool);
                 if (result == Removed) { return Removed; }
-                rebalance(0);
+                rebalance(0, pool);
                 assert(this->size > 0);
                 return Removed;
             }
-            else if (data_to_remove < data[1]) {
-                RemoveResult result = children[1]->remove(data_to_remove);
+            else if (less(pool, data_to_remove, data[1])) {
+                RemoveResult result = children[1]->remove(data_to_remove, pool);
                 if (result == NeedParentRemove) {
-                    rebalance(1);
+                    rebalance(1, pool);
                     assert(this->size > 0);
                     return Removed;
                 }
@@ -358,22 +412,17 @@ struct TreeNode {
                     return result;
                 }
             }
-            else if (data_to_remove == data[1]) {
-                TreeNode* prev = children[1]->find_max_subtree();
-                assert(prev->children[0] == nullptr);
-                T prev_data = prev->get_max_data();
-                data[1] = prev_data;
-                RemoveResult result = this->children[1]->remove(prev_data); // because we know prev, but don't know full sequence of parents
-                //assert(result != NotFound);
+            else if (equal(pool, data_to_remove, data[1])) {
+                RemoveResult result = this->children[1]->remove_max(data[1], pool);
                 if (result == Removed) { return Removed; }
-                rebalance(1);
+                rebalance(1, pool);
                 assert(this->size > 0);
                 return Removed;
             }
             else { // data_to_remove > data[1]
-                RemoveResult result = children[2]->remove(data_to_remove);
+                RemoveResult result = children[2]->remove(data_to_remove, pool);
                 if (result == NeedParentRemove) {
-                    rebalance(2);
+                    rebalance(2, pool);
                     assert(this->size > 0);
                     return Removed;
                 }
@@ -385,6 +434,25 @@ struct TreeNode {
 
     }
 
+    /// @brief Moves all elements out of the subtree in sorted order.
+    /// Nodes are left with moved-from values and must be released afterwards
+    /// @param elements Container to move elements to
+    void MoveOut(std::vector<T>& elements) {
+        if (children[0]) {
+            children[0]->MoveOut(elements);
+        }
+        elements.push_back(std::move(data[0]));
+        if (children[1]) {
+            children[1]->MoveOut(elements);
+        }
+        if (size == 2) {
+            elements.push_back(std::move(data[1]));
+            if (children[2]) {
+                children[2]->MoveOut(elements);
+            }
+        }
+    }
+
     /// @brief Represents tree as array
     /// @param elements Container to save
     void InOrder(std::vector<T>& elements) const {
@@ -408,58 +476,345 @@ struct TreeNode {
 
 /// @brief Class to store comparative values
 /// @tparam T 
-template<typename T>
+/// @tparam Allocator Allocator of the tree nodes, NodePool by default
+template<typename T, template<typename> class Allocator = NodePool>
 class B23Tree {
 
 private:
 
+    using Pool = StatsPool<Allocator<TreeNode<T>>>;
+
+    // Split, Join and Union move nodes between the trees, so the allocators are shared:
+    // a tree allocates its new nodes from pool and keeps alive the allocators of the nodes
+    // it has taken from the other trees in borrowed
+    std::shared_ptr<Pool> pool = std::make_shared<Pool>();
+    std::vector<std::shared_ptr<Pool>> borrowed;
     TreeNode<T>* root = nullptr;
+    // Nodes keep no subtree sizes, so after Split the sizes of the parts are unknown
+    // until Size() counts them. Changes of count are ignored while it is not counted
+    mutable size_t count = 0;
+    mutable bool counted = true;
+
+    /// @brief Finds the rightmost leaf, which holds the maximum. The tree must not be empty
+    TreeNode<T>* maxNode() const
+    {
+        TreeNode<T>* node = root;
+        while (node->children[node->size])
+            node = node->children[node->size];
+        return node;
+    }
+
+    /// @brief Finds the element equal to the value, descending from the root
+    /// @return The element, nullptr if there is none
+    T* find(const T& data) const
+    {
+        TreeNode<T>* node = root;
+        while (node) {
+            int i = 0;
+            while (i < node->size && TreeNode<T>::less(*pool, node->data[i], data))
+                i++;
+            if (i < node->size && !TreeNode<T>::less(*pool, data, node->data[i]))
+                return &node->data[i];
+            node = node->children[i];
+        }
+        return nullptr;
+    }
 
     /// @brief Gets node with the specified data, recursively
     /// @param data Value to find
     /// @param node Current node
     /// @return Node that contains the data, else nullptr 
-    TreeNode<T>* getNode(T data, TreeNode<T>* node) const{
+    TreeNode<T>* getNode(const T& data, TreeNode<T>* node) const{
         if (!node)
             return nullptr;
 
-        if (data == node->data[0])
+        if (TreeNode<T>::equal(*pool, data, node->data[0]))
             return node;
         else if (node->size == 2)
-            if (data == node->data[1])
+            if (TreeNode<T>::equal(*pool, data, node->data[1]))
                 return node;
             else {
-                if (data < node->data[0])
+                if (TreeNode<T>::less(*pool, data, node->data[0]))
                     return getNode(data, node->children[0]);
                 else if (node->size == 2)
-                    if (data > node->data[0] && data < node->data[1])
+                    if (TreeNode<T>::less(*pool, node->data[0], data) && TreeNode<T>::less(*pool, data, node->data[1]))
                         return getNode(data, node->children[1]);
-                if (data > node->data[1])
+                if (TreeNode<T>::less(*pool, node->data[1], data))
                     return getNode(data, node->children[2]);
             }
 
         return nullptr;
     }
 
-    void getElementsByInterval(std::list<T>& elements, TreeNode<T>* node, T min, T max) const{
-        if (!node)
+    /// @brief Builds subtree of the specified height from the sorted range, bottom-up.
+    /// Range size must be in [2^height - 1, 3^height - 1]
+    /// @param first First element of the range
+    /// @param size Number of elements in the range
+    /// @param height Height of the subtree, leaves have height 1
+    /// @return Root of the built subtree
+    TreeNode<T>* buildBalanced(typename std::vector<T>::iterator first, size_t size, int height)
+    {
+        if (height == 1) {
+            assert(size == 1 || size == 2);
+            return size == 1 ?
+                pool->Create(std::move(first[0])) :
+                pool->Create(std::move(first[0]), std::move(first[1]));
+        }
+
+        size_t max_child_size = 2;
+        for (int i = 2; i < height; i++)
+            max_child_size = max_child_size * 3 + 2;
+
+        size_t children_count = (size - 1 <= 2 * max_child_size) ? 2 : 3;
+        size_t rest = size - (children_count - 1);
+
+        TreeNode<T>* children[3] = { nullptr, nullptr, nullptr };
+        T separators[2];
+        for (size_t i = 0; i < children_count; i++) {
+            size_t child_size = rest / children_count + (i < rest % children_count ? 1 : 0);
+            children[i] = buildBalanced(first, child_size, height - 1);
+            first += child_size;
+            if (i + 1 < children_count) {
+                separators[i] = std::move(*first);
+                ++first;
+            }
+        }
+
+        TreeNode<T>* node = children_count == 2 ?
+            pool->Create(std::move(separators[0])) :
+            pool->Create(std::move(separators[0]), std::move(separators[1]));
+        for (size_t i = 0; i < children_count; i++) {
+            node->children[i] = children[i];
+            children[i]->parent = node;
+        }
+        return node;
+    }
+
+    /// @brief Builds the tree from the sorted elements, replacing the current content
+    void build(std::vector<T>& sorted)
+    {
+        clear();
+        if (sorted.empty())
             return;
 
-        if (min < node->data[0])
-            getElementsByInterval(elements, node->children[0], min, max);
+        int height = 1;
+        for (size_t capacity = 2; capacity < sorted.size(); capacity = capacity * 3 + 2)
+            height++;
 
-        if (min <= node->data[0] && max >= node->data[0])
-            elements.push_back(node->data[0]);
+        root = buildBalanced(sorted.begin(), sorted.size(), height);
+        count = sorted.size();
+    }
 
-        getElementsByInterval(elements, node->children[1], min, max);
+    /// @brief Subtree with its height, leaves have height 1 and the empty subtree 0.
+    /// Nodes keep neither heights nor parent links, so Split and Join pass the heights along
+    struct Subtree
+    {
+        TreeNode<T>* node = nullptr;
+        int height = 0;
+    };
 
-        if (node->size == 2) {
-            elements.push_back(node->data[1]);
-            if (node->data[1] < max)
-                getElementsByInterval(elements, node->children[2], min, max);
+    Subtree whole() const
+    {
+        Subtree tree{ root, 0 };
+        for (TreeNode<T>* node = root; node; node = node->children[0])
+            tree.height++;
+        return tree;
+    }
+
+    /// @brief Adds the element and its right child after the last ones of the node
+    /// @return True if the node overflowed: it keeps the first element,
+    /// the middle one moves to up and the last one goes to the new right sibling
+    bool appendLast(TreeNode<T>* node, T& data, TreeNode<T>* child, T& up, TreeNode<T>*& sibling)
+    {
+        if (node->size == 1) {
+            node->data[1] = std::move(data);
+            node->children[2] = child;
+            node->size = 2;
+            return false;
         }
+
+        TREE_STATS_COUNT(*pool, splits);
+        up = std::move(node->data[1]);
+        sibling = pool->Create(std::move(data));
+        sibling->children[0] = node->children[2];
+        sibling->children[1] = child;
+        node->children[2] = nullptr;
+        node->size = 1;
+        return true;
+    }
+
+    /// @brief Adds the element and its left child before the first ones of the node
+    /// @return True if the node overflowed: it keeps the last element,
+    /// the middle one moves to up and the first one goes to the new left sibling
+    bool prependFirst(TreeNode<T>* node, TreeNode<T>* child, T& data, T& up, TreeNode<T>*& sibling)
+    {
+        if (node->size == 1) {
+            node->data[1] = std::move(node->data[0]);
+            node->data[0] = std::move(data);
+            node->children[2] = node->children[1];
+            node->children[1] = node->children[0];
+            node->children[0] = child;
+            node->size = 2;
+            return false;
+        }
+
+        TREE_STATS_COUNT(*pool, splits);
+        sibling = pool->Create(std::move(data));
+        sibling->children[0] = child;
+        sibling->children[1] = node->children[0];
+        up = std::move(node->data[0]);
+        node->data[0] = std::move(node->data[1]);
+        node->children[0] = node->children[1];
+        node->children[1] = node->children[2];
+        node->children[2] = nullptr;
+        node->size = 1;
+        return true;
+    }
+
+    /// @brief Hangs the lower subtree with the element before it on the right spine of the node
+    /// at the level of the subtree's height, splitting the overflowed nodes on the way back
+    bool pushRight(Subtree tree, T& data, Subtree right, T& up, TreeNode<T>*& sibling)
+    {
+        if (tree.height == right.height + 1)
+            return appendLast(tree.node, data, right.node, up, sibling);
+
+        T child_up;
+        TreeNode<T>* child_sibling = nullptr;
+        Subtree last{ tree.node->children[tree.node->size], tree.height - 1 };
+        if (!pushRight(last, data, right, child_up, child_sibling))
+            return false;
+        return appendLast(tree.node, child_up, child_sibling, up, sibling);
+    }
+
+    /// @brief Hangs the lower subtree with the element after it on the left spine of the node
+    bool pushLeft(Subtree tree, Subtree left, T& data, T& up, TreeNode<T>*& sibling)
+    {
+        if (tree.height == left.height + 1)
+            return prependFirst(tree.node, left.node, data, up, sibling);
+
+        T child_up;
+        TreeNode<T>* child_sibling = nullptr;
+        Subtree first{ tree.node->children[0], tree.height - 1 };
+        if (!pushLeft(first, left, data, child_up, child_sibling))
+            return false;
+        return prependFirst(tree.node, child_sibling, child_up, up, sibling);
+    }
+
+    /// @brief Joins two subtrees and the element between them in O(difference of the heights):
+    /// the lower subtree is hung on the spine of the higher one, as append adds to a leaf
+    /// @param data Element not less than the left subtree and not greater than the right one, it is moved
+    /// @return Joined subtree
+    Subtree join(Subtree left, T& data, Subtree right)
+    {
+        TreeNode<T>* node = nullptr;
+        if (left.height == right.height) {
+            node = pool->Create(std::move(data));
+            node->children[0] = left.node;
+            node->children[1] = right.node;
+            return Subtree{ node, left.height + 1 };
+        }
+
+        T up;
+        TreeNode<T>* sibling = nullptr;
+        if (left.height > right.height) {
+            if (!pushRight(left, data, right, up, sibling))
+                return left;
+            node = pool->Create(std::move(up));
+            node->children[0] = left.node;
+            node->children[1] = sibling;
+            return Subtree{ node, left.height + 1 };
+        }
+
+        if (!pushLeft(right, left, data, up, sibling))
+            return right;
+        node = pool->Create(std::move(up));
+        node->children[0] = sibling;
+        node->children[1] = right.node;
+        return Subtree{ node, right.height + 1 };
+    }
+
+    /// @brief Splits the subtree by the key in O(height): the child on the search path is split
+    /// recursively and the elements and children on both sides of it are joined to its parts.
+    /// Joined heights grow along the path, so all joins together take O(height)
+    /// @param left Set to the subtree of the elements less than the key
+    /// @param right Set to the subtree of the elements not less than the key
+    void split(Subtree tree, const T& key, Subtree& left, Subtree& right)
+    {
+        if (!tree.node) {
+            left = right = Subtree();
+            return;
+        }
+
+        TreeNode<T>* node = tree.node;
+        int index = 0;
+        while (index < node->size && TreeNode<T>::less(*pool, node->data[index], key))
+            index++;
+
+        split(Subtree{ node->children[index], tree.height - 1 }, key, left, right);
+        for (int i = index - 1; i >= 0; i--)
+            left = join(Subtree{ node->children[i], tree.height - 1 }, node->data[i], left);
+        for (int i = index; i < node->size; i++)
+            right = join(right, node->data[i], Subtree{ node->children[i + 1], tree.height - 1 });
+        pool->Destroy(node);
+    }
+
+    /// @brief Unites two subtrees: the second one is split by the elements of the first one's root,
+    /// the parts are united with its children and joined back. Equal elements are all kept
+    Subtree unite(Subtree first, Subtree second)
+    {
+        if (!first.node)
+            return second;
+        if (!second.node)
+            return first;
+
+        TreeNode<T>* node = first.node;
+        Subtree parts[3];
+        Subtree rest = second;
+        for (int i = 0; i < node->size; i++)
+            split(rest, node->data[i], parts[i], rest);
+        parts[node->size] = rest;
+
+        Subtree united = unite(Subtree{ node->children[0], first.height - 1 }, parts[0]);
+        for (int i = 0; i < node->size; i++) {
+            Subtree next = unite(Subtree{ node->children[i + 1], first.height - 1 }, parts[i + 1]);
+            united = join(united, node->data[i], next);
+        }
+        pool->Destroy(node);
+        return united;
+    }
+
+    /// @brief Keeps the allocator alive while its nodes may be in the tree.
+    /// Allocators without memory hold no nodes, so resharding doesn't pile them up
+    void borrow(const std::shared_ptr<Pool>& owner)
+    {
+        if (owner != pool && owner->ReservedBytes() > 0 &&
+            std::find(borrowed.begin(), borrowed.end(), owner) == borrowed.end())
+            borrowed.push_back(owner);
+    }
+
+    /// @brief Keeps alive all allocators of the other tree
+    void borrowFrom(const B23Tree& other)
+    {
+        borrow(other.pool);
+        for (const std::shared_ptr<Pool>& owner : other.borrowed)
+            borrow(owner);
+    }
+
+    /// @brief Takes the nodes of the other tree, it is left empty
+    /// @return Taken nodes
+    Subtree takeNodes(B23Tree& other)
+    {
+        borrowFrom(other);
+        Subtree taken = other.whole();
+        if (counted && other.counted)
+            count += other.count;
         else
-            getElementsByInterval(elements, node->children[2], min, max);
+            counted = false;
+
+        other.root = nullptr;
+        other.count = 0;
+        other.counted = true;
+        return taken;
     }
 
     void clearRecursive(TreeNode<T>* node) {
@@ -470,47 +825,396 @@ private:
         clearRecursive(node->children[1]);
         clearRecursive(node->children[2]);
 
-        delete node;      
+        pool->Destroy(node);      
     }
 
 public:
+    /// @brief Bidirectional iterator over the elements in sorted order.
+    /// Parent links of the nodes are not maintained, so the iterator keeps the path
+    /// from the root in a fixed-size stack and iterating doesn't allocate.
+    /// Elements can't be changed through it, as it would break the order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() {}
+
+        reference operator*() const
+        {
+            const Frame& top = path[depth - 1];
+            return top.node->data[top.index];
+        }
+
+        pointer operator->() const { return &**this; }
+
+        const_iterator& operator++()
+        {
+            Frame& top = path[depth - 1];
+            if (top.node->children[0]) {
+                // The next element is the leftmost one of the right subtree
+                top.index++;
+                descendLeft(top.node->children[top.index]);
+            }
+            else if (top.index + 1 < top.node->size)
+                top.index++;
+            else
+                ascendForward();
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        /// @brief Steps back, end() steps to the maximum element
+        const_iterator& operator--()
+        {
+            if (depth == 0) {
+                descendRight(root);
+                return *this;
+            }
+
+            Frame& top = path[depth - 1];
+            if (top.node->children[0])
+                descendRight(top.node->children[top.index]);
+            else if (top.index > 0)
+                top.index--;
+            else
+                ascendBackward();
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            if (depth == 0 || other.depth == 0)
+                return depth == other.depth;
+            return path[depth - 1].node == other.path[other.depth - 1].node &&
+                path[depth - 1].index == other.path[other.depth - 1].index;
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class B23Tree;
+
+        /// @brief Node on the path. The last frame points to the current element data[index],
+        /// the others to the child children[index] the path goes through.
+        /// After returning from that child, data[index] is the next element
+        struct Frame
+        {
+            TreeNode<T>* node;
+            int index;
+        };
+
+        // Height of the 2-3 tree with N elements is at most log2(N + 1),
+        // so 40 levels hold more elements than fit in memory
+        static constexpr int kMaxDepth = 40;
+
+        TreeNode<T>* root = nullptr;
+        Frame path[kMaxDepth];
+        int depth = 0;
+
+        explicit const_iterator(TreeNode<T>* root)
+            : root(root) {}
+
+        void push(TreeNode<T>* node, int index)
+        {
+            assert(depth < kMaxDepth);
+            path[depth++] = { node, index };
+        }
+
+        void descendLeft(TreeNode<T>* node)
+        {
+            for (; node; node = node->children[0])
+                push(node, 0);
+        }
+
+        void descendRight(TreeNode<T>* node)
+        {
+            for (; node->children[0]; node = node->children[node->size])
+                push(node, node->size);
+            push(node, node->size - 1);
+        }
+
+        /// @brief Leaves the finished leaf, stops at the first ancestor with the next element
+        void ascendForward()
+        {
+            depth--;
+            while (depth > 0 && path[depth - 1].index == path[depth - 1].node->size)
+                depth--;
+        }
+
+        /// @brief Leaves the finished leaf, stops at the first ancestor with the previous element
+        void ascendBackward()
+        {
+            depth--;
+            while (depth > 0 && path[depth - 1].index == 0)
+                depth--;
+            if (depth > 0)
+                path[depth - 1].index--;
+        }
+
+        /// @brief Goes to the first element that is not before the value
+        /// @param before Predicate that is true for the elements before the searched one
+        template<typename Before>
+        void seek(const T& value, Before before)
+        {
+            for (TreeNode<T>* node = root; node; ) {
+                int index = 0;
+                while (index < node->size && before(node->data[index], value))
+                    index++;
+                push(node, index);
+                node = node->children[index];
+            }
+            if (depth > 0 && path[depth - 1].index == path[depth - 1].node->size)
+                ascendForward();
+        }
+    };
+
+    using iterator = const_iterator;
+    using range = TreeRange<const_iterator>;
+
+    B23Tree() {}
+
+    // Nodes belong to the tree, so it is moved instead of copying
+    B23Tree(const B23Tree&) = delete;
+    B23Tree& operator=(const B23Tree&) = delete;
+
+    B23Tree(B23Tree&& other)
+    {
+        swap(other);
+    }
+
+    B23Tree& operator=(B23Tree&& other)
+    {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(B23Tree& other)
+    {
+        std::swap(pool, other.pool);
+        std::swap(borrowed, other.borrowed);
+        std::swap(root, other.root);
+        std::swap(count, other.count);
+        std::swap(counted, other.counted);
+    }
+
+    /// @brief Splits the tree by the key in O(log N) without copying elements.
+    /// The tree is left empty. The left part keeps its allocator, the right one
+    /// gets a new allocator for its new nodes, so each part can be given to its own thread.
+    /// Sizes of the parts are counted on the first Size() call
+    /// @param key Elements less than the key go to the left part
+    /// @return Trees of the elements less than the key and of the rest
+    std::pair<B23Tree, B23Tree> Split(const T& key)
+    {
+        std::pair<B23Tree, B23Tree> parts;
+        Subtree left, right;
+        split(whole(), key, left, right);
+
+        parts.first.swap(*this);
+        parts.first.root = left.node;
+        parts.first.counted = false;
+        parts.second.borrowFrom(parts.first);
+        parts.second.root = right.node;
+        parts.second.counted = false;
+        return parts;
+    }
+
+    /// @brief Joins two trees in O(log N) without copying elements
+    /// @param left Tree of the lower elements
+    /// @param right Tree of the elements not less than all elements of the left one
+    /// @return Tree of all elements, the arguments are moved into it
+    /// @exception std::invalid_argument Thrown when the ranges of the trees overlap
+    static B23Tree Join(B23Tree left, B23Tree right)
+    {
+        if (left.IsEmpty())
+            return right;
+        if (right.IsEmpty())
+            return left;
+        if (right.GetMin() < left.GetMax())
+            throw std::invalid_argument("Elements of the left tree must not be greater than the right ones");
+
+        // The maximum of the left tree becomes the element between the trees
+        T middle = left.PopMax();
+        Subtree right_nodes = left.takeNodes(right);
+        left.root = left.join(left.whole(), middle, right_nodes).node;
+        left.count++;
+        return left;
+    }
+
+    /// @brief Unites two trees with any elements in O(M log(N / M + 1)) for the sizes M <= N,
+    /// the elements are not copied. As in append, equal elements are all kept
+    /// @return Tree of the elements of both trees, the arguments are moved into it
+    static B23Tree Union(B23Tree first, B23Tree second)
+    {
+        Subtree second_nodes = first.takeNodes(second);
+        first.root = first.unite(first.whole(), second_nodes).node;
+        return first;
+    }
 
     /// @brief Inserts the specified value into the tree
     /// @param data Value to insert
     void append(T data) {
         if (!root) {
-            root = new TreeNode<T>(data);
+            root = pool->Create(std::move(data));
         }
         else {
-            TreeNode<T>* extra = root->add_and_split(data);
+            TreeNode<T>* extra = root->add_and_split(data, *pool);
             if (extra) {
+                pool->Destroy(root);
                 root = extra;
             }
         }
+        count++;
+    }
+
+    /// @brief Inserts all elements at once: merges them with the tree content
+    /// and builds the tree bottom-up in O(N + M log M)
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements) {
+        std::stable_sort(elements.begin(), elements.end());
+
+        std::vector<T> merged;
+        merged.reserve(Size() + elements.size());
+        if (root)
+            root->MoveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end());
+
+        build(merged);
+    }
+
+    /// @brief Removes up to n maximum elements.
+    /// When a large part of the tree is removed, the rest is rebuilt in O(N)
+    /// instead of removing elements one by one
+    /// @param n Number of elements to remove
+    /// @param removed Container to append removed elements to, in descending order
+    /// @return Number of removed elements
+    size_t RemoveMaxN(size_t n, std::vector<T>& removed) {
+        n = std::min(n, Size());
+        size_t depth = 1;
+        while ((size_t(1) << depth) <= count)
+            depth++;
+
+        if (n * depth < count) {
+            for (size_t i = 0; i < n; i++)
+                removed.push_back(PopMax());
+            return n;
+        }
+
+        std::vector<T> elements;
+        elements.reserve(count);
+        root->MoveOut(elements);
+        removed.insert(removed.end(),
+            std::make_move_iterator(elements.rbegin()), std::make_move_iterator(elements.rbegin() + n));
+
+        elements.resize(elements.size() - n);
+        build(elements);
+        return n;
+    }
+
+    /// @brief Number of elements, counted in O(N) once after Split
+    size_t Size() const
+    {
+        if (!counted) {
+            count = 0;
+            for (const_iterator it = begin(); it != end(); ++it)
+                count++;
+            counted = true;
+        }
+        return count;
+    }
+
+    /// @brief Borrowing an element from a sibling is counted as a rotation.
+    /// All leaves are on the same level, so the average depth is weighted by the node sizes
+    /// @return Operation counters and current depths of the tree, see TreeStats
+    TreeStats Stats() const
+    {
+        TreeStats stats;
+        CollectCounters(*pool, stats);
+
+        size_t depths = 0;
+        std::vector<std::pair<const TreeNode<T>*, size_t>> stack;
+        if (root)
+            stack.push_back({ root, 1 });
+        while (!stack.empty()) {
+            const TreeNode<T>* node = stack.back().first;
+            size_t depth = stack.back().second;
+            stack.pop_back();
+
+            depths += depth * node->size;
+            stats.max_depth = std::max(stats.max_depth, depth);
+            for (int i = 0; node->children[0] && i <= node->size; i++)
+                stack.push_back({ node->children[i], depth + 1 });
+        }
+        stats.average_depth = root ? double(depths) / double(Size()) : 0;
+        return stats;
     }
 
     /// @brief Removes the specified value from the tree
     /// @param data Value to insert
-    void remove(T data) 
+    void remove(const T& data) 
     {
         if (root->size == 1 && root->data[0] == data &&
             root->children[0] == nullptr && root->children[1] == nullptr)
         {
-            delete root;
+            pool->Destroy(root);
             root = nullptr;
+            count = 0;
+            counted = true;
             return;
         }
 
-        typename TreeNode<T>::RemoveResult result = root->remove(data);
+        typename TreeNode<T>::RemoveResult result = root->remove(data, *pool);
         if (result == TreeNode<T>::NotFound) { return; }
+        count--;
         if (result == TreeNode<T>::Removed) { return; }
         if (result == TreeNode<T>::NeedParentRemove && root->children[0]) {
+            TreeNode<T>* old_root = root;
             root = root->children[0];
+            pool->Destroy(old_root);
             return;
         }
     }
 
-    bool GetElem(T data) const{
+    /// @brief Removes maximum element of the tree. The tree must not be empty
+    /// @return Maximum element, moved out of the tree
+    T PopMax()
+    {
+        T max;
+        typename TreeNode<T>::RemoveResult result = root->remove_max(max, *pool);
+        count--;
+        if (result == TreeNode<T>::NeedParentRemove) {
+            // Root became empty, its only child (if any) is the new root
+            TreeNode<T>* old_root = root;
+            root = root->children[0];
+            pool->Destroy(old_root);
+        }
+        return max;
+    }
+
+    bool GetElem(const T& data) const{
         TreeNode<T>* node = getNode(data, root);
 
         if (node) {
@@ -525,9 +1229,50 @@ public:
     }
 
     std::list<T> GetElementsByInterval(T min, T max) const{
-        std::list<T> elements;
-        getElementsByInterval(elements, this->root, min, max);
-        return elements;
+        range elements = Interval(min, max);
+        return std::list<T>(elements.begin(), elements.end());
+    }
+
+    const_iterator begin() const
+    {
+        const_iterator it(root);
+        it.descendLeft(root);
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(root); }
+
+    /// @return Iterator to the first element not less than the value
+    const_iterator lower_bound(const T& data) const
+    {
+        const_iterator it(root);
+        it.seek(data, [this](const T& elem, const T& value) { return TreeNode<T>::less(*pool, elem, value); });
+        return it;
+    }
+
+    /// @return Iterator to the first element greater than the value
+    const_iterator upper_bound(const T& data) const
+    {
+        const_iterator it(root);
+        it.seek(data, [this](const T& elem, const T& value) { return !TreeNode<T>::less(*pool, value, elem); });
+        return it;
+    }
+
+    /// @return Iterators to the range of elements equal to the value
+    std::pair<const_iterator, const_iterator> equal_range(const T& data) const
+    {
+        return { lower_bound(data), upper_bound(data) };
+    }
+
+    /// @brief Lazy view of the elements from the interval, nothing is copied
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return View of the elements in [min, max] in sorted order
+    range Interval(const T& min, const T& max) const
+    {
+        if (max < min)
+            return range(end(), end());
+        return range(lower_bound(min), upper_bound(max));
     }
 
     void print() const{
@@ -541,11 +1286,20 @@ public:
         for (size_t i = 0; i < size; i++) {
             T elem;
             elem.random();
-            this->append(elem);
+            this->append(std::move(elem));
         }
     }
 
 
+    /// @brief Fills the tree with random elements using AppendRange
+    /// @param size Number of elements
+    void FillRange(size_t size) {
+        std::vector<T> elements(size);
+        for (T& elem : elements)
+            elem.random();
+        this->AppendRange(std::move(elements));
+    }
+
     void IncrementElemByOne(TreeNode<T>* node = nullptr) {
         if (!node)
             node = root;
@@ -561,30 +1315,58 @@ public:
             ++(node->data[1]);
     }
 
+    /// @brief Deletes all elements. Node pool releases trivially destructible nodes at once
+    /// unless the other trees share it after Split, Join or Union
     void clear() {
         if (!root) 
             return;
 
-        clearRecursive(this->root);
+        // Shared allocator may hold nodes of the other trees, so only the sole owner releases it.
+        // Borrowed allocators are kept until then, the free list may reuse their slots
+        bool exclusive = pool.use_count() == 1;
+        if (!(exclusive && Allocator<TreeNode<T>>::kReleasesAll && std::is_trivially_destructible<TreeNode<T>>::value))
+            clearRecursive(this->root);
+        if (exclusive) {
+            pool->Release();
+            borrowed.clear();
+        }
 
         root = nullptr;
+        count = 0;
+        counted = true;
     }
 
     /// @brief Gets maximum element of the tree
     /// @return Maximum element of the tree
-    T GetMax() const
+    const T& GetMax() const
     {
-        TreeNode<T>* cur = root, *prev = root;
-        while (cur != nullptr)
-        {
-            prev = cur;
-            cur = cur->children[cur->size];
-            //if (cur->size == 1)
-            //    cur = cur->children[1];
-            //else if (cur->size == 2)
-            //    cur = cur->children[2];
-        }
-        return prev->get_max_data();
+        return maxNode()->get_max_data();
+    }
+
+    /// @brief Gets maximum element of the tree to change it in place.
+    /// The change must keep the order of the element
+    T& GetMax()
+    {
+        TreeNode<T>* node = maxNode();
+        return node->data[node->size - 1];
+    }
+
+    /// @brief Finds the element equal to the value to change it in place.
+    /// The change must keep the order of the element
+    /// @return The element, nullptr if there is none
+    T* Find(const T& data)
+    {
+        return find(data);
+    }
+
+    /// @brief Gets minimum element of the tree. The tree must not be empty
+    /// @return Minimum element of the tree
+    const T& GetMin() const
+    {
+        TreeNode<T>* node = root;
+        while (node->children[0])
+            node = node->children[0];
+        return node->data[0];
     }
 
     bool IsEmpty() const
@@ -619,7 +1401,7 @@ private:
         B23Tree tree;
         tree.FillRandom(state.range(0));
 
-        std::vector<Time> elements;
+        std::vector<T> elements;
         tree.root->InOrder(elements);
 
         std::random_device rd;
@@ -637,7 +1419,7 @@ private:
         B23Tree tree;
         tree.FillRandom(state.range(0));
 
-        std::vector<Time> elements;
+        std::vector<T> elements;
         tree.root->InOrder(elements);
 
         std::random_device rd;
@@ -654,12 +1436,38 @@ private:
 
     }
 
+    static void get_max_B23Tree_BM(benchmark::State& state)
+    {
+        B23Tree tree;
+        tree.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(tree.GetMax());
+        }
+
+        tree.clear();
+    }
+
+    static void pop_max_B23Tree_BM(benchmark::State& state)
+    {
+        B23Tree tree;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            tree.FillRange(state.range(0));
+            state.ResumeTiming();
+
+            while (!tree.IsEmpty())
+                benchmark::DoNotOptimize(tree.PopMax());
+        }
+    }
+
     static void remove_element_B23Tree_BM(benchmark::State& state)
     {
         B23Tree tree;
         tree.FillRandom(state.range(0));
 
-        std::vector<Time> elements;
+        std::vector<T> elements;
         tree.root->InOrder(elements);
 
         std::random_device rd;
@@ -695,6 +1503,17 @@ private:
 
     }
 
+    static void fill_range_B23Tree_BM(benchmark::State& state)
+    {
+        B23Tree tree;
+
+        for (auto _ : state) {
+            tree.FillRange(state.range(0));
+        }
+        tree.clear();
+
+    }
+
     static void fill_random_ascending_order_B23Tree_BM(benchmark::State& state)
     {
         B23Tree tree;
@@ -723,6 +1542,30 @@ private:
         tree.clear();
     }
 
+    template<template<typename> class NodeAllocator>
+    static void churn_B23Tree_BM(benchmark::State& state)
+    {
+        B23Tree<T, NodeAllocator> tree;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements)
+            elem.random();
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            for (const T& elem : elements)
+                tree.append(elem);
+            for (size_t i = 0; i < elements.size() / 2; i++)
+                tree.remove(elements[mersenne() % elements.size()]);
+            tree.clear();
+        }
+
+        state.SetItemsProcessed(state.iterations() * elements.size());
+        state.counters["RSS_KB"] = ResidentSetBytes() / 1024.0;
+    }
+
 public:
 
     // Appends benchmarking function to the benchmarking queue
@@ -738,6 +1581,14 @@ public:
         BENCHMARK(get_elements_interval_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    void GetMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_max_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void PopMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(pop_max_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void remove_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(remove_element_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -750,6 +1601,10 @@ public:
         BENCHMARK(fill_random_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    void FillRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_range_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void FillRandomAscendingOrder_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(fill_random_ascending_order_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -758,6 +1613,13 @@ public:
         BENCHMARK(fill_random_descending_order_B23Tree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
 
+    // Appends benchmarking functions to the benchmarking queue
+    // Compares insert/remove/clear throughput and memory of the node pool and plain new/delete
+    void Churn_BM(size_t maxElems, size_t iterations) {
+        benchmark::RegisterBenchmark("churn_B23Tree_BM<NodePool>", churn_B23Tree_BM<NodePool>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+        benchmark::RegisterBenchmark("churn_B23Tree_BM<NewDeleteAllocator>", churn_B23Tree_BM<NewDeleteAllocator>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+
     void BenchmarkTheQueue() {
         benchmark::RunSpecifiedBenchmarks();
         benchmark::RegisterMemoryManager(nullptr);
@@ -1,8 +1,16 @@
 #pragma once
 
+#include <vector>
+#include <sstream>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 #include "item.h"
+#include "bucket.h"
+#include "lazy_buckets.h"
 #include "2-3Tree.hpp"
 #include "priority_queue.h"
 
@@ -22,9 +30,29 @@ public:
     T Peek() const override;
     T Pop() override;
     void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+    /// @return Counters and depths of the tree, which holds one element per distinct priority
+    TreeStats Stats() const;
+
+    /// @brief Switches the lazy deletion: emptied buckets stay in the tree as tombstones
+    /// until they take more than max_garbage of its nodes, then the tree is rebuilt, see LazyBuckets.
+    /// Suits the workloads that insert the popped priorities again soon
+    void SetLazyDeletion(bool enabled, double max_garbage = LazyBuckets<T, B23Tree<Bucket<T>>>::kDefaultGarbage);
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
 
 private:
-    B23Tree<Item<T>> tree;
+    // One bucket per priority, equal priorities are popped in arrival order
+    B23Tree<Bucket<T>> tree;
+    // Tombstones and their counters while the lazy deletion is on
+    LazyBuckets<T, B23Tree<Bucket<T>>> lazy;
+
+    /// @return Bucket of the priority, nullptr if there is none
+    Bucket<T>* findBucket(int priority);
 
     bool isEmpty() const override;
 };
@@ -38,7 +66,7 @@ inline T B23TreePriorityQueue<T>::Peek() const
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
 	else {
-		return tree.GetMax().data;
+		return (lazy.Enabled() ? lazy.Top(tree) : tree.GetMax()).Front();
 	}
 }
 
@@ -47,23 +75,94 @@ inline T B23TreePriorityQueue<T>::Pop()
 {
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
+	else if (lazy.Enabled())
+		return lazy.Pop(tree);
 	else {
-		Item<T> item = tree.GetMax();
-		tree.remove(item);
-		return item.data;
+		Bucket<T>& top = tree.GetMax();
+		T data = top.Pop();
+		if (top.Empty())
+			tree.PopMax();
+		return data;
 	}
 }
 
 template<typename T>
 inline void B23TreePriorityQueue<T>::Insert(T data, int priority)
 {
-	tree.append(Item<T>(data, priority));
+	if (lazy.Enabled())
+		lazy.Insert(tree, std::move(data), priority);
+	else if (Bucket<T>* bucket = findBucket(priority))
+		bucket->Push(std::move(data));
+	else
+		tree.append(Bucket<T>(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t B23TreePriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	// Tombstones are passed by the pops one by one
+	if (lazy.Enabled())
+		return PriorityQueue<T>::PopN(count, out);
+
+	size_t taken;
+	size_t whole = CountWholeBuckets(tree, count, taken);
+	return PopBuckets(tree, count, whole, taken, out);
+}
+
+template<typename T>
+inline void B23TreePriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	if (lazy.Enabled()) {
+		lazy.InsertRange(tree, items);
+		return;
+	}
+
+	// Items of the present priorities join their buckets, the new buckets are built into the tree at once
+	std::vector<Bucket<T>> added;
+	for (Bucket<T>& group : Bucket<T>::Group(items)) {
+		if (Bucket<T>* bucket = findBucket(group.priority))
+			bucket->Append(std::move(group));
+		else
+			added.push_back(std::move(group));
+	}
+	if (!added.empty())
+		tree.AppendRange(std::move(added));
+}
+
+template<typename T>
+inline TreeStats B23TreePriorityQueue<T>::Stats() const
+{
+    TreeStats stats = tree.Stats();
+    stats.tombstones = lazy.Tombstones();
+    stats.compactions = lazy.Compactions();
+    return stats;
+}
+
+template<typename T>
+inline void B23TreePriorityQueue<T>::SetLazyDeletion(bool enabled, double max_garbage)
+{
+    if (enabled)
+        lazy.Enable(tree, max_garbage);
+    else
+        lazy.Disable(tree);
+}
+
+template<typename T>
+inline Bucket<T>* B23TreePriorityQueue<T>::findBucket(int priority)
+{
+	return tree.Find(Bucket<T>(priority));
+}
+
+template<typename T>
+inline void B23TreePriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+	ForEachInPopOrder(tree, visit);
 }
 
 template<typename T>
 inline bool B23TreePriorityQueue<T>::isEmpty() const
 {
-	return tree.IsEmpty();
+	return lazy.Enabled() ? lazy.Empty() : tree.IsEmpty();
 }
 
 #ifdef _DEBUG
@@ -72,16 +171,16 @@ TEST_CASE("Insert")
 	B23TreePriorityQueue<int> q;
 
 	q.Insert(1111, 1);
-	CHECK(q.tree.root->data[0].data == 1111);
+	CHECK(q.tree.root->data[0].Front() == 1111);
 
 	q.Insert(2222, 10);
-    CHECK(q.tree.root->data[0].data == 1111);
-	CHECK(q.tree.root->data[1].data == 2222);
+    CHECK(q.tree.root->data[0].Front() == 1111);
+	CHECK(q.tree.root->data[1].Front() == 2222);
 
 	q.Insert(3333, 5);
-    CHECK(q.tree.root->data[0].data == 3333);
-    CHECK(q.tree.root->children[0]->data[0].data == 1111);
-	CHECK(q.tree.root->children[1]->data[0].data == 2222);
+    CHECK(q.tree.root->data[0].Front() == 3333);
+    CHECK(q.tree.root->children[0]->data[0].Front() == 1111);
+	CHECK(q.tree.root->children[1]->data[0].Front() == 2222);
 }
 
 TEST_CASE("Peek")
@@ -114,4 +213,403 @@ TEST_CASE("Pop")
 	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
 }
 
+TEST_CASE("Insert range and pop several elements")
+{
+	B23TreePriorityQueue<int> q;
+
+	q.Insert(5555, 6);
+
+	std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+	q.InsertRange(items.begin(), items.end());
+
+	std::vector<int> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+	CHECK(q.PopN(3, popped) == 2);
+	CHECK(popped.back() == 1111);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bulk build of a large queue")
+{
+	B23TreePriorityQueue<int> q;
+
+	std::vector<Item<int>> items;
+	for (int i = 0; i < 1000; i++)
+		items.push_back(Item<int>(i, (i * 7919) % 1000));
+	q.InsertRange(items.begin(), items.begin() + 500);
+	q.InsertRange(items.begin() + 500, items.end());
+
+	std::vector<int> popped;
+	q.PopN(2, popped);
+	q.PopN(500, popped);
+	while (popped.size() < 1000)
+		popped.push_back(q.Pop());
+
+	for (size_t i = 1; i < popped.size(); i++)
+		CHECK((popped[i - 1] * 7919) % 1000 > (popped[i] * 7919) % 1000);
+}
+
+TEST_CASE("Remove elements from the middle of the tree")
+{
+	B23Tree<int> tree;
+	for (int i = 0; i < 1000; i++)
+		tree.append((i * 7919) % 1000);
+
+	for (int i = 0; i < 1000; i += 3)
+		tree.remove(i);
+
+	std::vector<int> elements, expected;
+	tree.root->InOrder(elements);
+	for (int i = 0; i < 1000; i++)
+		if (i % 3 != 0)
+			expected.push_back(i);
+
+	CHECK(elements == expected);
+	CHECK(tree.Size() == expected.size());
+}
+
+TEST_CASE("Tree iterators and interval views")
+{
+	B23Tree<int> tree;
+	std::vector<int> expected;
+
+	for (int size = 0; size < 200; size++) {
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+		CHECK(std::equal(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()),
+			expected.rbegin(), expected.rend()));
+
+		int value = (size * 7919) % 200;
+		tree.append(value);
+		tree.append(value);
+		expected.insert(std::upper_bound(expected.begin(), expected.end(), value), 2, value);
+	}
+
+	CHECK(*tree.lower_bound(50) == 50);
+	CHECK(*tree.upper_bound(50) == 51);
+	CHECK(*std::prev(tree.end()) == 199);
+	CHECK(tree.lower_bound(200) == tree.end());
+	CHECK(tree.upper_bound(-1) == tree.begin());
+
+	auto equal = tree.equal_range(42);
+	CHECK(std::distance(equal.first, equal.second) == 2);
+	CHECK(std::distance(tree.begin(), tree.end()) == 400);
+
+	int sum = 0;
+	for (int elem : tree.Interval(100, 149))
+		sum += elem;
+	CHECK(sum == 2 * (100 + 149) * 50 / 2);
+	CHECK(tree.Interval(150, 100).empty());
+	CHECK(std::count_if(tree.Interval(10, 19).begin(), tree.Interval(10, 19).end(),
+		[](int elem) { return elem % 2 == 0; }) == 2 * 5);
+}
+
+TEST_CASE("Split, join and union of the trees")
+{
+	// All leaves are on one level and the inner nodes have all their children
+	auto balanced = [](const B23Tree<int>& tree) {
+		int leaf_depth = 0;
+		std::vector<std::pair<const TreeNode<int>*, int>> stack;
+		if (tree.root)
+			stack.push_back({ tree.root, 1 });
+		while (!stack.empty()) {
+			const TreeNode<int>* node = stack.back().first;
+			int depth = stack.back().second;
+			stack.pop_back();
+
+			if (node->size < 1 || node->size > 2)
+				return false;
+			if (!node->children[0]) {
+				if (node->children[1] || node->children[2] || (leaf_depth && depth != leaf_depth))
+					return false;
+				leaf_depth = depth;
+				continue;
+			}
+			for (int i = 0; i < 3; i++) {
+				if ((i <= node->size) != (node->children[i] != nullptr))
+					return false;
+				if (node->children[i])
+					stack.push_back({ node->children[i], depth + 1 });
+			}
+		}
+		return std::is_sorted(tree.begin(), tree.end());
+	};
+
+	std::mt19937 mersenne(7);
+	B23Tree<int> tree;
+	std::multiset<int> expected;
+	for (int i = 0; i < 3000; i++) {
+		int value = int(mersenne() % 1000);
+		tree.append(value);
+		expected.insert(value);
+	}
+
+	for (int key : { -1, 0, 250, 500, *expected.rbegin(), 2000 }) {
+		auto parts = tree.Split(key);
+		CHECK(tree.IsEmpty());
+		CHECK(balanced(parts.first));
+		CHECK(balanced(parts.second));
+		CHECK(parts.first.Size() == size_t(std::distance(expected.begin(), expected.lower_bound(key))));
+		CHECK(std::equal(parts.first.begin(), parts.first.end(), expected.begin(), expected.lower_bound(key)));
+		CHECK(std::equal(parts.second.begin(), parts.second.end(), expected.lower_bound(key), expected.end()));
+
+		// Parts are separate trees with their own allocators
+		parts.first.append(-100);
+		parts.second.append(3000);
+		CHECK(parts.first.GetMin() == -100);
+		CHECK(parts.second.GetMax() == 3000);
+		parts.first.remove(-100);
+		parts.second.PopMax();
+
+		tree = B23Tree<int>::Join(std::move(parts.first), std::move(parts.second));
+		CHECK(balanced(tree));
+		REQUIRE(tree.Size() == expected.size());
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+	}
+
+	// Trees of very different heights, equal elements may be on both sides
+	B23Tree<int> low;
+	low.append(-1);
+	low.append(0);
+	tree = B23Tree<int>::Join(std::move(low), std::move(tree));
+	CHECK(balanced(tree));
+	CHECK(tree.Size() == expected.size() + 2);
+	tree.remove(-1);
+	tree.remove(0);
+
+	B23Tree<int> overlapping;
+	overlapping.append(500);
+	CHECK_THROWS_AS(B23Tree<int>::Join(std::move(overlapping), tree.Split(100).second), const std::invalid_argument&);
+
+	std::multiset<int> united;
+	std::vector<int> second_elements;
+	{
+		B23Tree<int> first, second;
+		for (int i = 0; i < 2000; i++) {
+			int value = int(mersenne() % 500);
+			first.append(value);
+			united.insert(value);
+		}
+		for (int i = 0; i < 300; i++) {
+			int value = int(mersenne() % 1000);
+			second.append(value);
+			united.insert(value);
+			second_elements.push_back(value);
+		}
+		tree = B23Tree<int>::Union(std::move(first), std::move(second));
+	}
+	// Nodes of the united trees outlive them, equal elements are all kept
+	CHECK(balanced(tree));
+	REQUIRE(tree.Size() == united.size());
+	CHECK(std::equal(tree.begin(), tree.end(), united.begin(), united.end()));
+
+	for (int value : second_elements)
+		tree.remove(value);
+	CHECK(balanced(tree));
+	CHECK(tree.Size() == united.size() - second_elements.size());
+
+	tree = B23Tree<int>::Union(B23Tree<int>(), std::move(tree));
+	CHECK(balanced(tree));
+	tree.clear();
+	CHECK(tree.IsEmpty());
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+	B23TreePriorityQueue<int> q;
+
+	for (int i = 0; i < 300; i++)
+		q.Insert(i, i % 3);
+	std::vector<Item<int>> items;
+	for (int i = 300; i < 600; i++)
+		items.push_back(Item<int>(i, i % 3));
+	q.InsertRange(items.begin(), items.end());
+	CHECK(q.tree.Size() == 3);
+
+	std::vector<int> popped;
+	q.PopN(50, popped);
+	q.Insert(600, 2);
+	while (popped.size() < 601)
+		popped.push_back(q.Pop());
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	CHECK(popped[0] == 2);
+	CHECK(popped[199] == 599);
+	CHECK(popped[200] == 600);
+	for (size_t i = 1; i < popped.size(); i++) {
+		if (popped[i - 1] % 3 == popped[i] % 3)
+			CHECK(popped[i - 1] < popped[i]);
+	}
+}
+
+TEST_CASE("Tree statistics")
+{
+	B23Tree<int> tree;
+	CHECK(tree.Stats().max_depth == 0);
+
+	for (int value = 1; value <= 7; value++)
+		tree.append(value);
+	TreeStats stats = tree.Stats();
+	CHECK(stats.max_depth == 3);
+	CHECK(stats.average_depth == doctest::Approx(17.0 / 7));
+
+	// Both of the parents are merged, the tree loses a level
+	tree.remove(1);
+	CHECK(tree.Stats().max_depth == 2);
+	CHECK(tree.Stats().average_depth == doctest::Approx(10.0 / 6));
+
+#ifdef TREE_STATS
+	// Leaves overflow on 3, 5 and 7, the last split goes up to the root
+	CHECK(stats.splits == 4);
+	// Every split creates three nodes
+	CHECK(stats.allocations == 1 + 3 * 4);
+	CHECK(stats.merges == 0);
+	CHECK(stats.comparisons > 0);
+
+	CHECK(tree.Stats().merges == 2);
+	CHECK(tree.Stats().rotations == 0);
+	// Emptied leaf borrows from the left sibling
+	tree.remove(5);
+	CHECK(tree.Stats().rotations == 1);
+#endif
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+	B23TreePriorityQueue<CopyCounter> q;
+	CopyCounter::copies = 0;
+
+	q.Insert(CopyCounter(1111), 1);
+	q.Insert(CopyCounter(2222), 10);
+	q.Emplace(5, 3333);
+
+	std::vector<Item<CopyCounter>> items;
+	items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+	items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+	q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+	CHECK(q.Pop().value == 2222);
+	CHECK(q.Pop().value == 4444);
+
+	std::vector<CopyCounter> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped[0].value == 3333);
+	CHECK(popped[1].value == 5555);
+	CHECK(popped[2].value == 1111);
+
+	CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Lazy deletion keeps the emptied buckets")
+{
+	B23TreePriorityQueue<int> q;
+	CHECK_THROWS_AS(q.SetLazyDeletion(true, 1.5), const std::invalid_argument&);
+
+	for (int i = 0; i < 10; i++)
+		q.Insert(i, i);
+	q.SetLazyDeletion(true, 0.5);
+
+	CHECK(q.Pop() == 9);
+	CHECK(q.Pop() == 8);
+	CHECK(q.tree.Size() == 10);
+	CHECK(q.Stats().tombstones == 2);
+
+	// Inserted priority revives its bucket
+	q.Insert(90, 9);
+	CHECK(q.Stats().tombstones == 1);
+	CHECK(q.Peek() == 90);
+	CHECK(q.Pop() == 90);
+
+	// The top is found below the tombstones
+	CHECK(q.Peek() == 7);
+	CHECK(q.Pop() == 7);
+	CHECK(q.Pop() == 6);
+	CHECK(q.Pop() == 5);
+	CHECK(q.Stats().compactions == 0);
+
+	// Tombstones take more than a half of the nodes, the tree is rebuilt
+	CHECK(q.Pop() == 4);
+	CHECK(q.Stats().compactions == 1);
+	CHECK(q.Stats().tombstones == 0);
+	CHECK(q.tree.Size() == 4);
+
+	q.SetLazyDeletion(false);
+	std::vector<int> popped;
+	CHECK(q.PopN(5, popped) == 4);
+	CHECK(popped == std::vector<int>{ 3, 2, 1, 0 });
+	CHECK(q.tree.IsEmpty());
+}
+
+TEST_CASE("Lazy deletion pops as the eager one")
+{
+	B23TreePriorityQueue<int> lazy, eager;
+	lazy.SetLazyDeletion(true, 0.2);
+	std::mt19937 mersenne(7);
+
+	for (int i = 0; i < 20000; i++) {
+		switch (mersenne() % 4)
+		{
+		case 0:
+		{
+			std::vector<Item<int>> items;
+			for (int j = 0; j < 8; j++)
+				items.push_back(Item<int>(i * 8 + j, int(mersenne() % 64)));
+			lazy.InsertRange(items.begin(), items.end());
+			eager.InsertRange(items.begin(), items.end());
+			break;
+		}
+		case 1:
+		{
+			int priority = int(mersenne() % 64);
+			lazy.Insert(i, priority);
+			eager.Insert(i, priority);
+			break;
+		}
+		default:
+			if (eager.isEmpty())
+				CHECK_THROWS_AS(lazy.Pop(), const std::underflow_error&);
+			else {
+				CHECK(lazy.Peek() == eager.Peek());
+				CHECK(lazy.Pop() == eager.Pop());
+			}
+			break;
+		}
+		if (i == 10000)
+			lazy.SetLazyDeletion(false);
+		if (i == 15000)
+			lazy.SetLazyDeletion(true, 0.9);
+	}
+	CHECK(lazy.Stats().compactions > 0);
+
+	std::vector<int> lazy_popped, eager_popped;
+	lazy.PopN(100000, lazy_popped);
+	eager.PopN(100000, eager_popped);
+	CHECK(lazy_popped == eager_popped);
+	CHECK(lazy.isEmpty());
+}
+
+TEST_CASE("Save and load")
+{
+	B23TreePriorityQueue<int> q;
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	q.Insert(4444, 7);
+	q.Insert(5555, 5);
+
+	std::stringstream stream;
+	q.Save(stream);
+
+	B23TreePriorityQueue<int> loaded;
+	loaded.Load(stream);
+
+	// Both queues pop the same elements in the same order
+	for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+		CHECK(loaded.Pop() == value);
+		CHECK(q.Pop() == value);
+	}
+	CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
 #endif
\ No newline at end of file
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <vector>
+#include <sstream>
+#include <set>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 #include "item.h"
+#include "bucket.h"
+#include "lazy_buckets.h"
 #include "AVLTree.hpp"
 #include "priority_queue.h"
 
@@ -22,9 +31,29 @@ public:
     T Peek() const override;
     T Pop() override;
     void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+    /// @return Counters and depths of the tree, which holds one element per distinct priority
+    TreeStats Stats() const;
+
+    /// @brief Switches the lazy deletion: emptied buckets stay in the tree as tombstones
+    /// until they take more than max_garbage of its nodes, then the tree is rebuilt, see LazyBuckets.
+    /// Suits the workloads that insert the popped priorities again soon
+    void SetLazyDeletion(bool enabled, double max_garbage = LazyBuckets<T, AVLTree<Bucket<T>>>::kDefaultGarbage);
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
 
 private:
-    AVLTree<Item<T>> tree;
+    // One bucket per priority, equal priorities are popped in arrival order
+    AVLTree<Bucket<T>> tree;
+    // Tombstones and their counters while the lazy deletion is on
+    LazyBuckets<T, AVLTree<Bucket<T>>> lazy;
+
+    /// @return Bucket of the priority, nullptr if there is none
+    Bucket<T>* findBucket(int priority);
 
     bool isEmpty() const override;
 };
@@ -38,7 +67,7 @@ inline T AVLPriorityQueue<T>::Peek() const
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
 	else {
-		return tree.GetMax().data;
+		return (lazy.Enabled() ? lazy.Top(tree) : tree.GetMax()).Front();
 	}
 }
 
@@ -47,23 +76,94 @@ inline T AVLPriorityQueue<T>::Pop()
 {
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
+	else if (lazy.Enabled())
+		return lazy.Pop(tree);
 	else {
-		Item<T> item = tree.GetMax();
-		tree.remove(item);
-		return item.data;
+		Bucket<T>& top = tree.GetMax();
+		T data = top.Pop();
+		if (top.Empty())
+			tree.PopMax();
+		return data;
 	}
 }
 
 template<typename T>
 inline void AVLPriorityQueue<T>::Insert(T data, int priority)
 {
-	tree.append(Item<T>(data, priority));
+	if (lazy.Enabled())
+		lazy.Insert(tree, std::move(data), priority);
+	else if (Bucket<T>* bucket = findBucket(priority))
+		bucket->Push(std::move(data));
+	else
+		tree.append(Bucket<T>(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t AVLPriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	// Tombstones are passed by the pops one by one
+	if (lazy.Enabled())
+		return PriorityQueue<T>::PopN(count, out);
+
+	size_t taken;
+	size_t whole = CountWholeBuckets(tree, count, taken);
+	return PopBuckets(tree, count, whole, taken, out);
+}
+
+template<typename T>
+inline void AVLPriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	if (lazy.Enabled()) {
+		lazy.InsertRange(tree, items);
+		return;
+	}
+
+	// Items of the present priorities join their buckets, the new buckets are built into the tree at once
+	std::vector<Bucket<T>> added;
+	for (Bucket<T>& group : Bucket<T>::Group(items)) {
+		if (Bucket<T>* bucket = findBucket(group.priority))
+			bucket->Append(std::move(group));
+		else
+			added.push_back(std::move(group));
+	}
+	if (!added.empty())
+		tree.AppendRange(std::move(added));
+}
+
+template<typename T>
+inline TreeStats AVLPriorityQueue<T>::Stats() const
+{
+    TreeStats stats = tree.Stats();
+    stats.tombstones = lazy.Tombstones();
+    stats.compactions = lazy.Compactions();
+    return stats;
+}
+
+template<typename T>
+inline void AVLPriorityQueue<T>::SetLazyDeletion(bool enabled, double max_garbage)
+{
+    if (enabled)
+        lazy.Enable(tree, max_garbage);
+    else
+        lazy.Disable(tree);
+}
+
+template<typename T>
+inline Bucket<T>* AVLPriorityQueue<T>::findBucket(int priority)
+{
+	return tree.Find(Bucket<T>(priority));
+}
+
+template<typename T>
+inline void AVLPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+	ForEachInPopOrder(tree, visit);
 }
 
 template<typename T>
 inline bool AVLPriorityQueue<T>::isEmpty() const
 {
-	return tree.isEmpty();
+	return lazy.Enabled() ? lazy.Empty() : tree.isEmpty();
 }
 
 #ifdef _DEBUG
@@ -72,17 +172,17 @@ TEST_CASE("Insert")
 	AVLPriorityQueue<int> q;
 
 	q.Insert(1111, 1);
-	CHECK(q.tree.root->data.data == 1111);
+	CHECK(q.tree.root->data.Front() == 1111);
 
 
 	q.Insert(2222, 10);
-	CHECK(q.tree.root->right->data.data == 2222);
-	CHECK(q.tree.root->data.data == 1111);
+	CHECK(q.tree.root->right->data.Front() == 2222);
+	CHECK(q.tree.root->data.Front() == 1111);
 
 	q.Insert(3333, 5);
-	CHECK(q.tree.root->data.data == 3333);
-	CHECK(q.tree.root->right->data.data == 2222);
-	CHECK(q.tree.root->left->data.data == 1111);
+	CHECK(q.tree.root->data.Front() == 3333);
+	CHECK(q.tree.root->right->data.Front() == 2222);
+	CHECK(q.tree.root->left->data.Front() == 1111);
 }
 
 TEST_CASE("Peek")
@@ -115,4 +215,565 @@ TEST_CASE("Pop")
 	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
 }
 
+TEST_CASE("Insert range and pop several elements")
+{
+	AVLPriorityQueue<int> q;
+
+	q.Insert(5555, 6);
+
+	std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+	q.InsertRange(items.begin(), items.end());
+
+	std::vector<int> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+	CHECK(q.PopN(3, popped) == 2);
+	CHECK(popped.back() == 1111);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bulk build of a large queue")
+{
+	AVLPriorityQueue<int> q;
+
+	std::vector<Item<int>> items;
+	for (int i = 0; i < 1000; i++)
+		items.push_back(Item<int>(i, (i * 7919) % 1000));
+	q.InsertRange(items.begin(), items.begin() + 500);
+	q.InsertRange(items.begin() + 500, items.end());
+
+	std::vector<int> popped;
+	q.PopN(2, popped);
+	q.PopN(500, popped);
+	while (popped.size() < 1000)
+		popped.push_back(q.Pop());
+
+	for (size_t i = 1; i < popped.size(); i++)
+		CHECK((popped[i - 1] * 7919) % 1000 > (popped[i] * 7919) % 1000);
+}
+
+TEST_CASE("Tree iterators and interval views")
+{
+	AVLTree<int> tree;
+	std::vector<int> expected;
+
+	for (int size = 0; size < 200; size++) {
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+		CHECK(std::equal(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()),
+			expected.rbegin(), expected.rend()));
+
+		int value = (size * 7919) % 200;
+		tree.append(value);
+		expected.insert(std::upper_bound(expected.begin(), expected.end(), value), value);
+	}
+
+	CHECK(*tree.lower_bound(50) == 50);
+	CHECK(*tree.upper_bound(50) == 51);
+	CHECK(*std::prev(tree.end()) == 199);
+	CHECK(tree.lower_bound(200) == tree.end());
+	CHECK(tree.upper_bound(-1) == tree.begin());
+
+	auto equal = tree.equal_range(42);
+	CHECK(std::distance(equal.first, equal.second) == 1);
+	CHECK(std::distance(tree.begin(), tree.end()) == 200);
+
+	int sum = 0;
+	for (int elem : tree.Interval(100, 149))
+		sum += elem;
+	CHECK(sum == 1 * (100 + 149) * 50 / 2);
+	CHECK(tree.Interval(150, 100).empty());
+	CHECK(std::count_if(tree.Interval(10, 19).begin(), tree.Interval(10, 19).end(),
+		[](int elem) { return elem % 2 == 0; }) == 1 * 5);
+}
+
+TEST_CASE("Order statistics")
+{
+	AVLTree<int> tree;
+	std::vector<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 3000;
+		tree.append(value);
+		expected.push_back(value);
+	}
+	for (int i = 0; i < 3000; i += 3) {
+		int value = (i * 104729) % 3000;
+		tree.remove(value);
+		expected.erase(std::find(expected.begin(), expected.end(), value));
+	}
+	tree.PopMax();
+	std::sort(expected.begin(), expected.end());
+	expected.pop_back();
+	tree.append(expected[10]); // equal elements are skipped
+
+	for (size_t k = 0; k < expected.size(); k++)
+		CHECK(tree.Select(k) == expected[k]);
+	CHECK_THROWS_AS(tree.Select(expected.size()), const std::out_of_range&);
+
+	for (int value = -1; value <= 3000; value += 7) {
+		size_t rank = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+		CHECK(tree.Rank(value) == rank);
+		size_t count = std::upper_bound(expected.begin(), expected.end(), value + 100) - expected.begin() - rank;
+		CHECK(tree.CountInRange(value, value + 100) == count);
+	}
+	CHECK(tree.CountInRange(100, 50) == 0);
+
+	tree.AppendRange(std::vector<int>{ -5, 5000 });
+	CHECK(tree.Select(0) == -5);
+	CHECK(tree.Select(tree.Size() - 1) == 5000);
+	CHECK(tree.Rank(5000) == tree.Size() - 1);
+}
+
+TEST_CASE("Cached minimum and maximum follow the changes")
+{
+	AVLTree<int> tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 1000;
+		if (i % 3 == 2) {
+			tree.remove(value);
+			expected.erase(value);
+		}
+		else if (i % 7 == 6 && !expected.empty()) {
+			CHECK(tree.PopMax() == *expected.rbegin());
+			expected.erase(std::prev(expected.end()));
+		}
+		else {
+			tree.append(value);
+			expected.insert(value);
+		}
+
+		if (i % 500 == 0) {
+			tree.AppendRange(std::vector<int>{ i - 2000, i + 2000 });
+			expected.insert({ i - 2000, i + 2000 });
+		}
+
+		REQUIRE(tree.Size() == expected.size());
+		if (!expected.empty()) {
+			CHECK(tree.GetMin() == *expected.begin());
+			CHECK(tree.GetMax() == *expected.rbegin());
+			CHECK(*std::prev(tree.end()) == *expected.rbegin());
+		}
+	}
+
+	tree.clear();
+	tree.append(5);
+	CHECK(tree.GetMin() == 5);
+	CHECK(tree.GetMax() == 5);
+}
+
+TEST_CASE("Split, join and union of the trees")
+{
+	// Every node keeps the AVL balance, its size, height and parent links
+	auto balanced = [](const AVLTree<int>& tree) {
+		if (tree.root && tree.root->parent)
+			return false;
+		size_t nodes = 0;
+		for (auto it = tree.begin(); it != tree.end(); ++it, nodes++) {
+			auto* node = it.node;
+			if (std::abs(tree.getBalance(node)) > 1 ||
+				node->height != 1 + std::max(tree.height(node->left), tree.height(node->right)) ||
+				node->size != 1 + tree.subtreeSize(node->left) + tree.subtreeSize(node->right) ||
+				(node->left && node->left->parent != node) || (node->right && node->right->parent != node))
+				return false;
+		}
+		return nodes == tree.Size();
+	};
+
+	std::mt19937 mersenne(7);
+	AVLTree<int> tree;
+	std::set<int> expected;
+	for (int i = 0; i < 3000; i++) {
+		int value = int(mersenne() % 10000);
+		tree.append(value);
+		expected.insert(value);
+	}
+
+	for (int key : { -1, 0, 2500, 5000, *expected.rbegin(), 20000 }) {
+		auto parts = tree.Split(key);
+		CHECK(tree.isEmpty());
+		CHECK(balanced(parts.first));
+		CHECK(balanced(parts.second));
+		CHECK(std::equal(parts.first.begin(), parts.first.end(), expected.begin(), expected.lower_bound(key)));
+		CHECK(std::equal(parts.second.begin(), parts.second.end(), expected.lower_bound(key), expected.end()));
+
+		// Parts are separate trees with their own allocators
+		parts.first.append(-100);
+		parts.second.append(30000);
+		CHECK(parts.first.GetMin() == -100);
+		CHECK(parts.second.GetMax() == 30000);
+		parts.first.remove(-100);
+		parts.second.PopMax();
+
+		tree = AVLTree<int>::Join(std::move(parts.first), std::move(parts.second));
+		CHECK(balanced(tree));
+		REQUIRE(tree.Size() == expected.size());
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+	}
+
+	// Trees of very different heights
+	AVLTree<int> low;
+	low.append(-1);
+	tree = AVLTree<int>::Join(std::move(low), std::move(tree));
+	CHECK(balanced(tree));
+	CHECK(tree.GetMin() == -1);
+	tree.remove(-1);
+
+	AVLTree<int> overlapping;
+	overlapping.append(5000);
+	CHECK_THROWS_AS(AVLTree<int>::Join(std::move(overlapping), tree.Split(1000).second), const std::invalid_argument&);
+
+	std::set<int> first_expected, second_expected;
+	{
+		AVLTree<int> first, second;
+		for (int i = 0; i < 2000; i++) {
+			int value = int(mersenne() % 5000);
+			first.append(value);
+			first_expected.insert(value);
+		}
+		for (int i = 0; i < 300; i++) {
+			int value = int(mersenne() % 10000);
+			second.append(value);
+			second_expected.insert(value);
+		}
+		tree = AVLTree<int>::Union(std::move(first), std::move(second));
+	}
+	// Nodes of the united trees outlive them
+	std::set<int> united = first_expected;
+	united.insert(second_expected.begin(), second_expected.end());
+	CHECK(balanced(tree));
+	REQUIRE(tree.Size() == united.size());
+	CHECK(std::equal(tree.begin(), tree.end(), united.begin(), united.end()));
+	CHECK(tree.GetMax() == *united.rbegin());
+
+	for (int value : second_expected)
+		tree.remove(value);
+	CHECK(balanced(tree));
+	CHECK(tree.Size() == united.size() - second_expected.size());
+
+	tree = AVLTree<int>::Union(std::move(tree), AVLTree<int>());
+	CHECK(balanced(tree));
+	tree.clear();
+	CHECK(tree.isEmpty());
+}
+
+TEST_CASE("Parallel bulk build and set operations")
+{
+	auto balanced = [](const AVLTree<int>& tree) {
+		size_t nodes = 0;
+		for (auto it = tree.begin(); it != tree.end(); ++it, nodes++) {
+			auto* node = it.node;
+			if (std::abs(tree.getBalance(node)) > 1 ||
+				node->size != 1 + tree.subtreeSize(node->left) + tree.subtreeSize(node->right) ||
+				(node->left && node->left->parent != node) || (node->right && node->right->parent != node))
+				return false;
+		}
+		return nodes == tree.Size() && (!tree.root || !tree.root->parent);
+	};
+
+	TaskPool tasks(4);
+	std::mt19937 mersenne(7);
+	std::vector<int> first_elements, second_elements;
+	for (int i = 0; i < 100000; i++)
+		first_elements.push_back(int(mersenne() % 200000));
+	for (int i = 0; i < 60000; i++)
+		second_elements.push_back(int(mersenne() % 300000));
+
+	// Same tree as the sequential bulk build
+	AVLTree<int> sequential, parallel;
+	sequential.AppendRange(first_elements);
+	parallel.append(-1);
+	parallel.AppendRange(first_elements, tasks);
+	CHECK(balanced(parallel));
+	CHECK(parallel.root->height == sequential.root->height);
+	CHECK(parallel.GetMin() == -1);
+	parallel.remove(-1);
+	REQUIRE(parallel.Size() == sequential.Size());
+	CHECK(std::equal(parallel.begin(), parallel.end(), sequential.begin(), sequential.end()));
+
+	std::set<int> first(first_elements.begin(), first_elements.end());
+	std::set<int> second(second_elements.begin(), second_elements.end());
+	std::vector<int> united, common, difference;
+	std::set_union(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(united));
+	std::set_intersection(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(common));
+	std::set_difference(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(difference));
+
+	auto build = [&](const std::vector<int>& elements) {
+		AVLTree<int> tree;
+		tree.AppendRange(elements, tasks);
+		return tree;
+	};
+
+	for (TaskPool* pool : { (TaskPool*)nullptr, &tasks }) {
+		AVLTree<int> result = pool ?
+			AVLTree<int>::Union(build(first_elements), build(second_elements), *pool) :
+			AVLTree<int>::Union(build(first_elements), build(second_elements));
+		CHECK(balanced(result));
+		CHECK(std::equal(result.begin(), result.end(), united.begin(), united.end()));
+
+		result = AVLTree<int>::Intersection(build(first_elements), build(second_elements), pool);
+		CHECK(balanced(result));
+		CHECK(std::equal(result.begin(), result.end(), common.begin(), common.end()));
+
+		result = AVLTree<int>::Difference(build(first_elements), build(second_elements), pool);
+		CHECK(balanced(result));
+		CHECK(std::equal(result.begin(), result.end(), difference.begin(), difference.end()));
+
+		// Nodes of the built halves are owned by the result
+		result.append(-5);
+		result.remove(difference[difference.size() / 2]);
+		CHECK(result.Size() == difference.size());
+		CHECK(balanced(result));
+	}
+
+	AVLTree<int> empty = AVLTree<int>::Intersection(build(first_elements), AVLTree<int>(), &tasks);
+	CHECK(empty.isEmpty());
+	CHECK(AVLTree<int>::Difference(AVLTree<int>(), build(second_elements), &tasks).isEmpty());
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+	AVLPriorityQueue<int> q;
+
+	for (int i = 0; i < 300; i++)
+		q.Insert(i, i % 3);
+	std::vector<Item<int>> items;
+	for (int i = 300; i < 600; i++)
+		items.push_back(Item<int>(i, i % 3));
+	q.InsertRange(items.begin(), items.end());
+	CHECK(q.tree.Size() == 3);
+
+	std::vector<int> popped;
+	q.PopN(50, popped);
+	q.Insert(600, 2);
+	while (popped.size() < 601)
+		popped.push_back(q.Pop());
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	CHECK(popped[0] == 2);
+	CHECK(popped[199] == 599);
+	CHECK(popped[200] == 600);
+	for (size_t i = 1; i < popped.size(); i++) {
+		if (popped[i - 1] % 3 == popped[i] % 3)
+			CHECK(popped[i - 1] < popped[i]);
+	}
+}
+
+TEST_CASE("Pop several elements takes whole buckets")
+{
+	AVLPriorityQueue<int> q;
+	for (int i = 0; i < 50; i++)
+		q.Insert(i, i % 10);
+
+	// Buckets of 9 and 8 are removed at once, the bucket of 7 gives two elements and stays
+	std::vector<int> popped;
+	CHECK(q.PopN(12, popped) == 12);
+	CHECK(popped == std::vector<int>{ 9, 19, 29, 39, 49, 8, 18, 28, 38, 48, 7, 17 });
+	CHECK(q.tree.Size() == 8);
+	CHECK(q.tree.GetMax().Size() == 3);
+
+	CHECK(q.Pop() == 27);
+	popped.clear();
+	CHECK(q.PopN(100, popped) == 37);
+	CHECK(popped.front() == 37);
+	CHECK(popped.back() == 40);
+	CHECK(q.tree.isEmpty());
+	CHECK(q.PopN(5, popped) == 0);
+}
+
+TEST_CASE("Tree statistics")
+{
+	AVLTree<int> tree;
+	CHECK(tree.Stats().max_depth == 0);
+
+	for (int value = 1; value <= 7; value++)
+		tree.append(value);
+	TreeStats stats = tree.Stats();
+	// Ascending keys are rotated into the perfect tree
+	CHECK(stats.rotations == 4);
+	CHECK(stats.max_depth == 3);
+	CHECK(stats.average_depth == doctest::Approx(17.0 / 7));
+
+#ifdef TREE_STATS
+	CHECK(stats.allocations == 7);
+	CHECK(stats.comparisons == 2 * (0 + 1 + 2 + 2 + 3 + 3 + 3));
+
+	AVLPriorityQueue<int> q;
+	for (int i = 0; i < 100; i++)
+		q.Insert(i, i % 10);
+	// Equal priorities share the bucket, the tree has only 10 nodes
+	CHECK(q.Stats().allocations == 10);
+#endif
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+	AVLPriorityQueue<CopyCounter> q;
+	CopyCounter::copies = 0;
+
+	q.Insert(CopyCounter(1111), 1);
+	q.Insert(CopyCounter(2222), 10);
+	q.Emplace(5, 3333);
+
+	std::vector<Item<CopyCounter>> items;
+	items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+	items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+	q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+	CHECK(q.Pop().value == 2222);
+	CHECK(q.Pop().value == 4444);
+
+	std::vector<CopyCounter> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped[0].value == 3333);
+	CHECK(popped[1].value == 5555);
+	CHECK(popped[2].value == 1111);
+
+	CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Ascending keys don't overflow the stack")
+{
+	const int kKeys = 10000000;
+	AVLTree<int, NewDeleteAllocator> tree;
+
+	for (int i = 0; i < kKeys; i++)
+		tree.append(i);
+	CHECK(tree.Size() == size_t(kKeys));
+	CHECK(tree.root->height <= 35);
+	CHECK(tree.GetElem(kKeys - 1));
+	CHECK(tree.GetElementsByInterval(kKeys - 3, kKeys + 3).size() == 3);
+
+	for (int i = 0; i < kKeys; i += 2)
+		tree.remove(i);
+	CHECK(tree.PopMax() == kKeys - 1);
+
+	std::vector<int> elements;
+	tree.InOrder(elements);
+	CHECK(elements.size() == size_t(kKeys) / 2 - 1);
+	CHECK(std::is_sorted(elements.begin(), elements.end()));
+	CHECK(tree.root->parent == nullptr);
+
+	tree.clear();
+	CHECK(tree.isEmpty());
+}
+
+TEST_CASE("Lazy deletion keeps the emptied buckets")
+{
+	AVLPriorityQueue<int> q;
+	CHECK_THROWS_AS(q.SetLazyDeletion(true, 1.5), const std::invalid_argument&);
+
+	for (int i = 0; i < 10; i++)
+		q.Insert(i, i);
+	q.SetLazyDeletion(true, 0.5);
+
+	CHECK(q.Pop() == 9);
+	CHECK(q.Pop() == 8);
+	CHECK(q.tree.Size() == 10);
+	CHECK(q.Stats().tombstones == 2);
+
+	// Inserted priority revives its bucket
+	q.Insert(90, 9);
+	CHECK(q.Stats().tombstones == 1);
+	CHECK(q.Peek() == 90);
+	CHECK(q.Pop() == 90);
+
+	// The top is found below the tombstones
+	CHECK(q.Peek() == 7);
+	CHECK(q.Pop() == 7);
+	CHECK(q.Pop() == 6);
+	CHECK(q.Pop() == 5);
+	CHECK(q.Stats().compactions == 0);
+
+	// Tombstones take more than a half of the nodes, the tree is rebuilt
+	CHECK(q.Pop() == 4);
+	CHECK(q.Stats().compactions == 1);
+	CHECK(q.Stats().tombstones == 0);
+	CHECK(q.tree.Size() == 4);
+
+	q.SetLazyDeletion(false);
+	std::vector<int> popped;
+	CHECK(q.PopN(5, popped) == 4);
+	CHECK(popped == std::vector<int>{ 3, 2, 1, 0 });
+	CHECK(q.tree.isEmpty());
+}
+
+TEST_CASE("Lazy deletion pops as the eager one")
+{
+	AVLPriorityQueue<int> lazy, eager;
+	lazy.SetLazyDeletion(true, 0.2);
+	std::mt19937 mersenne(7);
+
+	for (int i = 0; i < 20000; i++) {
+		switch (mersenne() % 4)
+		{
+		case 0:
+		{
+			std::vector<Item<int>> items;
+			for (int j = 0; j < 8; j++)
+				items.push_back(Item<int>(i * 8 + j, int(mersenne() % 64)));
+			lazy.InsertRange(items.begin(), items.end());
+			eager.InsertRange(items.begin(), items.end());
+			break;
+		}
+		case 1:
+		{
+			int priority = int(mersenne() % 64);
+			lazy.Insert(i, priority);
+			eager.Insert(i, priority);
+			break;
+		}
+		default:
+			if (eager.isEmpty())
+				CHECK_THROWS_AS(lazy.Pop(), const std::underflow_error&);
+			else {
+				CHECK(lazy.Peek() == eager.Peek());
+				CHECK(lazy.Pop() == eager.Pop());
+			}
+			break;
+		}
+		if (i == 10000)
+			lazy.SetLazyDeletion(false);
+		if (i == 15000)
+			lazy.SetLazyDeletion(true, 0.9);
+	}
+	CHECK(lazy.Stats().compactions > 0);
+
+	std::vector<int> lazy_popped, eager_popped;
+	lazy.PopN(100000, lazy_popped);
+	eager.PopN(100000, eager_popped);
+	CHECK(lazy_popped == eager_popped);
+	CHECK(lazy.isEmpty());
+}
+
+TEST_CASE("Save and load")
+{
+	AVLPriorityQueue<int> q;
+	q.SetLazyDeletion(true);
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	q.Insert(4444, 7);
+	q.Insert(5555, 5);
+
+	// The emptied bucket stays in the tree, it isn't saved
+	CHECK(q.Pop() == 2222);
+
+	std::stringstream stream;
+	q.Save(stream);
+
+	AVLPriorityQueue<int> loaded;
+	loaded.Load(stream);
+	CHECK(loaded.Stats().tombstones == 0);
+
+	// Both queues pop the same elements in the same order
+	for (int value : { 4444, 3333, 5555, 1111 }) {
+		CHECK(loaded.Pop() == value);
+		CHECK(q.Pop() == value);
+	}
+	CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
 #endif
\ No newline at end of file
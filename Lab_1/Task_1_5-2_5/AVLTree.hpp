@@ -2,7 +2,21 @@
 
 
 #include <random>
+#include <iostream>
+#include <cstddef>
 #include <list>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+#include <memory>
+
+#include "NodePool.hpp"
+#include "TreeRange.hpp"
+#include "TaskPool.hpp"
+#include "tree_stats.h"
 
  // For private methods unit testing
 #ifdef _DEBUG
@@ -12,7 +26,8 @@
 
 /// @brief Class to store comparative values
 /// @tparam T 
-template<typename T>
+/// @tparam Allocator Allocator of the tree nodes, NodePool by default
+template<typename T, template<typename> class Allocator = NodePool>
 class AVLTree
 {
 private:
@@ -21,13 +36,42 @@ private:
         T data;;
         Node* left = nullptr;
         Node* right = nullptr;
+        Node* parent = nullptr;
+        size_t size = 1; // number of nodes in the subtree
         int height;
 
         Node(T data)
-            : data(data), height(1) {}
+            : data(std::move(data)), height(1) {}
     };
 
+    using Pool = StatsPool<Allocator<Node>>;
+
+    // Split, Join and Union move nodes between the trees, so the allocators are shared:
+    // a tree allocates its new nodes from pool and keeps alive the allocators of the nodes
+    // it has taken from the other trees in borrowed
+    std::shared_ptr<Pool> pool = std::make_shared<Pool>();
+    std::vector<std::shared_ptr<Pool>> borrowed;
     Node* root = nullptr;
+    size_t count = 0;
+    // Extreme nodes are cached, so GetMax/GetMin and PopMax don't walk down the tree
+    Node* min_node = nullptr;
+    Node* max_node = nullptr;
+    size_t rotations = 0;
+
+    // Subtrees and ranges smaller than this are not split between the threads
+    static constexpr size_t kParallelGrain = 1 << 14;
+
+    static size_t subtreeSize(Node* node)
+    {
+        return node ? node->size : 0;
+    }
+
+    /// @brief Compares the elements, counted when TREE_STATS is defined
+    bool less(const T& left, const T& right) const
+    {
+        TREE_STATS_COUNT(*pool, comparisons);
+        return left < right;
+    }
 
     int height(Node* node) const
     {
@@ -36,7 +80,8 @@ private:
         return node->height;
     }
 
-    /// @brief Right rotates subtree rooted with y
+    /// @brief Right rotates subtree rooted with y.
+    /// The new subtree root takes over the parent of y, the caller links it to the parent
     /// @param y Subtree to rotate
     /// @return Link to the root of the rotated subtree
     Node* rightRotate(Node* y)
@@ -47,13 +92,23 @@ private:
         x->right = y;
         y->left = T2;
 
+        x->parent = y->parent;
+        y->parent = x;
+        if (T2)
+            T2->parent = y;
+
+        x->size = y->size;
+        y->size = 1 + subtreeSize(y->left) + subtreeSize(y->right);
+
         y->height = std::max(height(y->left), height(y->right)) + 1;
         x->height = std::max(height(x->left), height(x->right)) + 1;
 
+        rotations++;
         return x;
     };
 
-    /// @brief Left rotates subtree rooted with y
+    /// @brief Left rotates subtree rooted with y.
+    /// The new subtree root takes over the parent of x, the caller links it to the parent
     /// @param x Subtree to rotate
     /// @return Link to the root of the rotated subtree
     Node* leftRotate(Node* x)
@@ -64,11 +119,20 @@ private:
         y->left = x;
         x->right = T2;
 
+        y->parent = x->parent;
+        x->parent = y;
+        if (T2)
+            T2->parent = x;
+
+        y->size = x->size;
+        x->size = 1 + subtreeSize(x->left) + subtreeSize(x->right);
+
         x->height = std::max(height(x->left),
             height(x->right)) + 1;
         y->height = std::max(height(y->left),
             height(y->right)) + 1;
 
+        rotations++;
         return y;
     }
 
@@ -82,47 +146,35 @@ private:
         return height(node->left) - height(node->right);
     }
 
-    /// @brief Recursive function to insert a key in the subtree
+    /// @brief Updates height of the node and rotates it if it became unbalanced
     /// @param node Subtree root
-    /// @param data Value to insert
-    /// @return The new root of the subtree
-    Node* insert(Node* node, T data)
+    /// @return New subtree root
+    Node* rebalance(Node* node)
     {
-        if (!node)
-            return new Node(data);
-
-        if (data < node->data)
-            node->left = insert(node->left, data);
-        else if (data > node->data)
-            node->right = insert(node->right, data);
-        else
-            return node;
-
+        // Updating height
         node->height = 1 + std::max(height(node->left), height(node->right));
 
-
+        // Checking if balanced
         int balance = getBalance(node);
 
-        // If this node becomes unbalanced, then
-        // there are 4 cases
-
         // Left Left Case
-        if (balance > 1 && data < node->left->data)
+        if (balance > 1 && getBalance(node->left) >= 0)
             return rightRotate(node);
 
-        // Right Right Case
-        if (balance < -1 && data > node->right->data)
-            return leftRotate(node);
-
         // Left Right Case
-        if (balance > 1 && data > node->left->data)
+        if (balance > 1 &&
+            getBalance(node->left) < 0)
         {
             node->left = leftRotate(node->left);
             return rightRotate(node);
         }
 
+        // Right Right Case
+        if (balance < -1 && getBalance(node->right) <= 0)
+            return leftRotate(node);
+
         // Right Left Case
-        if (balance < -1 && data < node->right->data)
+        if (balance < -1 && getBalance(node->right) > 0)
         {
             node->right = rightRotate(node->right);
             return leftRotate(node);
@@ -131,246 +183,1024 @@ private:
         return node;
     }
 
-    Node* minValueNode(Node* node) const
+    /// @brief Puts new child to the place of the old one
+    /// @param parent Parent of the old child, nullptr if the old child is the root
+    /// @param old_child Replaced node
+    /// @param new_child Node to link, may be nullptr
+    void replaceChild(Node* parent, Node* old_child, Node* new_child)
+    {
+        if (!parent)
+            root = new_child;
+        else if (parent->left == old_child)
+            parent->left = new_child;
+        else
+            parent->right = new_child;
+
+        if (new_child)
+            new_child->parent = parent;
+    }
+
+    /// @brief Rebalances the nodes on the path from the node up to the root.
+    /// Stops as soon as a subtree keeps its height without rotations, as the ancestors stay the same
+    /// @param node The lowest node which subtree has changed
+    void rebalanceUp(Node* node)
+    {
+        while (node) {
+            Node* parent = node->parent;
+            int old_height = node->height;
+            Node* subtree = rebalance(node);
+            if (subtree == node && node->height == old_height)
+                return;
+
+            replaceChild(parent, node, subtree);
+            node = parent;
+        }
+    }
+
+    /// @brief Unlinks the node with at most one child, destroys it and restores the balance
+    /// @param node Node to remove
+    void unlink(Node* node)
+    {
+        if (node == min_node)
+            min_node = successor(node);
+        if (node == max_node)
+            max_node = predecessor(node);
+
+        Node* parent = node->parent;
+        for (Node* ancestor = parent; ancestor; ancestor = ancestor->parent)
+            ancestor->size--;
+
+        replaceChild(parent, node, node->left ? node->left : node->right);
+        pool->Destroy(node);
+        count--;
+        rebalanceUp(parent);
+    }
+
+    static Node* minValueNode(Node* node)
     {
         Node* current = node;
-        while (current->left != nullptr)
+        while (current && current->left != nullptr)
         current = current->left;
  
         return current;
     }
 
-    /// @brief Removes node with the specified value, recursively
-    /// @param node Current subtree node
-    /// @param data Value to remove
-    /// @return New subtree root
-    Node* deleteNode(Node* node, T data)
+    static Node* maxValueNode(Node* node)
     {
-        if (!node)
-            return node;
+        Node* current = node;
+        while (current && current->right != nullptr)
+            current = current->right;
+
+        return current;
+    }
+
+    /// @brief Finds the next node in sorted order using the parent links
+    /// @param node Current node
+    /// @return Next node, nullptr for the maximum one
+    static Node* successor(Node* node)
+    {
+        if (node->right)
+            return minValueNode(node->right);
+
+        while (node->parent && node == node->parent->right)
+            node = node->parent;
+        return node->parent;
+    }
+
+    /// @brief Finds the previous node in sorted order using the parent links
+    /// @param node Current node
+    /// @return Previous node, nullptr for the minimum one
+    static Node* predecessor(Node* node)
+    {
+        if (node->left)
+            return maxValueNode(node->left);
 
-        if (data < node->data)
-            node->left = deleteNode(node->left, data);
+        while (node->parent && node == node->parent->left)
+            node = node->parent;
+        return node->parent;
+    }
 
-        else if (data > node->data)
-            node->right = deleteNode(node->right, data);
+    /// @brief Inserts a key into the tree and rebalances the path to the root
+    /// @param data Value to insert, it is moved into the new node
+    void insert(T& data)
+    {
+        Node* parent = nullptr;
+        Node* node = root;
+        // Side of the parent the new node goes to, so the element isn't compared again
+        bool to_left = false;
+        while (node) {
+            parent = node;
+            to_left = less(data, node->data);
+            if (to_left)
+                node = node->left;
+            else if (less(node->data, data))
+                node = node->right;
+            else {
+                // Already present, the sizes counted on the way down are restored
+                for (node = node->parent; node; node = node->parent)
+                    node->size--;
+                return;
+            }
+            parent->size++;
+        }
 
+        node = pool->Create(std::move(data));
+        node->parent = parent;
+        // A new extreme node is always linked below the old one
+        if (!min_node || (parent == min_node && to_left))
+            min_node = node;
+        if (!max_node || (parent == max_node && !to_left))
+            max_node = node;
+        count++;
+        if (!parent) {
+            root = node;
+            return;
+        }
+
+        if (to_left)
+            parent->left = node;
         else
+            parent->right = node;
+
+        rebalanceUp(parent);
+    }
+
+    /// @brief Removes node with the specified value
+    /// @param data Value to remove
+    void deleteNode(const T& data)
+    {
+        Node* node = search(data);
+        if (!node)
+            return;
+
+        if (node->left && node->right)
         {
-            // node with only one child or no child
-            if (!(node->left) || !(node->right))
-            {
-                Node* temp = node->left ?
-                    node->left :
-                    node->right;
-
-                // No child case
-                if (!temp)
-                {
-                    temp = node;
-                    node = nullptr;
-                }
-                else // One child case
-                    *node = *temp;
-                delete temp;
-            }
+            // node with two children
+            // successor (smallest in the right subtree) replaces the deleted value
+            Node* next = minValueNode(node->right);
+            node->data = std::move(next->data);
+            node = next;
+        }
+        unlink(node);
+    }
+
+    /// @brief Searches specified value
+    /// @param data Value to find
+    /// @return Found node, nullptr if there is no such value
+    Node* search(const T& data) const
+    {
+        Node* node = root;
+        while (node) {
+            if (less(data, node->data))
+                node = node->left;
+            else if (less(node->data, data))
+                node = node->right;
             else
-            {
-                // node with two children
-                // successor (smallest in the right subtree)
-                Node* temp = minValueNode(node->right);
+                break;
+        }
+        return node;
+    }
 
-                node->data = temp->data;
+    /// @brief Searches the first node not less than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are less
+    Node* lowerBound(const T& data) const
+    {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (less(node->data, data))
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
 
-                // Delete the inorder successor
-                node->right = deleteNode(node->right, temp->data);
+    /// @brief Searches the first node greater than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are not greater
+    Node* upperBound(const T& data) const
+    {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (!less(data, node->data))
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
             }
         }
+        return found;
+    }
 
-        // If the tree had only one node
-        if (!node)
-            return node;
+    /// @brief Counts elements not greater than the value
+    size_t countNotGreater(const T& data) const
+    {
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (!less(data, node->data)) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
 
-        // Updating height
+    /// @brief Moves all elements out of the tree in sorted order.
+    /// Nodes are left with moved-from values and must be cleared afterwards
+    /// @param elements Container to move elements to
+    void moveOut(std::vector<T>& elements)
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(std::move(node->data));
+    }
+
+    /// @brief Builds balanced subtree from the sorted range.
+    /// Recursion depth is only log N, as the built subtree is balanced
+    /// @param first First element of the range
+    /// @param last Element after the last one of the range
+    /// @return Root of the built subtree
+    Node* buildBalanced(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last)
+    {
+        if (first == last)
+            return nullptr;
+
+        auto middle = first + (last - first) / 2;
+        Node* node = pool->Create(std::move(*middle));
+        node->left = buildBalanced(first, middle);
+        node->right = buildBalanced(middle + 1, last);
+        if (node->left)
+            node->left->parent = node;
+        if (node->right)
+            node->right->parent = node;
+        node->size = 1 + subtreeSize(node->left) + subtreeSize(node->right);
         node->height = 1 + std::max(height(node->left), height(node->right));
+        return node;
+    }
 
-        // Checking if balanced
-        int balance = getBalance(node);
+    /// @brief Delete all elements of the subtree without recursion:
+    /// left children are rotated up until the node has none and can be destroyed
+    /// @param node Subtree root
+    void clearSubtree(Node* node) {
+        while (node) {
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else {
+                Node* right = node->right;
+                pool->Destroy(node);
+                node = right;
+            }
+        }
+    }
 
-        // Left Left Case
-        if (balance > 1 && getBalance(node->left) >= 0)
-            return rightRotate(node);
+    /// @brief Links the children to the node and updates its size and height
+    void link(Node* node, Node* left, Node* right)
+    {
+        node->left = left;
+        node->right = right;
+        if (left)
+            left->parent = node;
+        if (right)
+            right->parent = node;
+        node->size = 1 + subtreeSize(left) + subtreeSize(right);
+        node->height = 1 + std::max(height(left), height(right));
+    }
 
-        // Left Right Case
-        if (balance > 1 &&
-            getBalance(node->left) < 0)
-        {
-            node->left = leftRotate(node->left);
-            return rightRotate(node);
+    /// @brief Joins two subtrees and the node between them: elements of the left subtree
+    /// are less than the node, elements of the right one are greater.
+    /// Descends the spine of the higher subtree to the height of the lower one
+    /// and rotates on the way back, O(difference of the heights)
+    /// @return Root of the joined subtree, its parent link is not set
+    Node* join(Node* left, Node* middle, Node* right)
+    {
+        if (height(left) > height(right) + 1)
+            return joinRight(left, middle, right);
+        if (height(right) > height(left) + 1)
+            return joinLeft(left, middle, right);
+        link(middle, left, right);
+        return middle;
+    }
+
+    /// @brief Joins the lower right subtree into the right spine of the left one
+    Node* joinRight(Node* left, Node* middle, Node* right)
+    {
+        Node* spine = left->right;
+        if (height(spine) <= height(right) + 1) {
+            link(middle, spine, right);
+            if (height(middle) <= height(left->left) + 1) {
+                link(left, left->left, middle);
+                return left;
+            }
+            link(left, left->left, rightRotate(middle));
+            return leftRotate(left);
         }
 
-        // Right Right Case
-        if (balance < -1 && getBalance(node->right) <= 0)
-            return leftRotate(node);
+        Node* joined = joinRight(spine, middle, right);
+        link(left, left->left, joined);
+        if (height(joined) <= height(left->left) + 1)
+            return left;
+        return leftRotate(left);
+    }
 
-        // Right Left Case
-        if (balance < -1 && getBalance(node->right) > 0)
-        {
-            node->right = rightRotate(node->right);
-            return leftRotate(node);
+    /// @brief Joins the lower left subtree into the left spine of the right one
+    Node* joinLeft(Node* left, Node* middle, Node* right)
+    {
+        Node* spine = right->left;
+        if (height(spine) <= height(left) + 1) {
+            link(middle, left, spine);
+            if (height(middle) <= height(right->right) + 1) {
+                link(right, middle, right->right);
+                return right;
+            }
+            link(right, leftRotate(middle), right->right);
+            return rightRotate(right);
         }
 
-        return node;
+        Node* joined = joinLeft(left, middle, spine);
+        link(right, joined, right->right);
+        if (height(joined) <= height(right->right) + 1)
+            return right;
+        return rightRotate(right);
     }
 
-    /// @brief Searches specified value recursively
-    /// @param node Current subtree root
-    /// @param data Value to find
-    /// @return New subtree root
-    Node* search(Node* node, T data) const
+    /// @brief Takes the maximum node out of the not empty subtree
+    /// @param last Set to the taken node
+    /// @return Root of the rest of the subtree
+    Node* splitLast(Node* node, Node*& last)
+    {
+        if (!node->right) {
+            last = node;
+            return node->left;
+        }
+        Node* rest = splitLast(node->right, last);
+        return join(node->left, node, rest);
+    }
+
+    /// @brief Joins two subtrees, all elements of the left one are less than the right ones
+    Node* join(Node* left, Node* right)
     {
-        if (node == nullptr || node->data == data)
-            return node;
+        if (!left)
+            return right;
+        if (!right)
+            return left;
+        Node* last = nullptr;
+        Node* rest = splitLast(left, last);
+        return join(rest, last, right);
+    }
 
-        if (node->data < data)
-            return search(node->right, data);
+    /// @brief Splits the subtree by the key into balanced subtrees, O(height).
+    /// Every node on the search path is joined to one of the parts
+    /// @param left Set to the subtree of the elements less than the key
+    /// @param right Set to the subtree of the elements not less than the key
+    /// @param equal If not nullptr, the node equal to the key is taken out to it instead of the right part
+    void split(Node* node, const T& key, Node*& left, Node*& right, Node** equal)
+    {
+        if (!node) {
+            left = right = nullptr;
+            return;
+        }
 
-        return search(node->left, data);
+        Node* node_left = node->left;
+        Node* node_right = node->right;
+        if (less(node->data, key)) {
+            Node* less_right = nullptr;
+            split(node_right, key, less_right, right, equal);
+            left = join(node_left, node, less_right);
+        }
+        else if (equal && !less(key, node->data)) {
+            *equal = node;
+            left = node_left;
+            right = node_right;
+        }
+        else {
+            Node* greater_left = nullptr;
+            split(node_left, key, left, greater_left, equal);
+            right = join(greater_left, node, node_right);
+        }
     }
 
-    /// @brief Searching data by elements range recursively
-    /// @param node Current subtree node
-    /// @param interval Storage to save found values
-    /// @param min Min value
-    /// @param max Max value
-    void searchElementsByInterval(Node* node, std::list<T>& interval, T& min, T& max) const
+    /// @brief Operation on two subtrees of the tree nodes, see unite, intersect and subtract
+    using Operation = Node* (AVLTree::*)(Node*, Node*, TaskPool*);
+
+    /// @brief Runs the operation on both pairs of halves, in parallel for the large subtrees.
+    /// Each parallel half runs in its own tree, as the allocator and the counters are not thread-safe.
+    /// The operations only destroy nodes, so the trees of the halves keep no nodes afterwards
+    /// @param tasks Task pool, nullptr to run in this thread
+    void forkHalves(Operation operation, Node* first_left, Node* second_left, Node*& left,
+        Node* first_right, Node* second_right, Node*& right, TaskPool* tasks)
     {
-        if (!node)
+        size_t size = subtreeSize(first_left) + subtreeSize(second_left) +
+            subtreeSize(first_right) + subtreeSize(second_right);
+        if (!tasks || tasks->Threads() == 1 || size < kParallelGrain) {
+            left = (this->*operation)(first_left, second_left, tasks);
+            right = (this->*operation)(first_right, second_right, tasks);
             return;
+        }
 
-        if (min < node->data)
-            searchElementsByInterval(node->left, interval, min, max);
+        AVLTree left_tree, right_tree;
+        tasks->Invoke([&]() { left = (left_tree.*operation)(first_left, second_left, tasks); },
+            [&]() { right = (right_tree.*operation)(first_right, second_right, tasks); });
+        rotations += left_tree.rotations + right_tree.rotations;
+    }
+
+    /// @brief Unites two subtrees: the second one is split by the root of the first one
+    /// and the halves are united recursively, O(M log(N / M + 1)) for the sizes M <= N.
+    /// Nodes of the second subtree equal to the first one's are destroyed
+    Node* unite(Node* first, Node* second, TaskPool* tasks)
+    {
+        if (!first)
+            return second;
+        if (!second)
+            return first;
+
+        Node* left = nullptr, *right = nullptr, *equal = nullptr;
+        split(second, first->data, left, right, &equal);
+        if (equal)
+            pool->Destroy(equal);
+
+        forkHalves(&AVLTree::unite, first->left, left, left, first->right, right, right, tasks);
+        return join(left, first, right);
+    }
+
+    /// @brief Keeps the nodes of the first subtree equal to the second one's, all other nodes are destroyed
+    Node* intersect(Node* first, Node* second, TaskPool* tasks)
+    {
+        if (!first || !second) {
+            clearSubtree(first);
+            clearSubtree(second);
+            return nullptr;
+        }
 
-        if (min <= node->data && max >= node->data)
-            interval.push_back(node->data);
+        Node* left = nullptr, *right = nullptr, *equal = nullptr;
+        split(second, first->data, left, right, &equal);
 
-        searchElementsByInterval(node->right, interval, min, max);
+        forkHalves(&AVLTree::intersect, first->left, left, left, first->right, right, right, tasks);
+        if (equal) {
+            pool->Destroy(equal);
+            return join(left, first, right);
+        }
+        pool->Destroy(first);
+        return join(left, right);
     }
 
-    void clearRecursive(Node* node) {
-        if (!node)
-            return;
+    /// @brief Keeps the nodes of the first subtree not equal to the second one's, all other nodes are destroyed
+    Node* subtract(Node* first, Node* second, TaskPool* tasks)
+    {
+        if (!first || !second) {
+            clearSubtree(second);
+            return first;
+        }
 
-        clearRecursive(node->left);
-        clearRecursive(node->right);
+        Node* left = nullptr, *right = nullptr, *equal = nullptr;
+        split(first, second->data, left, right, &equal);
+        if (equal)
+            pool->Destroy(equal);
 
-        delete node;
+        forkHalves(&AVLTree::subtract, left, second->left, left, right, second->right, right, tasks);
+        pool->Destroy(second);
+        return join(left, right);
     }
 
-    /// @brief Respresents tree as array, recursively
-    /// @param elements Container to save elements
-    /// @param node Current node
-    void InOrder(std::vector<T>& elements, Node* node = nullptr) const
+    /// @brief Runs the operation on the nodes of both trees
+    /// @return The first tree holding the result, the second one is left empty
+    static AVLTree combine(AVLTree first, AVLTree second, Operation operation, TaskPool* tasks)
     {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+        Node* second_root = first.takeNodes(second);
+        first.setRoot((first.*operation)(first.root, second_root, tasks));
+        return first;
+    }
 
-        if (node->left)
-            InOrder(elements, node->left);
-        elements.push_back(node->data);
-        if (node->right)
-            InOrder(elements, node->right);
+    /// @brief Builds balanced tree from the sorted range, the halves are built in parallel
+    /// in their own trees and joined under the middle element. The shape is the one of buildBalanced
+    static AVLTree buildParallel(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last,
+        TaskPool& tasks)
+    {
+        AVLTree left;
+        if (size_t(last - first) < kParallelGrain || tasks.Threads() == 1) {
+            left.setRoot(left.buildBalanced(first, last));
+            return left;
+        }
+
+        auto middle = first + (last - first) / 2;
+        AVLTree right;
+        tasks.Invoke([&]() { left = buildParallel(first, middle, tasks); },
+            [&]() { right = buildParallel(middle + 1, last, tasks); });
+
+        Node* right_root = left.takeNodes(right);
+        Node* node = left.pool->Create(std::move(*middle));
+        left.setRoot(left.join(left.root, node, right_root));
+        return left;
+    }
+
+    /// @brief Makes the subtree the content of the tree, recounts its size and extreme nodes
+    void setRoot(Node* node)
+    {
+        root = node;
+        if (root)
+            root->parent = nullptr;
+        count = subtreeSize(root);
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+    }
+
+    /// @brief Keeps the allocator alive while its nodes may be in the tree.
+    /// Allocators without memory hold no nodes, so resharding doesn't pile them up
+    void borrow(const std::shared_ptr<Pool>& owner)
+    {
+        if (owner != pool && owner->ReservedBytes() > 0 &&
+            std::find(borrowed.begin(), borrowed.end(), owner) == borrowed.end())
+            borrowed.push_back(owner);
+    }
+
+    /// @brief Keeps alive all allocators of the other tree
+    void borrowFrom(const AVLTree& other)
+    {
+        borrow(other.pool);
+        for (const std::shared_ptr<Pool>& owner : other.borrowed)
+            borrow(owner);
+    }
+
+    /// @brief Takes the nodes of the other tree, it is left empty
+    /// @return Root of the taken nodes
+    Node* takeNodes(AVLTree& other)
+    {
+        borrowFrom(other);
+        rotations += other.rotations;
+
+        Node* taken = other.root;
+        other.setRoot(nullptr);
+        return taken;
+    }
+
+    /// @brief Respresents tree as array
+    /// @param elements Container to save elements
+    void InOrder(std::vector<T>& elements) const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(node->data);
     }
 
 public:
+    /// @brief Bidirectional iterator over the elements in sorted order.
+    /// Steps along the parent links, so iterating doesn't allocate.
+    /// Elements can't be changed through it, as it would break the order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++()
+        {
+            node = successor(node);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        /// @brief Steps back, end() steps to the maximum element
+        const_iterator& operator--()
+        {
+            node = node ? predecessor(node) : tree->max_node;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class AVLTree;
+
+        const_iterator(Node* node, const AVLTree* tree)
+            : node(node), tree(tree) {}
+
+        Node* node = nullptr;
+        const AVLTree* tree = nullptr;
+    };
+
+    using iterator = const_iterator;
+    using range = TreeRange<const_iterator>;
+
+    AVLTree() {}
+
+    // Nodes belong to the tree, so it is moved instead of copying
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+
+    AVLTree(AVLTree&& other)
+    {
+        swap(other);
+    }
+
+    AVLTree& operator=(AVLTree&& other)
+    {
+        if (this != &other) {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(AVLTree& other)
+    {
+        std::swap(pool, other.pool);
+        std::swap(borrowed, other.borrowed);
+        std::swap(root, other.root);
+        std::swap(count, other.count);
+        std::swap(min_node, other.min_node);
+        std::swap(max_node, other.max_node);
+        std::swap(rotations, other.rotations);
+    }
 
     /// @brief Inserts value to the tree
     /// @param data Value to insert
-    /// @param node Current subtree node
-    void append(T data, AVLTree<T>::Node* node = nullptr)
+    void append(T data)
+    {
+        insert(data); // data is moved into the tree
+    }
+
+    /// @brief Inserts all elements at once: merges them with the tree content
+    /// and rebuilds the balanced tree in O(N + M log M).
+    /// As in append, elements equal to the already present ones are skipped
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements)
+    {
+        std::stable_sort(elements.begin(), elements.end());
+
+        std::vector<T> merged;
+        merged.reserve(count + elements.size());
+        moveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        clear();
+        root = buildBalanced(merged.begin(), merged.end());
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = merged.size();
+    }
+
+    /// @brief Inserts all elements at once on the task pool: sorts them with ParallelStableSort,
+    /// merges them with the tree content and builds the halves of the balanced tree in parallel.
+    /// The result is the same as of AppendRange
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements, TaskPool& tasks)
     {
-        root = insert(this->root, data); // appending recursively
+        ParallelStableSort(elements.begin(), elements.end(), tasks);
+
+        std::vector<T> merged;
+        merged.reserve(count + elements.size());
+        moveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        clear();
+        AVLTree built = buildParallel(merged.begin(), merged.end(), tasks);
+        built.rotations = rotations;
+        swap(built);
     }
 
     /// @brief Removes tree element with the specified value
     /// @param data Value to remove
-    void remove(T data)
+    void remove(const T& data)
+    {
+        deleteNode(data);
+    }
+
+    /// @brief Removes up to n maximum elements.
+    /// When a large part of the tree is removed, the rest is rebuilt in O(N)
+    /// instead of removing elements one by one
+    /// @param n Number of elements to remove
+    /// @param removed Container to append removed elements to, in descending order
+    /// @return Number of removed elements
+    size_t RemoveMaxN(size_t n, std::vector<T>& removed)
+    {
+        n = std::min(n, count);
+        size_t depth = 1;
+        while ((size_t(1) << depth) <= count)
+            depth++;
+
+        if (n * depth < count) {
+            for (size_t i = 0; i < n; i++)
+                removed.push_back(PopMax());
+            return n;
+        }
+
+        std::vector<T> elements;
+        elements.reserve(count);
+        moveOut(elements);
+        removed.insert(removed.end(),
+            std::make_move_iterator(elements.rbegin()), std::make_move_iterator(elements.rbegin() + n));
+
+        clear();
+        root = buildBalanced(elements.begin(), elements.end() - n);
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = elements.size() - n;
+        return n;
+    }
+
+    /// @brief Splits the tree by the key in O(log N) without copying elements.
+    /// The tree is left empty. The left part keeps its allocator, the right one
+    /// gets a new allocator for its new nodes, so each part can be given to its own thread
+    /// @param key Elements less than the key go to the left part
+    /// @return Trees of the elements less than the key and of the rest
+    std::pair<AVLTree, AVLTree> Split(const T& key)
+    {
+        std::pair<AVLTree, AVLTree> parts;
+        Node* left = nullptr, *right = nullptr;
+        split(root, key, left, right, nullptr);
+
+        parts.first.swap(*this);
+        parts.first.setRoot(left);
+        parts.second.borrowFrom(parts.first);
+        parts.second.setRoot(right);
+        return parts;
+    }
+
+    /// @brief Joins two trees in O(log N) without copying elements
+    /// @param left Tree of the lower elements
+    /// @param right Tree of the elements greater than all elements of the left one
+    /// @return Tree of all elements, the arguments are moved into it
+    /// @exception std::invalid_argument Thrown when the ranges of the trees overlap
+    static AVLTree Join(AVLTree left, AVLTree right)
+    {
+        if (!left.isEmpty() && !right.isEmpty() && !(left.GetMax() < right.GetMin()))
+            throw std::invalid_argument("Elements of the left tree must be less than the right ones");
+
+        Node* right_root = left.takeNodes(right);
+        left.setRoot(left.join(left.root, right_root));
+        return left;
+    }
+
+    /// @brief Unites two trees with any elements in O(M log(N / M + 1)) for the sizes M <= N,
+    /// the elements are not copied. As in append, equal elements are kept once
+    /// @return Tree of the elements of both trees, the arguments are moved into it
+    static AVLTree Union(AVLTree first, AVLTree second)
+    {
+        return combine(std::move(first), std::move(second), &AVLTree::unite, nullptr);
+    }
+
+    /// @brief Union of two trees on the task pool, the halves of the large subtrees are united in parallel
+    static AVLTree Union(AVLTree first, AVLTree second, TaskPool& tasks)
+    {
+        return combine(std::move(first), std::move(second), &AVLTree::unite, &tasks);
+    }
+
+    /// @brief Intersection of two trees in O(M log(N / M + 1)), the other elements are destroyed
+    /// @param tasks Task pool for the large trees, nullptr to run in this thread
+    /// @return Tree of the elements present in both trees, the arguments are moved into it
+    static AVLTree Intersection(AVLTree first, AVLTree second, TaskPool* tasks = nullptr)
+    {
+        return combine(std::move(first), std::move(second), &AVLTree::intersect, tasks);
+    }
+
+    /// @brief Difference of two trees in O(M log(N / M + 1)), the other elements are destroyed
+    /// @param tasks Task pool for the large trees, nullptr to run in this thread
+    /// @return Tree of the elements of the first tree absent from the second one
+    static AVLTree Difference(AVLTree first, AVLTree second, TaskPool* tasks = nullptr)
+    {
+        return combine(std::move(first), std::move(second), &AVLTree::subtract, tasks);
+    }
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    /// @return Number of rotations made since the tree was created
+    size_t Rotations() const
+    {
+        return rotations;
+    }
+
+    /// @return Operation counters and current depths of the tree, see TreeStats.
+    /// Rotations are counted in any build
+    TreeStats Stats() const
     {
-        this->root = deleteNode(this->root, data);
+        TreeStats stats;
+        CollectCounters(*pool, stats);
+        stats.rotations = rotations;
+        CollectDepths(root, stats);
+        return stats;
     }
 
-    bool GetElem(T data) const{
-        return search(this->root, data);
+    bool GetElem(const T& data) const{
+        return search(data);
     }
 
     std::list<T> GetElementsByInterval(T min, T max) const
     {
-        std::list<T> interval;
-        searchElementsByInterval(this->root, interval, min, max);
-        return interval;
+        range elements = Interval(min, max);
+        return std::list<T>(elements.begin(), elements.end());
     }
 
-    void print(Node* node = nullptr) const
+    const_iterator begin() const { return const_iterator(min_node, this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    /// @return Iterator to the first element not less than the value
+    const_iterator lower_bound(const T& data) const { return const_iterator(lowerBound(data), this); }
+
+    /// @return Iterator to the first element greater than the value
+    const_iterator upper_bound(const T& data) const { return const_iterator(upperBound(data), this); }
+
+    /// @return Iterators to the range of elements equal to the value
+    std::pair<const_iterator, const_iterator> equal_range(const T& data) const
     {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+        return { lower_bound(data), upper_bound(data) };
+    }
 
-        if (node->left)
-            print(node->left);
-        std::cout << node->data << std::endl;
-        if (node->right)
-            print(node->right);
+    /// @brief Lazy view of the elements from the interval, nothing is copied
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return View of the elements in [min, max] in sorted order
+    range Interval(const T& min, const T& max) const
+    {
+        if (max < min)
+            return range(end(), end());
+        return range(lower_bound(min), upper_bound(max));
     }
 
-    void IncrementElemByOne(Node* node = nullptr) {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+    /// @brief Finds the element by its position in sorted order in O(height).
+    /// The k-th highest element is Select(Size() - 1 - k)
+    /// @param k Zero-based position of the element
+    /// @return The element, throws std::out_of_range if k is not less than the size
+    const T& Select(size_t k) const
+    {
+        if (k >= count)
+            throw std::out_of_range("Position is out of the tree");
+
+        Node* node = root;
+        while (true) {
+            size_t left = subtreeSize(node->left);
+            if (k < left)
+                node = node->left;
+            else if (k == left)
+                return node->data;
+            else {
+                k -= left + 1;
+                node = node->right;
+            }
+        }
+    }
 
-        if (node->left)
-            IncrementElemByOne(node->left);
-        ++(node->data);
-        if (node->right)
-            IncrementElemByOne(node->right);
+    /// @brief Counts elements less than the value in O(height)
+    /// @param data Value to compare with
+    /// @return Position the value would take in sorted order
+    size_t Rank(const T& data) const
+    {
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (less(node->data, data)) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
+
+    /// @brief Counts elements of the interval in O(height), without visiting them
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return Number of elements in [min, max]
+    size_t CountInRange(const T& min, const T& max) const
+    {
+        if (max < min)
+            return 0;
+        return countNotGreater(max) - Rank(min);
+    }
+
+    void print() const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            std::cout << node->data << std::endl;
+    }
+
+    void IncrementElemByOne() {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            ++(node->data);
     }
 
+    /// @brief Deletes all elements. Node pool releases trivially destructible nodes at once
+    /// unless the other trees share it after Split, Join or Union
     void clear() {
         if (!root)
             return;
 
-        clearRecursive(this->root);
+        // Shared allocator may hold nodes of the other trees, so only the sole owner releases it.
+        // Borrowed allocators are kept until then, the free list may reuse their slots
+        bool exclusive = pool.use_count() == 1;
+        if (!(exclusive && Allocator<Node>::kReleasesAll && std::is_trivially_destructible<Node>::value))
+            clearSubtree(this->root);
+        if (exclusive) {
+            pool->Release();
+            borrowed.clear();
+        }
 
         root = nullptr;
+        min_node = max_node = nullptr;
+        count = 0;
     }
 
     void FillRandom(size_t size) {
         for (size_t i = 0; i < size; i++) {
             T elem;
             elem.random();
-            this->append(elem);
+            this->append(std::move(elem));
         }
     }
 
+    /// @brief Fills the tree with random elements using AppendRange
+    /// @param size Number of elements
+    void FillRange(size_t size) {
+        std::vector<T> elements(size);
+        for (T& elem : elements)
+            elem.random();
+        this->AppendRange(elements);
+    }
+
     bool isEmpty() const
     {
         return root == nullptr;
     }
 
-    /// @brief Gets maximum tree element 
+    /// @brief Gets maximum tree element in O(1). The tree must not be empty
     /// @return Maximum element
-    T GetMax() const
+    const T& GetMax() const
     {
-        Node* cur = root;
-        while (cur->right != nullptr)
-        {
-            cur = cur->right;
-        }
-        return cur->data;
+        return max_node->data;
+    }
+
+    /// @brief Gets maximum tree element in O(1) to change it in place. The tree must not be empty.
+    /// The change must keep the order of the element
+    /// @return Maximum element
+    T& GetMax()
+    {
+        return max_node->data;
+    }
+
+    /// @brief Finds the element equal to the value to change it in place.
+    /// The change must keep the order of the element
+    /// @return The element, nullptr if there is none
+    T* Find(const T& data)
+    {
+        Node* node = search(data);
+        return node ? &node->data : nullptr;
+    }
+
+    /// @brief Gets minimum tree element in O(1). The tree must not be empty
+    /// @return Minimum element
+    const T& GetMin() const
+    {
+        return min_node->data;
+    }
+
+    /// @brief Removes maximum tree element. The tree must not be empty
+    /// @return Maximum element, moved out of the tree
+    T PopMax()
+    {
+        Node* node = max_node;
+        T max = std::move(node->data);
+        unlink(node);
+        return max;
     }
 
     ~AVLTree()
@@ -437,6 +1267,69 @@ private:
         avl.clear();
     }
 
+    static void count_in_range_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+        avl.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        avl.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        size_t start, end;
+
+        for (auto _ : state) {
+            start = mersenne() % elements.size(); end = mersenne() % elements.size();
+            if (start > end) std::swap(start, end);
+            benchmark::DoNotOptimize(avl.CountInRange(elements[start], elements[end]));
+        }
+
+        avl.clear();
+    }
+
+    static void select_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+        avl.FillRandom(state.range(0));
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(avl.Select(mersenne() % avl.Size()));
+        }
+
+        avl.clear();
+    }
+
+    static void get_max_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+        avl.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(avl.GetMax());
+        }
+
+        avl.clear();
+    }
+
+    static void pop_max_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            avl.FillRange(state.range(0));
+            state.ResumeTiming();
+
+            while (!avl.isEmpty())
+                benchmark::DoNotOptimize(avl.PopMax());
+        }
+    }
+
     static void remove_element_AVLTree_BM(benchmark::State& state)
     {
         AVLTree avl;
@@ -478,6 +1371,17 @@ private:
         avl.clear();
     }
 
+    static void fill_range_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+
+        for (auto _ : state) {
+            avl.FillRange(state.range(0));
+        }
+
+        avl.clear();
+    }
+
     static void fill_random_ascending_order_AVLTree_BM(benchmark::State& state)
     {
         AVLTree tree;
@@ -507,6 +1411,58 @@ private:
     }
 
 
+    template<template<typename> class NodeAllocator>
+    static void churn_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree<T, NodeAllocator> avl;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements)
+            elem.random();
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            for (const T& elem : elements)
+                avl.append(elem);
+            for (size_t i = 0; i < elements.size() / 2; i++)
+                avl.remove(elements[mersenne() % elements.size()]);
+            avl.clear();
+        }
+
+        state.SetItemsProcessed(state.iterations() * elements.size());
+        state.counters["RSS_KB"] = ResidentSetBytes() / 1024.0;
+    }
+
+    static void mixed_AVLTree_BM(benchmark::State& state)
+    {
+        AVLTree avl;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements) {
+            elem.random();
+            avl.append(elem);
+        }
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+        size_t start_rotations = avl.rotations;
+
+        for (auto _ : state) {
+            // Replaces a random element, as the queue does under mixed traffic
+            size_t i = mersenne() % elements.size();
+            avl.remove(elements[i]);
+            elements[i].random();
+            avl.append(elements[i]);
+        }
+
+        state.SetItemsProcessed(state.iterations() * 2);
+        state.counters["rotations"] = benchmark::Counter(
+            double(avl.rotations - start_rotations), benchmark::Counter::kAvgIterations);
+        avl.clear();
+    }
+
 public:
 
     // Appends benchmarking function to the benchmarking queue
@@ -522,6 +1478,23 @@ public:
         BENCHMARK(get_elements_interval_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    // Counts the interval elements using subtree sizes, compare with GetElementsByInterval_BM
+    void CountInRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(count_in_range_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void Select_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(select_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_max_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void PopMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(pop_max_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void remove_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(remove_element_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -534,6 +1507,10 @@ public:
         BENCHMARK(fill_random_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    void FillRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_range_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void FillRandomAscendingOrder_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(fill_random_ascending_order_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -541,6 +1518,17 @@ public:
     void FillRandomDescendingOrder_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(fill_random_descending_order_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
+    // Appends benchmarking function to the benchmarking queue
+    // Counts rotations per removal and insertion, compare with RBTree::Mixed_BM
+    void Mixed_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(mixed_AVLTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking functions to the benchmarking queue
+    // Compares insert/remove/clear throughput and memory of the node pool and plain new/delete
+    void Churn_BM(size_t maxElems, size_t iterations) {
+        benchmark::RegisterBenchmark("churn_AVLTree_BM<NodePool>", churn_AVLTree_BM<NodePool>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+        benchmark::RegisterBenchmark("churn_AVLTree_BM<NewDeleteAllocator>", churn_AVLTree_BM<NewDeleteAllocator>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
 
 #endif
 
@@ -13,6 +13,10 @@
 #pragma once
 
 #include <vector>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <functional>
 #include <stdexcept>
 
 #include "priority_queue.h"
@@ -35,10 +39,12 @@ private:
     struct Item
     {
         T get_value() const { return value; };
+        const T& peek_value() const { return value; };
+        T take_value() { return std::move(value); };
         int get_priority() const { return priority; };
 
         Item(T value, int priority)
-            : value(value), priority(priority) {}
+            : value(std::move(value)), priority(priority) {}
 
     private:
         T value;
@@ -49,6 +55,11 @@ public:
     T Peek() const override;
     T Pop() override;
     void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+protected:
+    void insertRange(std::vector<::Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
 
 private:
     std::vector<Item> arr;
@@ -79,7 +90,7 @@ inline T ArrayPriorityQueue<T>::Peek() const
                 max_priority_index = i;
             }
         }
-        return arr[max_priority_index].get_value();
+        return arr[max_priority_index].peek_value();
     }
 }
 
@@ -101,7 +112,7 @@ inline T ArrayPriorityQueue<T>::Pop()
             }
         }
 
-        T value = arr[max_priority_index].get_value();
+        T value = arr[max_priority_index].take_value();
         arr.erase(arr.begin() + max_priority_index);
         return value;
     }
@@ -110,7 +121,70 @@ inline T ArrayPriorityQueue<T>::Pop()
 template<typename T>
 inline void ArrayPriorityQueue<T>::Insert(T data, int priority)
 {
-    arr.push_back(Item(data, priority));
+    arr.push_back(Item(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t ArrayPriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+    count = std::min(count, arr.size());
+    if (count == 0)
+        return 0;
+
+    // The count-th highest priority is the threshold: all higher ones are taken
+    // with the earliest elements of the threshold priority, as Pop would take them
+    std::vector<int> priorities;
+    priorities.reserve(arr.size());
+    for (const Item& item : arr)
+        priorities.push_back(item.get_priority());
+    auto nth = priorities.begin() + (count - 1);
+    std::nth_element(priorities.begin(), nth, priorities.end(), std::greater<int>());
+    int threshold = *nth;
+    size_t equal_taken = count - std::count_if(priorities.begin(), nth,
+        [threshold](int priority) { return priority > threshold; });
+
+    // Stable partition: the rest of the array keeps the arrival order
+    std::vector<Item> taken;
+    taken.reserve(count);
+    size_t kept = 0;
+    for (size_t i = 0; i < arr.size(); i++)
+    {
+        int priority = arr[i].get_priority();
+        if (priority > threshold || (priority == threshold && equal_taken > 0)) {
+            if (priority == threshold)
+                equal_taken--;
+            taken.push_back(std::move(arr[i]));
+        }
+        else {
+            if (kept != i)
+                arr[kept] = std::move(arr[i]);
+            kept++;
+        }
+    }
+    arr.erase(arr.begin() + kept, arr.end());
+
+    std::stable_sort(taken.begin(), taken.end(), [](const Item& left, const Item& right) {
+        return left.get_priority() > right.get_priority();
+    });
+    for (Item& item : taken)
+        out.push_back(item.take_value());
+    return count;
+}
+
+template<typename T>
+inline void ArrayPriorityQueue<T>::insertRange(std::vector<::Item<T>>& items)
+{
+    arr.reserve(arr.size() + items.size());
+    for (::Item<T>& item : items)
+        arr.push_back(Item(std::move(item.data), item.priority));
+}
+
+template<typename T>
+inline void ArrayPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // Pop takes the earliest of the equal priorities, the array keeps the arrival order
+    for (const Item& item : arr)
+        visit(item.peek_value(), item.get_priority());
 }
 
 template<typename T>
@@ -162,4 +236,104 @@ TEST_CASE("Pop")
     CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
 }
 
+TEST_CASE("Insert range and pop several elements")
+{
+    ArrayPriorityQueue<int> q;
+
+    std::vector<::Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 3333 });
+
+    CHECK(q.PopN(3, popped) == 1);
+    CHECK(popped.back() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Pop several elements of equal priorities")
+{
+    ArrayPriorityQueue<int> q;
+    for (int i = 0; i < 40; i++)
+        q.Insert(i, i % 2);
+
+    // The earliest of the equal priorities come first, as with Pop
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 1, 3, 5 });
+
+    // The rest keeps the arrival order
+    CHECK(q.Pop() == 7);
+    popped.clear();
+    CHECK(q.PopN(18, popped) == 18);
+    CHECK(popped.front() == 9);
+    CHECK(popped[15] == 39);
+    CHECK(popped[16] == 0);
+    CHECK(popped[17] == 2);
+    CHECK(q.Pop() == 4);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    ArrayPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    ArrayPriorityQueue<std::string> q;
+    q.Insert("1111", 1);
+    q.Insert("2222", 10);
+    q.Insert("3333", 5);
+    q.Insert("4444", 7);
+    q.Insert("5555", 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+    std::string saved = stream.str();
+
+    ArrayPriorityQueue<std::string> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (const char* value : { "2222", "4444", "3333", "5555", "1111" }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+
+    // Nothing is inserted from the cut or foreign data
+    std::stringstream cut(saved.substr(0, saved.size() - 1));
+    CHECK_THROWS_AS(loaded.Load(cut), const std::runtime_error&);
+    // Forged size of the first record isn't allocated before the bytes are read
+    std::string forged = saved;
+    forged.replace(QueueFileHeader::kSize + 4, 4, 4, '\xff');
+    std::stringstream forged_stream(forged);
+    CHECK_THROWS_AS(loaded.Load(forged_stream), const std::runtime_error&);
+    std::stringstream garbage("not a saved queue");
+    CHECK_THROWS_AS(loaded.Load(garbage), const std::runtime_error&);
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
 #endif
\ No newline at end of file
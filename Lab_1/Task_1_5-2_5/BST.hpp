@@ -11,9 +11,20 @@
 
 #pragma once
 
+#include <cstddef>
+#include <iostream>
+#include <random>
 #include <list>
+#include <stdexcept>
 #include <vector>
-
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+#include "NodePool.hpp"
+#include "TreeRange.hpp"
+#include "tree_stats.h"
 #include "doctest.h"
 
  // For private methods unit testing
@@ -24,24 +35,44 @@
 
 /// @brief Is used to store comparative values
 /// @tparam T 
-template<typename T>
+/// @tparam Allocator Allocator of the tree nodes, NodePool by default
+template<typename T, template<typename> class Allocator = NodePool>
 class BST
 {
 private:
     struct Node {
         T data;
         Node* left = nullptr, * right = nullptr;
+        Node* parent = nullptr;
+        size_t size = 1; // number of nodes in the subtree
 
         Node(T data)
-            : data(data) {}
+            : data(std::move(data)) {}
     };
 
+    StatsPool<Allocator<Node>> pool;
     Node* root = nullptr;
+    size_t count = 0;
+    // Extreme nodes are cached, so GetMax/GetMin and PopMax don't walk down the tree
+    Node* min_node = nullptr;
+    Node* max_node = nullptr;
+
+    static size_t subtreeSize(Node* node)
+    {
+        return node ? node->size : 0;
+    }
+
+    /// @brief Compares the elements, counted when TREE_STATS is defined
+    bool less(const T& left, const T& right) const
+    {
+        TREE_STATS_COUNT(pool, comparisons);
+        return left < right;
+    }
 
     /// @brief Search node with the minumum value
     /// @param node Node to start from
     /// @return Link to the minimum value node
-    Node* minValueNode(Node* node)
+    static Node* minValueNode(Node* node)
     {
         Node* current = node;
         while (current && current->left != NULL)
@@ -49,216 +80,564 @@ private:
         return current;
     }
 
-    /// @brief Deletes node with the specified value from the tree, recursively
+    /// @brief Search node with the maximum value
+    /// @param node Node to start from
+    /// @return Link to the maximum value node
+    static Node* maxValueNode(Node* node)
+    {
+        Node* current = node;
+        while (current && current->right != NULL)
+            current = current->right;
+        return current;
+    }
+
+    /// @brief Finds the next node in sorted order using the parent links
     /// @param node Current node
-    /// @param data Value of the node to delete
-    /// @return Link to the current node with deleted childrens
-    Node* deleteNode(Node* node, T data)
+    /// @return Next node, nullptr for the maximum one
+    static Node* successor(Node* node)
     {
-        if (node == nullptr)
-            return node;
+        if (node->right)
+            return minValueNode(node->right);
 
-        if (data < node->data)
-            node->left = deleteNode(node->left, data);
+        while (node->parent && node == node->parent->right)
+            node = node->parent;
+        return node->parent;
+    }
 
-        else if (data > node->data)
-            node->right = deleteNode(node->right, data);
+    /// @brief Finds the previous node in sorted order using the parent links
+    /// @param node Current node
+    /// @return Previous node, nullptr for the minimum one
+    static Node* predecessor(Node* node)
+    {
+        if (node->left)
+            return maxValueNode(node->left);
 
-        else {
-            if (node->left == nullptr && node->right == nullptr)
-                return nullptr;
+        while (node->parent && node == node->parent->left)
+            node = node->parent;
+        return node->parent;
+    }
 
-            else if (node->left == nullptr) {
-                Node* temp = node->right;
-                delete node;
-                return temp;
-            }
-            else if (node->right == nullptr) {
-                Node* temp = node->left;
-                delete node;
-                return temp;
-            }
+    /// @brief Puts new child to the place of the old one
+    /// @param parent Parent of the old child, nullptr if the old child is the root
+    /// @param old_child Replaced node
+    /// @param new_child Node to link, may be nullptr
+    void replaceChild(Node* parent, Node* old_child, Node* new_child)
+    {
+        if (!parent)
+            root = new_child;
+        else if (parent->left == old_child)
+            parent->left = new_child;
+        else
+            parent->right = new_child;
 
-            Node* temp = minValueNode(node->right);
+        if (new_child)
+            new_child->parent = parent;
+    }
 
-            node->data = temp->data;
+    /// @brief Unlinks the node with at most one child and destroys it
+    /// @param node Node to remove
+    void unlink(Node* node)
+    {
+        if (node == min_node)
+            min_node = successor(node);
+        if (node == max_node)
+            max_node = predecessor(node);
+
+        for (Node* ancestor = node->parent; ancestor; ancestor = ancestor->parent)
+            ancestor->size--;
+
+        replaceChild(node->parent, node, node->left ? node->left : node->right);
+        pool.Destroy(node);
+        count--;
+    }
 
-            node->right = deleteNode(node->right, temp->data);
+    /// @brief Deletes node with the specified value from the tree
+    /// @param data Value of the node to delete
+    void deleteNode(const T& data)
+    {
+        Node* node = search(data);
+        if (!node)
+            return;
+
+        if (node->left && node->right) {
+            // Successor's value replaces the deleted one
+            Node* next = minValueNode(node->right);
+            node->data = std::move(next->data);
+            node = next;
         }
-        return node;
+        unlink(node);
     }
 
-    /// @brief Searches node with the specified value, recursively
-    /// @param node Current node
+    /// @brief Searches node with the specified value
     /// @param data Searched node value
     /// @return Link to the searched node if value exist, nullptr otherwise
-    Node* search(Node* node, T data) {
-        if (node == nullptr || node->data == data)
-            return node;
-
-        if (node->data < data)
-            return search(node->right, data);
+    Node* search(const T& data) const {
+        Node* node = root;
+        while (node) {
+            if (less(data, node->data))
+                node = node->left;
+            else if (less(node->data, data))
+                node = node->right;
+            else
+                break;
+        }
+        return node;
+    }
 
-        return search(node->left, data);
+    /// @brief Searches the first node not less than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are less
+    Node* lowerBound(const T& data) const {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (less(node->data, data))
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
+
+    /// @brief Searches the first node greater than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are not greater
+    Node* upperBound(const T& data) const {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (!less(data, node->data))
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
     }
 
-    /// @brief Collects data by elements range, recursively
-    /// @param node Current node
-    /// @param interval Container to insert found data
-    /// @param min Minimum element of the range
-    /// @param max Maximum element of the range
-    void searchElementsByInterval(Node* node, std::list<T>& interval, T& min, T& max) const
+    /// @brief Counts elements not greater than the value
+    size_t countNotGreater(const T& data) const
     {
-        if (!node)
-            return;
-
-        if (min < node->data)
-            searchElementsByInterval(node->left, interval, min, max);
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (!less(data, node->data)) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
 
-        if (min <= node->data && max >= node->data)
-            interval.push_back(node->data);
+    /// @brief Respresents tree as array
+    /// @param elements Container to insert elements
+    void InOrder(std::vector<T>& elements) const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(node->data);
+    }
 
-        searchElementsByInterval(node->right, interval, min, max);
+    /// @brief Moves all elements out of the tree in sorted order.
+    /// Nodes are left with moved-from values and must be cleared afterwards
+    /// @param elements Container to move elements to
+    void moveOut(std::vector<T>& elements)
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(std::move(node->data));
     }
 
-    /// @brief Respresents tree as array, recursively
-    /// @param elements Container to insetr elements
-    /// @param node Current node
-    void InOrder(std::vector<T>& elements, Node* node = nullptr) const
+    /// @brief Builds balanced subtree from the sorted range.
+    /// Recursion depth is only log N, as the built subtree is balanced
+    /// @param first First element of the range
+    /// @param last Element after the last one of the range
+    /// @return Root of the built subtree
+    Node* buildBalanced(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last)
     {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+        if (first == last)
+            return nullptr;
 
+        auto middle = first + (last - first) / 2;
+        Node* node = pool.Create(std::move(*middle));
+        node->left = buildBalanced(first, middle);
+        node->right = buildBalanced(middle + 1, last);
         if (node->left)
-            InOrder(elements, node->left);
-        elements.push_back(node->data);
+            node->left->parent = node;
         if (node->right)
-            InOrder(elements, node->right);
+            node->right->parent = node;
+        node->size = 1 + subtreeSize(node->left) + subtreeSize(node->right);
+        return node;
     }
 
-    /// @brief Delete all elements
-    /// @param node Current node
-    void clearRecursive(Node* node) {
-        if (!node)
-            return;
-
-        clearRecursive(node->left);
-        clearRecursive(node->right);
-
-        delete node;
+    /// @brief Delete all elements of the subtree without recursion:
+    /// left children are rotated up until the node has none and can be destroyed
+    /// @param node Subtree root
+    void clearSubtree(Node* node) {
+        while (node) {
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else {
+                Node* right = node->right;
+                pool.Destroy(node);
+                node = right;
+            }
+        }
     }
 
 public:
-    bool isEmpty() const
+    /// @brief Bidirectional iterator over the elements in sorted order.
+    /// Steps along the parent links, so iterating doesn't allocate.
+    /// Elements can't be changed through it, as it would break the order
+    class const_iterator
     {
-        return root == nullptr;
-    }
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
 
-    /// @brief Inserts data to the tree, recursively
-    /// @param data Data to insert
-    /// @param node Current node
-    void append(T data, BST<T>::Node* node = nullptr) {
-        if (!root) {
-            root = new Node(data);
-            return;
+        const_iterator() {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++()
+        {
+            node = successor(node);
+            return *this;
         }
-        if (!node)
-            node = root;
 
-        if (data < node->data)
+        const_iterator operator++(int)
         {
-            if (!node->left) {
-                node->left = new Node(data);
-                return;
-            }
-            else
-                append(data, node->left);
+            const_iterator old = *this;
+            ++*this;
+            return old;
         }
 
-        if (data > node->data)
+        /// @brief Steps back, end() steps to the maximum element
+        const_iterator& operator--()
         {
-            if (!node->right) {
-                node->right = new Node(data);
+            node = node ? predecessor(node) : tree->max_node;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class BST;
+
+        const_iterator(Node* node, const BST* tree)
+            : node(node), tree(tree) {}
+
+        Node* node = nullptr;
+        const BST* tree = nullptr;
+    };
+
+    using iterator = const_iterator;
+    using range = TreeRange<const_iterator>;
+
+    bool isEmpty() const
+    {
+        return root == nullptr;
+    }
+
+    /// @brief Inserts data to the tree
+    /// @param data Data to insert
+    void append(T data) {
+        Node* parent = nullptr;
+        Node* node = root;
+        // Side of the parent the new node goes to, so the element isn't compared again
+        bool to_left = false;
+        while (node) {
+            parent = node;
+            to_left = less(data, node->data);
+            if (to_left)
+                node = node->left;
+            else if (less(node->data, data))
+                node = node->right;
+            else {
+                // Already present, the sizes counted on the way down are restored
+                for (node = node->parent; node; node = node->parent)
+                    node->size--;
                 return;
             }
-            else
-                append(data, node->right);
+            parent->size++;
         }
+
+        node = pool.Create(std::move(data));
+        node->parent = parent;
+        // A new extreme node is always linked below the old one
+        if (!min_node || (parent == min_node && to_left))
+            min_node = node;
+        if (!max_node || (parent == max_node && !to_left))
+            max_node = node;
+        if (!parent)
+            root = node;
+        else if (to_left)
+            parent->left = node;
+        else
+            parent->right = node;
+        count++;
+    }
+
+    /// @brief Inserts all elements at once: merges them with the tree content
+    /// and rebuilds the balanced tree in O(N + M log M).
+    /// As in append, elements equal to the already present ones are skipped
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements) {
+        std::stable_sort(elements.begin(), elements.end());
+
+        std::vector<T> merged;
+        merged.reserve(count + elements.size());
+        moveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        clear();
+        root = buildBalanced(merged.begin(), merged.end());
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = merged.size();
+    }
+
+    /// @brief Removes up to n maximum elements.
+    /// When a large part of the tree is removed, the rest is rebuilt in O(N)
+    /// instead of removing elements one by one
+    /// @param n Number of elements to remove
+    /// @param removed Container to append removed elements to, in descending order
+    /// @return Number of removed elements
+    size_t RemoveMaxN(size_t n, std::vector<T>& removed) {
+        n = std::min(n, count);
+        size_t depth = 1;
+        while ((size_t(1) << depth) <= count)
+            depth++;
+
+        if (n * depth < count) {
+            for (size_t i = 0; i < n; i++)
+                removed.push_back(PopMax());
+            return n;
+        }
+
+        std::vector<T> elements;
+        elements.reserve(count);
+        moveOut(elements);
+        removed.insert(removed.end(),
+            std::make_move_iterator(elements.rbegin()), std::make_move_iterator(elements.rbegin() + n));
+
+        clear();
+        root = buildBalanced(elements.begin(), elements.end() - n);
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = elements.size() - n;
+        return n;
+    }
+
+    size_t Size() const
+    {
+        return count;
     }
 
-    void remove(T data) {
-        this->root = deleteNode(this->root, data);
+    /// @return Operation counters and current depths of the tree, see TreeStats
+    TreeStats Stats() const
+    {
+        TreeStats stats;
+        CollectCounters(pool, stats);
+        CollectDepths(root, stats);
+        return stats;
+    }
+
+    void remove(const T& data) {
+        deleteNode(data);
     }
 
-    bool GetElem(T data) const{
-        return (search(this->root, data) != nullptr);
+    bool GetElem(const T& data) const{
+        return (search(data) != nullptr);
     }
 
     std::list<T> GetElementsByInterval(T min, T max) const
     {
-        std::list<T> interval;
-        searchElementsByInterval(this->root, interval, min, max);
-        return interval;
+        range elements = Interval(min, max);
+        return std::list<T>(elements.begin(), elements.end());
     }
 
-    void print(Node* node = nullptr) const
+    const_iterator begin() const { return const_iterator(min_node, this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    /// @return Iterator to the first element not less than the value
+    const_iterator lower_bound(const T& data) const { return const_iterator(lowerBound(data), this); }
+
+    /// @return Iterator to the first element greater than the value
+    const_iterator upper_bound(const T& data) const { return const_iterator(upperBound(data), this); }
+
+    /// @return Iterators to the range of elements equal to the value
+    std::pair<const_iterator, const_iterator> equal_range(const T& data) const
     {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+        return { lower_bound(data), upper_bound(data) };
+    }
 
-        if (node->left)
-            print(node->left);
-        std::cout << node->data << std::endl;
-        if (node->right)
-            print(node->right);
+    /// @brief Lazy view of the elements from the interval, nothing is copied
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return View of the elements in [min, max] in sorted order
+    range Interval(const T& min, const T& max) const
+    {
+        if (max < min)
+            return range(end(), end());
+        return range(lower_bound(min), upper_bound(max));
     }
 
-    /// @brief Increments each element in the BST by one, recursively
-    /// @param node Current node
-    void IncrementElemByOne(Node* node = nullptr) {
-        if (!node)
-            node = root;
-        if (!root)
-            return;
+    /// @brief Finds the element by its position in sorted order in O(height).
+    /// The k-th highest element is Select(Size() - 1 - k)
+    /// @param k Zero-based position of the element
+    /// @return The element, throws std::out_of_range if k is not less than the size
+    const T& Select(size_t k) const
+    {
+        if (k >= count)
+            throw std::out_of_range("Position is out of the tree");
+
+        Node* node = root;
+        while (true) {
+            size_t left = subtreeSize(node->left);
+            if (k < left)
+                node = node->left;
+            else if (k == left)
+                return node->data;
+            else {
+                k -= left + 1;
+                node = node->right;
+            }
+        }
+    }
 
-        if (node->left)
-            IncrementElemByOne(node->left);
-        ++(node->data);
-        if (node->right)
-            IncrementElemByOne(node->right);
+    /// @brief Counts elements less than the value in O(height)
+    /// @param data Value to compare with
+    /// @return Position the value would take in sorted order
+    size_t Rank(const T& data) const
+    {
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (less(node->data, data)) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
+
+    /// @brief Counts elements of the interval in O(height), without visiting them
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return Number of elements in [min, max]
+    size_t CountInRange(const T& min, const T& max) const
+    {
+        if (max < min)
+            return 0;
+        return countNotGreater(max) - Rank(min);
+    }
+
+    void print() const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            std::cout << node->data << std::endl;
+    }
+
+    /// @brief Increments each element in the BST by one
+    void IncrementElemByOne() {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            ++(node->data);
     }
 
     void FillRandom(size_t size) {
         for (size_t i = 0; i < size; i++) {
             T elem;
             elem.random();
-            this->append(elem);
+            this->append(std::move(elem));
         }
     }
 
+    /// @brief Fills the tree with random elements using AppendRange
+    /// @param size Number of elements
+    void FillRange(size_t size) {
+        std::vector<T> elements(size);
+        for (T& elem : elements)
+            elem.random();
+        this->AppendRange(elements);
+    }
+
+    /// @brief Deletes all elements. Node pool releases trivially destructible nodes at once
     void clear() {
         if (!root)
             return;
 
-        clearRecursive(this->root);
+        if (!(Allocator<Node>::kReleasesAll && std::is_trivially_destructible<Node>::value))
+            clearSubtree(this->root);
+        pool.Release();
 
         root = nullptr;
+        min_node = max_node = nullptr;
+        count = 0;
     }
 
-    /// @brief Gets maximum tree element 
+    /// @brief Gets maximum tree element in O(1). The tree must not be empty
     /// @return Maximum element
-    T GetMax() const
+    const T& GetMax() const
     {
-        Node* cur = root;
-        while (cur->right != nullptr)
-        {
-            cur = cur->right;
-        }
-        return cur->data;
+        return max_node->data;
+    }
+
+    /// @brief Gets maximum tree element in O(1) to change it in place. The tree must not be empty.
+    /// The change must keep the order of the element
+    /// @return Maximum element
+    T& GetMax()
+    {
+        return max_node->data;
+    }
+
+    /// @brief Finds the element equal to the value to change it in place.
+    /// The change must keep the order of the element
+    /// @return The element, nullptr if there is none
+    T* Find(const T& data)
+    {
+        Node* node = search(data);
+        return node ? &node->data : nullptr;
+    }
+
+    /// @brief Gets minimum tree element in O(1). The tree must not be empty
+    /// @return Minimum element
+    const T& GetMin() const
+    {
+        return min_node->data;
+    }
+
+    /// @brief Removes maximum tree element in one pass. The tree must not be empty
+    /// @return Maximum element, moved out of the tree
+    T PopMax()
+    {
+        Node* max = max_node;
+        T data = std::move(max->data);
+        unlink(max);
+        return data;
     }
 
     ~BST()
@@ -324,6 +703,69 @@ private:
         bst.clear();
     }
 
+    static void count_in_range_BST_BM(benchmark::State& state)
+    {
+        BST bst;
+        bst.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        bst.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        size_t start, end;
+
+        for (auto _ : state) {
+            start = mersenne() % elements.size(); end = mersenne() % elements.size();
+            if (start > end) std::swap(start, end);
+            benchmark::DoNotOptimize(bst.CountInRange(elements[start], elements[end]));
+        }
+
+        bst.clear();
+    }
+
+    static void select_BST_BM(benchmark::State& state)
+    {
+        BST bst;
+        bst.FillRandom(state.range(0));
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(bst.Select(mersenne() % bst.Size()));
+        }
+
+        bst.clear();
+    }
+
+    static void get_max_BST_BM(benchmark::State& state)
+    {
+        BST bst;
+        bst.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(bst.GetMax());
+        }
+
+        bst.clear();
+    }
+
+    static void pop_max_BST_BM(benchmark::State& state)
+    {
+        BST bst;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            bst.FillRange(state.range(0));
+            state.ResumeTiming();
+
+            while (!bst.isEmpty())
+                benchmark::DoNotOptimize(bst.PopMax());
+        }
+    }
+
     static void remove_element_BST_BM(benchmark::State& state)
     {
         BST bst;
@@ -365,6 +807,17 @@ private:
         bst.clear();
     }
 
+    static void fill_range_BST_BM(benchmark::State& state)
+    {
+        BST bst;
+
+        for (auto _ : state) {
+            bst.FillRange(state.range(0));
+        }
+
+        bst.clear();
+    }
+
     static void fill_random_ascending_order_BST_BM(benchmark::State& state)
     {
         BST bst;
@@ -393,6 +846,30 @@ private:
         bst.clear();
     }
 
+    template<template<typename> class NodeAllocator>
+    static void churn_BST_BM(benchmark::State& state)
+    {
+        BST<T, NodeAllocator> bst;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements)
+            elem.random();
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            for (const T& elem : elements)
+                bst.append(elem);
+            for (size_t i = 0; i < elements.size() / 2; i++)
+                bst.remove(elements[mersenne() % elements.size()]);
+            bst.clear();
+        }
+
+        state.SetItemsProcessed(state.iterations() * elements.size());
+        state.counters["RSS_KB"] = ResidentSetBytes() / 1024.0;
+    }
+
 public:
 
     // Appends benchmarking function to the benchmarking queue
@@ -408,6 +885,23 @@ public:
         BENCHMARK(get_elements_interval_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    // Counts the interval elements using subtree sizes, compare with GetElementsByInterval_BM
+    void CountInRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(count_in_range_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void Select_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(select_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_max_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void PopMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(pop_max_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void remove_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(remove_element_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -420,6 +914,10 @@ public:
         BENCHMARK(fill_random_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
     // Appends benchmarking function to the benchmarking queue
+    void FillRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_range_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
     void FillRandomAscendingOrder_BM(size_t maxElems, size_t iterations) {
         BENCHMARK(fill_random_ascending_order_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
@@ -428,6 +926,13 @@ public:
         BENCHMARK(fill_random_descending_order_BST_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
     }
 
+    // Appends benchmarking functions to the benchmarking queue
+    // Compares insert/remove/clear throughput and memory of the node pool and plain new/delete
+    void Churn_BM(size_t maxElems, size_t iterations) {
+        benchmark::RegisterBenchmark("churn_BST_BM<NodePool>", churn_BST_BM<NodePool>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+        benchmark::RegisterBenchmark("churn_BST_BM<NewDeleteAllocator>", churn_BST_BM<NewDeleteAllocator>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+
     void BenchmarkTheQueue() {
         ::benchmark::RegisterMemoryManager;
         ::benchmark::RunSpecifiedBenchmarks();
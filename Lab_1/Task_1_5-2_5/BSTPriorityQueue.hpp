@@ -1,8 +1,16 @@
 #pragma once
 
+#include <vector>
+#include <sstream>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 #include "item.h"
+#include "bucket.h"
+#include "lazy_buckets.h"
 #include "BST.hpp"
 #include "priority_queue.h"
 
@@ -24,9 +32,29 @@ public:
 	T Peek() const override;
 	T Pop() override;
 	void Insert(T data, int priority) override;
+	size_t PopN(size_t count, std::vector<T>& out) override;
+
+	/// @return Counters and depths of the tree, which holds one element per distinct priority
+	TreeStats Stats() const;
+
+	/// @brief Switches the lazy deletion: emptied buckets stay in the tree as tombstones
+	/// until they take more than max_garbage of its nodes, then the tree is rebuilt, see LazyBuckets.
+	/// Suits the workloads that insert the popped priorities again soon
+	void SetLazyDeletion(bool enabled, double max_garbage = LazyBuckets<T, BST<Bucket<T>>>::kDefaultGarbage);
+
+protected:
+	void insertRange(std::vector<Item<T>>& items) override;
+	void forEach(const std::function<void(const T&, int)>& visit) const override;
+	bool visitsInPopOrder() const override { return true; }
 
 private:
-	BST<Item<T>> tree;
+	// One bucket per priority, equal priorities are popped in arrival order
+	BST<Bucket<T>> tree;
+	// Tombstones and their counters while the lazy deletion is on
+	LazyBuckets<T, BST<Bucket<T>>> lazy;
+
+	/// @return Bucket of the priority, nullptr if there is none
+	Bucket<T>* findBucket(int priority);
 
 	bool isEmpty() const override;
 };
@@ -40,7 +68,7 @@ inline T BSTPriorityQueue<T>::Peek() const
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
 	else {
-		return tree.GetMax().data;
+		return (lazy.Enabled() ? lazy.Top(tree) : tree.GetMax()).Front();
 	}
 }
 
@@ -49,23 +77,94 @@ inline T BSTPriorityQueue<T>::Pop()
 {
 	if (this->isEmpty())
 		throw std::underflow_error("Queue is empty");
+	else if (lazy.Enabled())
+		return lazy.Pop(tree);
 	else {
-		Item<T> item = tree.GetMax();
-		tree.remove(item);
-		return item.data;
+		Bucket<T>& top = tree.GetMax();
+		T data = top.Pop();
+		if (top.Empty())
+			tree.PopMax();
+		return data;
 	}
 }
 
 template<typename T>
 inline void BSTPriorityQueue<T>::Insert(T data, int priority)
 {
-	tree.append(Item<T>(data, priority));
+	if (lazy.Enabled())
+		lazy.Insert(tree, std::move(data), priority);
+	else if (Bucket<T>* bucket = findBucket(priority))
+		bucket->Push(std::move(data));
+	else
+		tree.append(Bucket<T>(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t BSTPriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	// Tombstones are passed by the pops one by one
+	if (lazy.Enabled())
+		return PriorityQueue<T>::PopN(count, out);
+
+	size_t taken;
+	size_t whole = CountWholeBuckets(tree, count, taken);
+	return PopBuckets(tree, count, whole, taken, out);
+}
+
+template<typename T>
+inline void BSTPriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	if (lazy.Enabled()) {
+		lazy.InsertRange(tree, items);
+		return;
+	}
+
+	// Items of the present priorities join their buckets, the new buckets are built into the tree at once
+	std::vector<Bucket<T>> added;
+	for (Bucket<T>& group : Bucket<T>::Group(items)) {
+		if (Bucket<T>* bucket = findBucket(group.priority))
+			bucket->Append(std::move(group));
+		else
+			added.push_back(std::move(group));
+	}
+	if (!added.empty())
+		tree.AppendRange(std::move(added));
+}
+
+template<typename T>
+inline TreeStats BSTPriorityQueue<T>::Stats() const
+{
+	TreeStats stats = tree.Stats();
+	stats.tombstones = lazy.Tombstones();
+	stats.compactions = lazy.Compactions();
+	return stats;
+}
+
+template<typename T>
+inline void BSTPriorityQueue<T>::SetLazyDeletion(bool enabled, double max_garbage)
+{
+	if (enabled)
+		lazy.Enable(tree, max_garbage);
+	else
+		lazy.Disable(tree);
+}
+
+template<typename T>
+inline Bucket<T>* BSTPriorityQueue<T>::findBucket(int priority)
+{
+	return tree.Find(Bucket<T>(priority));
+}
+
+template<typename T>
+inline void BSTPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+	ForEachInPopOrder(tree, visit);
 }
 
 template<typename T>
 inline bool BSTPriorityQueue<T>::isEmpty() const
 {
-	return tree.isEmpty();
+	return lazy.Enabled() ? lazy.Empty() : tree.isEmpty();
 }
 
 #ifdef _DEBUG
@@ -74,15 +173,15 @@ TEST_CASE("Insert")
 	BSTPriorityQueue<int> q;
 
 	q.Insert(1111, 1);
-	CHECK(q.tree.root->data.data == 1111);
+	CHECK(q.tree.root->data.Front() == 1111);
 
 
 	q.Insert(2222, 10);
-	CHECK(q.tree.root->right->data.data == 2222);
-	CHECK(q.tree.root->data.data == 1111);
+	CHECK(q.tree.root->right->data.Front() == 2222);
+	CHECK(q.tree.root->data.Front() == 1111);
 
 	q.Insert(3333, 5);
-	CHECK(q.tree.root->right->left->data.data == 3333);
+	CHECK(q.tree.root->right->left->data.Front() == 3333);
 }
 
 TEST_CASE("Peek")
@@ -115,4 +214,391 @@ TEST_CASE("Pop")
 	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
 }
 
+TEST_CASE("Insert range and pop several elements")
+{
+	BSTPriorityQueue<int> q;
+
+	q.Insert(5555, 6);
+
+	std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+	q.InsertRange(items.begin(), items.end());
+
+	std::vector<int> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+	CHECK(q.PopN(3, popped) == 2);
+	CHECK(popped.back() == 1111);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bulk build of a large queue")
+{
+	BSTPriorityQueue<int> q;
+
+	std::vector<Item<int>> items;
+	for (int i = 0; i < 1000; i++)
+		items.push_back(Item<int>(i, (i * 7919) % 1000));
+	q.InsertRange(items.begin(), items.begin() + 500);
+	q.InsertRange(items.begin() + 500, items.end());
+
+	std::vector<int> popped;
+	q.PopN(2, popped);
+	q.PopN(500, popped);
+	while (popped.size() < 1000)
+		popped.push_back(q.Pop());
+
+	for (size_t i = 1; i < popped.size(); i++)
+		CHECK((popped[i - 1] * 7919) % 1000 > (popped[i] * 7919) % 1000);
+}
+
+TEST_CASE("Tree iterators and interval views")
+{
+	BST<int> tree;
+	std::vector<int> expected;
+
+	for (int size = 0; size < 200; size++) {
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+		CHECK(std::equal(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()),
+			expected.rbegin(), expected.rend()));
+
+		int value = (size * 7919) % 200;
+		tree.append(value);
+		expected.insert(std::upper_bound(expected.begin(), expected.end(), value), value);
+	}
+
+	CHECK(*tree.lower_bound(50) == 50);
+	CHECK(*tree.upper_bound(50) == 51);
+	CHECK(*std::prev(tree.end()) == 199);
+	CHECK(tree.lower_bound(200) == tree.end());
+	CHECK(tree.upper_bound(-1) == tree.begin());
+
+	auto equal = tree.equal_range(42);
+	CHECK(std::distance(equal.first, equal.second) == 1);
+	CHECK(std::distance(tree.begin(), tree.end()) == 200);
+
+	int sum = 0;
+	for (int elem : tree.Interval(100, 149))
+		sum += elem;
+	CHECK(sum == 1 * (100 + 149) * 50 / 2);
+	CHECK(tree.Interval(150, 100).empty());
+	CHECK(std::count_if(tree.Interval(10, 19).begin(), tree.Interval(10, 19).end(),
+		[](int elem) { return elem % 2 == 0; }) == 1 * 5);
+}
+
+TEST_CASE("Order statistics")
+{
+	BST<int> tree;
+	std::vector<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 3000;
+		tree.append(value);
+		expected.push_back(value);
+	}
+	for (int i = 0; i < 3000; i += 3) {
+		int value = (i * 104729) % 3000;
+		tree.remove(value);
+		expected.erase(std::find(expected.begin(), expected.end(), value));
+	}
+	tree.PopMax();
+	std::sort(expected.begin(), expected.end());
+	expected.pop_back();
+	tree.append(expected[10]); // equal elements are skipped
+
+	for (size_t k = 0; k < expected.size(); k++)
+		CHECK(tree.Select(k) == expected[k]);
+	CHECK_THROWS_AS(tree.Select(expected.size()), const std::out_of_range&);
+
+	for (int value = -1; value <= 3000; value += 7) {
+		size_t rank = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+		CHECK(tree.Rank(value) == rank);
+		size_t count = std::upper_bound(expected.begin(), expected.end(), value + 100) - expected.begin() - rank;
+		CHECK(tree.CountInRange(value, value + 100) == count);
+	}
+	CHECK(tree.CountInRange(100, 50) == 0);
+
+	tree.AppendRange(std::vector<int>{ -5, 5000 });
+	CHECK(tree.Select(0) == -5);
+	CHECK(tree.Select(tree.Size() - 1) == 5000);
+	CHECK(tree.Rank(5000) == tree.Size() - 1);
+}
+
+TEST_CASE("Cached minimum and maximum follow the changes")
+{
+	BST<int> tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 1000;
+		if (i % 3 == 2) {
+			tree.remove(value);
+			expected.erase(value);
+		}
+		else if (i % 7 == 6 && !expected.empty()) {
+			CHECK(tree.PopMax() == *expected.rbegin());
+			expected.erase(std::prev(expected.end()));
+		}
+		else {
+			tree.append(value);
+			expected.insert(value);
+		}
+
+		if (i % 500 == 0) {
+			tree.AppendRange(std::vector<int>{ i - 2000, i + 2000 });
+			expected.insert({ i - 2000, i + 2000 });
+		}
+
+		REQUIRE(tree.Size() == expected.size());
+		if (!expected.empty()) {
+			CHECK(tree.GetMin() == *expected.begin());
+			CHECK(tree.GetMax() == *expected.rbegin());
+			CHECK(*std::prev(tree.end()) == *expected.rbegin());
+		}
+	}
+
+	tree.clear();
+	tree.append(5);
+	CHECK(tree.GetMin() == 5);
+	CHECK(tree.GetMax() == 5);
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+	BSTPriorityQueue<int> q;
+
+	for (int i = 0; i < 300; i++)
+		q.Insert(i, i % 3);
+	std::vector<Item<int>> items;
+	for (int i = 300; i < 600; i++)
+		items.push_back(Item<int>(i, i % 3));
+	q.InsertRange(items.begin(), items.end());
+	CHECK(q.tree.Size() == 3);
+
+	std::vector<int> popped;
+	q.PopN(50, popped);
+	q.Insert(600, 2);
+	while (popped.size() < 601)
+		popped.push_back(q.Pop());
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	CHECK(popped[0] == 2);
+	CHECK(popped[199] == 599);
+	CHECK(popped[200] == 600);
+	for (size_t i = 1; i < popped.size(); i++) {
+		if (popped[i - 1] % 3 == popped[i] % 3)
+			CHECK(popped[i - 1] < popped[i]);
+	}
+}
+
+TEST_CASE("Tree statistics")
+{
+	BST<int> tree;
+	CHECK(tree.Stats().max_depth == 0);
+	CHECK(tree.Stats().average_depth == 0);
+
+	for (int value : { 4, 2, 6, 1, 3, 5, 7 })
+		tree.append(value);
+	TreeStats stats = tree.Stats();
+	CHECK(stats.max_depth == 3);
+	CHECK(stats.average_depth == doctest::Approx(17.0 / 7));
+
+	tree.append(8);
+	CHECK(tree.Stats().max_depth == 4);
+
+#ifdef TREE_STATS
+	// Going left takes one comparison, going right or finding the equal element takes two
+	CHECK(stats.comparisons == 15);
+	CHECK(stats.allocations == 7);
+	CHECK(stats.rotations == 0);
+
+	tree.append(4);
+	CHECK(tree.Stats().comparisons == 15 + 6 + 2);
+	CHECK(tree.Stats().allocations == 8);
 #endif
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+	BSTPriorityQueue<CopyCounter> q;
+	CopyCounter::copies = 0;
+
+	q.Insert(CopyCounter(1111), 1);
+	q.Insert(CopyCounter(2222), 10);
+	q.Emplace(5, 3333);
+
+	std::vector<Item<CopyCounter>> items;
+	items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+	items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+	q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+	CHECK(q.Pop().value == 2222);
+	CHECK(q.Pop().value == 4444);
+
+	std::vector<CopyCounter> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped[0].value == 3333);
+	CHECK(popped[1].value == 5555);
+	CHECK(popped[2].value == 1111);
+
+	CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Degenerate tree of ascending keys doesn't overflow the stack")
+{
+	// Appending 10^7 ascending keys one by one takes O(N^2) in the unbalanced tree,
+	// so the same right-leaning chain is linked directly
+	const int kKeys = 10000000;
+	BST<int, NewDeleteAllocator> tree;
+
+	BST<int, NewDeleteAllocator>::Node* last = nullptr;
+	for (int i = 0; i < kKeys; i++) {
+		auto* node = tree.pool.Create(i);
+		node->parent = last;
+		node->size = kKeys - i;
+		if (last)
+			last->right = node;
+		else
+			tree.root = node;
+		last = node;
+	}
+	tree.count = kKeys;
+	tree.min_node = tree.root;
+	tree.max_node = last;
+
+	tree.append(kKeys);
+	CHECK(tree.GetElem(kKeys - 1));
+	CHECK_FALSE(tree.GetElem(-1));
+	CHECK(tree.GetElementsByInterval(kKeys - 3, kKeys + 3).size() == 4);
+	CHECK(tree.Select(kKeys / 2) == kKeys / 2);
+	CHECK(tree.CountInRange(10, kKeys) == size_t(kKeys) - 9);
+
+	tree.remove(kKeys / 2);
+	tree.remove(0);
+	CHECK(tree.PopMax() == kKeys);
+	CHECK(tree.Size() == size_t(kKeys) - 2);
+
+	tree.IncrementElemByOne();
+	std::vector<int> elements;
+	tree.InOrder(elements);
+	CHECK(elements.size() == size_t(kKeys) - 2);
+	CHECK(std::is_sorted(elements.begin(), elements.end()));
+	CHECK(elements.front() == 2);
+	CHECK(elements.back() == kKeys);
+
+	tree.clear();
+	CHECK(tree.isEmpty());
+}
+
+TEST_CASE("Lazy deletion keeps the emptied buckets")
+{
+	BSTPriorityQueue<int> q;
+	CHECK_THROWS_AS(q.SetLazyDeletion(true, 1.5), const std::invalid_argument&);
+
+	for (int i = 0; i < 10; i++)
+		q.Insert(i, i);
+	q.SetLazyDeletion(true, 0.5);
+
+	CHECK(q.Pop() == 9);
+	CHECK(q.Pop() == 8);
+	CHECK(q.tree.Size() == 10);
+	CHECK(q.Stats().tombstones == 2);
+
+	// Inserted priority revives its bucket
+	q.Insert(90, 9);
+	CHECK(q.Stats().tombstones == 1);
+	CHECK(q.Peek() == 90);
+	CHECK(q.Pop() == 90);
+
+	// The top is found below the tombstones
+	CHECK(q.Peek() == 7);
+	CHECK(q.Pop() == 7);
+	CHECK(q.Pop() == 6);
+	CHECK(q.Pop() == 5);
+	CHECK(q.Stats().compactions == 0);
+
+	// Tombstones take more than a half of the nodes, the tree is rebuilt
+	CHECK(q.Pop() == 4);
+	CHECK(q.Stats().compactions == 1);
+	CHECK(q.Stats().tombstones == 0);
+	CHECK(q.tree.Size() == 4);
+
+	q.SetLazyDeletion(false);
+	std::vector<int> popped;
+	CHECK(q.PopN(5, popped) == 4);
+	CHECK(popped == std::vector<int>{ 3, 2, 1, 0 });
+	CHECK(q.tree.isEmpty());
+}
+
+TEST_CASE("Lazy deletion pops as the eager one")
+{
+	BSTPriorityQueue<int> lazy, eager;
+	lazy.SetLazyDeletion(true, 0.2);
+	std::mt19937 mersenne(7);
+
+	for (int i = 0; i < 20000; i++) {
+		switch (mersenne() % 4)
+		{
+		case 0:
+		{
+			std::vector<Item<int>> items;
+			for (int j = 0; j < 8; j++)
+				items.push_back(Item<int>(i * 8 + j, int(mersenne() % 64)));
+			lazy.InsertRange(items.begin(), items.end());
+			eager.InsertRange(items.begin(), items.end());
+			break;
+		}
+		case 1:
+		{
+			int priority = int(mersenne() % 64);
+			lazy.Insert(i, priority);
+			eager.Insert(i, priority);
+			break;
+		}
+		default:
+			if (eager.isEmpty())
+				CHECK_THROWS_AS(lazy.Pop(), const std::underflow_error&);
+			else {
+				CHECK(lazy.Peek() == eager.Peek());
+				CHECK(lazy.Pop() == eager.Pop());
+			}
+			break;
+		}
+		if (i == 10000)
+			lazy.SetLazyDeletion(false);
+		if (i == 15000)
+			lazy.SetLazyDeletion(true, 0.9);
+	}
+	CHECK(lazy.Stats().compactions > 0);
+
+	std::vector<int> lazy_popped, eager_popped;
+	lazy.PopN(100000, lazy_popped);
+	eager.PopN(100000, eager_popped);
+	CHECK(lazy_popped == eager_popped);
+	CHECK(lazy.isEmpty());
+}
+
+TEST_CASE("Save and load")
+{
+	BSTPriorityQueue<int> q;
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	q.Insert(4444, 7);
+	q.Insert(5555, 5);
+
+	std::stringstream stream;
+	q.Save(stream);
+
+	BSTPriorityQueue<int> loaded;
+	loaded.Load(stream);
+
+	// Both queues pop the same elements in the same order
+	for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+		CHECK(loaded.Pop() == value);
+		CHECK(q.Pop() == value);
+	}
+	CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,853 @@
+/*
+*
+ *  BTree.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <type_traits>
+
+#include "NodePool.hpp"
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Ordering key of the B-tree elements. Inner nodes store only keys,
+/// so the types ordered by one field can specialize it to keep the inner nodes small
+/// @tparam T
+template<typename T>
+struct BTreeKey
+{
+    using type = T;
+
+    static const T& get(const T& value) { return value; }
+};
+
+/// @brief Default fanout: the node takes about four cache lines
+template<typename T>
+constexpr size_t kBTreeFanout = sizeof(T) * 4 < 256 ? 256 / sizeof(T) : 4;
+
+/// @brief B+tree to store comparative values.
+/// All elements are stored in the leaves, leaves are linked for the range scans.
+/// Inner nodes store only the separator keys, so the lookup touches few cache lines.
+/// Equal elements are kept, as in B23Tree
+/// @tparam T
+/// @tparam Fanout Maximum number of elements in the leaf and of children of the inner node
+/// @tparam Allocator Allocator of the tree nodes, NodePool by default
+template<typename T, size_t Fanout = kBTreeFanout<T>, template<typename> class Allocator = NodePool>
+class BTree {
+    static_assert(Fanout >= 4, "B-tree fanout must be at least 4");
+
+private:
+    using Key = typename BTreeKey<T>::type;
+
+    struct Node {
+        // Number of elements in the leaf, number of children in the inner node
+        size_t size = 0;
+        bool leaf;
+
+        explicit Node(bool leaf) : leaf(leaf) {}
+    };
+
+    struct Leaf : Node {
+        T data[Fanout];
+        Leaf* prev = nullptr;
+        Leaf* next = nullptr;
+
+        Leaf() : Node(true) {}
+    };
+
+    struct Inner : Node {
+        // keys[i] separates children[i] and children[i + 1]:
+        // elements of children[i] <= keys[i] <= elements of children[i + 1]
+        Key keys[Fanout - 1];
+        Node* children[Fanout];
+
+        Inner() : Node(false) {}
+    };
+
+    static constexpr size_t kMinLeafSize = Fanout / 2;
+    static constexpr size_t kMinInnerSize = (Fanout + 1) / 2;
+
+    Allocator<Leaf> leaves;
+    Allocator<Inner> inners;
+    Node* root = nullptr;
+    Leaf* first = nullptr;
+    Leaf* last = nullptr;
+    size_t count = 0;
+
+    static const Key& key(const T& value) { return BTreeKey<T>::get(value); }
+
+    static bool lessValue(const T& left, const T& right) { return key(left) < key(right); }
+
+    static bool equal(const Key& left, const Key& right) { return !(left < right) && !(right < left); }
+
+    static size_t minSize(const Node* node) { return node->leaf ? kMinLeafSize : kMinInnerSize; }
+
+    /// @brief Index of the child to insert the key into, after all equal elements
+    static size_t upperChild(const Inner* node, const Key& k) {
+        return std::upper_bound(node->keys, node->keys + node->size - 1, k) - node->keys;
+    }
+
+    /// @brief Index of the child that can contain the first element equal to the key
+    static size_t lowerChild(const Inner* node, const Key& k) {
+        return std::lower_bound(node->keys, node->keys + node->size - 1, k) - node->keys;
+    }
+
+    /// @brief Finds the first element with the key
+    /// @return The element, nullptr if there is none
+    T* find(const Key& k) const {
+        size_t pos;
+        Leaf* leaf = lowerBound(k, pos);
+        if (leaf && equal(key(leaf->data[pos]), k))
+            return &leaf->data[pos];
+        return nullptr;
+    }
+
+    /// @brief Finds the first element not less than the key
+    /// @param k Key to search
+    /// @param pos Position of the element in the leaf
+    /// @return Leaf of the element, nullptr if all elements are less
+    Leaf* lowerBound(const Key& k, size_t& pos) const {
+        if (!root)
+            return nullptr;
+
+        Node* node = root;
+        while (!node->leaf)
+            node = static_cast<Inner*>(node)->children[lowerChild(static_cast<Inner*>(node), k)];
+
+        Leaf* leaf = static_cast<Leaf*>(node);
+        pos = std::lower_bound(leaf->data, leaf->data + leaf->size, k,
+            [](const T& value, const Key& k) { return key(value) < k; }) - leaf->data;
+        if (pos == leaf->size) {
+            // Equal elements may start in the next leaf
+            leaf = leaf->next;
+            pos = 0;
+        }
+        return leaf;
+    }
+
+    /// @brief Inserts the value into the sorted leaf that has free space
+    static void insertAt(Leaf* leaf, size_t pos, T& data) {
+        std::move_backward(leaf->data + pos, leaf->data + leaf->size, leaf->data + leaf->size + 1);
+        leaf->data[pos] = std::move(data);
+        leaf->size++;
+    }
+
+    /// @brief Inserts the child and its separator into the inner node that has free space
+    static void insertChild(Inner* node, size_t index, Key& separator, Node* child) {
+        std::move_backward(node->keys + index, node->keys + node->size - 1, node->keys + node->size);
+        std::move_backward(node->children + index + 1, node->children + node->size, node->children + node->size + 1);
+        node->keys[index] = std::move(separator);
+        node->children[index + 1] = child;
+        node->size++;
+    }
+
+    /// @brief Inserts the value into the subtree, recursively
+    /// @param node Subtree root
+    /// @param data Value to insert, it is moved into the tree
+    /// @param separator Set to the first key of the new node if the subtree root is split
+    /// @return Right half of the split subtree root, nullptr if there was no split
+    Node* insert(Node* node, T& data, Key& separator) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            size_t pos = std::upper_bound(leaf->data, leaf->data + leaf->size, data, lessValue) - leaf->data;
+            if (leaf->size < Fanout) {
+                insertAt(leaf, pos, data);
+                return nullptr;
+            }
+
+            Leaf* right = leaves.Create();
+            size_t half = (Fanout + 1) / 2;
+            std::move(leaf->data + half, leaf->data + Fanout, right->data);
+            right->size = Fanout - half;
+            leaf->size = half;
+
+            right->next = leaf->next;
+            right->prev = leaf;
+            if (leaf->next)
+                leaf->next->prev = right;
+            else
+                last = right;
+            leaf->next = right;
+
+            if (pos <= half)
+                insertAt(leaf, pos, data);
+            else
+                insertAt(right, pos - half, data);
+
+            separator = key(right->data[0]);
+            return right;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t index = upperChild(inner, key(data));
+        Key child_separator;
+        Node* child = insert(inner->children[index], data, child_separator);
+        if (!child)
+            return nullptr;
+
+        if (inner->size < Fanout) {
+            insertChild(inner, index, child_separator, child);
+            return nullptr;
+        }
+
+        // Splitting Fanout + 1 children between two nodes
+        Key keys[Fanout];
+        Node* children[Fanout + 1];
+        std::move(inner->keys, inner->keys + index, keys);
+        keys[index] = std::move(child_separator);
+        std::move(inner->keys + index, inner->keys + Fanout - 1, keys + index + 1);
+        std::copy(inner->children, inner->children + index + 1, children);
+        children[index + 1] = child;
+        std::copy(inner->children + index + 1, inner->children + Fanout, children + index + 2);
+
+        Inner* right = inners.Create();
+        size_t half = (Fanout + 1) / 2;
+        std::move(keys, keys + half - 1, inner->keys);
+        std::copy(children, children + half, inner->children);
+        inner->size = half;
+
+        separator = std::move(keys[half - 1]);
+
+        std::move(keys + half, keys + Fanout, right->keys);
+        std::copy(children + half, children + Fanout + 1, right->children);
+        right->size = Fanout + 1 - half;
+        return right;
+    }
+
+    /// @brief Moves the last element of the left sibling to the child
+    void borrowFromLeft(Inner* parent, size_t index) {
+        Node* node = parent->children[index];
+        Node* left = parent->children[index - 1];
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            Leaf* sibling = static_cast<Leaf*>(left);
+            std::move_backward(leaf->data, leaf->data + leaf->size, leaf->data + leaf->size + 1);
+            leaf->data[0] = std::move(sibling->data[sibling->size - 1]);
+            parent->keys[index - 1] = key(leaf->data[0]);
+        }
+        else {
+            Inner* inner = static_cast<Inner*>(node);
+            Inner* sibling = static_cast<Inner*>(left);
+            std::move_backward(inner->keys, inner->keys + inner->size - 1, inner->keys + inner->size);
+            std::move_backward(inner->children, inner->children + inner->size, inner->children + inner->size + 1);
+            inner->keys[0] = std::move(parent->keys[index - 1]);
+            inner->children[0] = sibling->children[sibling->size - 1];
+            parent->keys[index - 1] = std::move(sibling->keys[sibling->size - 2]);
+        }
+        node->size++;
+        left->size--;
+    }
+
+    /// @brief Moves the first element of the right sibling to the child
+    void borrowFromRight(Inner* parent, size_t index) {
+        Node* node = parent->children[index];
+        Node* right = parent->children[index + 1];
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            Leaf* sibling = static_cast<Leaf*>(right);
+            leaf->data[leaf->size] = std::move(sibling->data[0]);
+            std::move(sibling->data + 1, sibling->data + sibling->size, sibling->data);
+            parent->keys[index] = key(sibling->data[0]);
+        }
+        else {
+            Inner* inner = static_cast<Inner*>(node);
+            Inner* sibling = static_cast<Inner*>(right);
+            inner->keys[inner->size - 1] = std::move(parent->keys[index]);
+            inner->children[inner->size] = sibling->children[0];
+            parent->keys[index] = std::move(sibling->keys[0]);
+            std::move(sibling->keys + 1, sibling->keys + sibling->size - 1, sibling->keys);
+            std::copy(sibling->children + 1, sibling->children + sibling->size, sibling->children);
+        }
+        node->size++;
+        right->size--;
+    }
+
+    /// @brief Merges the child with its right sibling and removes the sibling from the parent
+    void merge(Inner* parent, size_t index) {
+        Node* node = parent->children[index];
+        Node* right = parent->children[index + 1];
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            Leaf* sibling = static_cast<Leaf*>(right);
+            std::move(sibling->data, sibling->data + sibling->size, leaf->data + leaf->size);
+            leaf->size += sibling->size;
+
+            leaf->next = sibling->next;
+            if (sibling->next)
+                sibling->next->prev = leaf;
+            else
+                last = leaf;
+            leaves.Destroy(sibling);
+        }
+        else {
+            Inner* inner = static_cast<Inner*>(node);
+            Inner* sibling = static_cast<Inner*>(right);
+            inner->keys[inner->size - 1] = std::move(parent->keys[index]);
+            std::move(sibling->keys, sibling->keys + sibling->size - 1, inner->keys + inner->size);
+            std::copy(sibling->children, sibling->children + sibling->size, inner->children + inner->size);
+            inner->size += sibling->size;
+            inners.Destroy(sibling);
+        }
+
+        std::move(parent->keys + index + 1, parent->keys + parent->size - 1, parent->keys + index);
+        std::copy(parent->children + index + 2, parent->children + parent->size, parent->children + index + 1);
+        parent->size--;
+    }
+
+    /// @brief Restores the minimum size of the child after removal
+    void fixChild(Inner* parent, size_t index) {
+        Node* node = parent->children[index];
+        if (node->size >= minSize(node))
+            return;
+
+        Node* left = index > 0 ? parent->children[index - 1] : nullptr;
+        Node* right = index + 1 < parent->size ? parent->children[index + 1] : nullptr;
+
+        if (left && left->size > minSize(left))
+            borrowFromLeft(parent, index);
+        else if (right && right->size > minSize(right))
+            borrowFromRight(parent, index);
+        else if (left)
+            merge(parent, index - 1);
+        else
+            merge(parent, index);
+    }
+
+    /// @brief Removes the first element equal to the specified one, recursively
+    /// @return True if the element was found
+    bool remove(Node* node, const Key& k) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            T* pos = std::lower_bound(leaf->data, leaf->data + leaf->size, k,
+                [](const T& value, const Key& k) { return key(value) < k; });
+            if (pos == leaf->data + leaf->size || !equal(key(*pos), k))
+                return false;
+
+            std::move(pos + 1, leaf->data + leaf->size, pos);
+            leaf->size--;
+            return true;
+        }
+
+        // Equal elements may span several children
+        Inner* inner = static_cast<Inner*>(node);
+        for (size_t index = lowerChild(inner, k); index < inner->size; index++) {
+            if (remove(inner->children[index], k)) {
+                fixChild(inner, index);
+                return true;
+            }
+            if (index + 1 == inner->size || k < inner->keys[index])
+                break;
+        }
+        return false;
+    }
+
+    /// @brief Removes the maximum element of the subtree, recursively
+    void popMax(Node* node, T& max) {
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            max = std::move(leaf->data[leaf->size - 1]);
+            leaf->size--;
+            return;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        popMax(inner->children[inner->size - 1], max);
+        fixChild(inner, inner->size - 1);
+    }
+
+    /// @brief Replaces the root with its only child or releases the empty root
+    void shrinkRoot() {
+        if (root->leaf) {
+            if (root->size == 0) {
+                leaves.Destroy(static_cast<Leaf*>(root));
+                root = nullptr;
+                first = last = nullptr;
+            }
+        }
+        else if (root->size == 1) {
+            Inner* old_root = static_cast<Inner*>(root);
+            root = old_root->children[0];
+            inners.Destroy(old_root);
+        }
+    }
+
+    /// @brief Moves all elements out of the tree in sorted order.
+    /// Leaves are left with moved-from values and must be cleared afterwards
+    void moveOut(std::vector<T>& elements) {
+        for (Leaf* leaf = first; leaf; leaf = leaf->next)
+            std::move(leaf->data, leaf->data + leaf->size, std::back_inserter(elements));
+    }
+
+    /// @brief Builds the tree bottom-up from the sorted elements, replacing the current content.
+    /// Elements are spread evenly, so every node gets at least the minimum size
+    void build(std::vector<T>& sorted) {
+        clear();
+        if (sorted.empty())
+            return;
+
+        size_t leaves_count = (sorted.size() + Fanout - 1) / Fanout;
+        std::vector<Node*> level;
+        std::vector<Key> min_keys;
+        level.reserve(leaves_count);
+        min_keys.reserve(leaves_count);
+
+        auto cur = sorted.begin();
+        for (size_t i = 0; i < leaves_count; i++) {
+            size_t size = sorted.size() / leaves_count + (i < sorted.size() % leaves_count ? 1 : 0);
+            Leaf* leaf = leaves.Create();
+            std::move(cur, cur + size, leaf->data);
+            leaf->size = size;
+            cur += size;
+
+            leaf->prev = last;
+            if (last)
+                last->next = leaf;
+            else
+                first = leaf;
+            last = leaf;
+
+            level.push_back(leaf);
+            min_keys.push_back(key(leaf->data[0]));
+        }
+
+        while (level.size() > 1) {
+            size_t nodes_count = (level.size() + Fanout - 1) / Fanout;
+            std::vector<Node*> next_level;
+            std::vector<Key> next_min_keys;
+            next_level.reserve(nodes_count);
+            next_min_keys.reserve(nodes_count);
+
+            size_t start = 0;
+            for (size_t i = 0; i < nodes_count; i++) {
+                size_t size = level.size() / nodes_count + (i < level.size() % nodes_count ? 1 : 0);
+                Inner* inner = inners.Create();
+                std::copy(level.begin() + start, level.begin() + start + size, inner->children);
+                std::move(min_keys.begin() + start + 1, min_keys.begin() + start + size, inner->keys);
+                inner->size = size;
+
+                next_level.push_back(inner);
+                next_min_keys.push_back(std::move(min_keys[start]));
+                start += size;
+            }
+
+            level = std::move(next_level);
+            min_keys = std::move(next_min_keys);
+        }
+
+        root = level[0];
+        count = sorted.size();
+    }
+
+    size_t height() const {
+        size_t result = 0;
+        for (Node* node = root; node; node = node->leaf ? nullptr : static_cast<Inner*>(node)->children[0])
+            result++;
+        return result;
+    }
+
+    void clearRecursive(Node* node) {
+        if (node->leaf) {
+            leaves.Destroy(static_cast<Leaf*>(node));
+            return;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        for (size_t i = 0; i < inner->size; i++)
+            clearRecursive(inner->children[i]);
+        inners.Destroy(inner);
+    }
+
+public:
+
+    BTree() {}
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    /// @brief Inserts the specified value into the tree
+    /// @param data Value to insert
+    void append(T data) {
+        if (!root) {
+            Leaf* leaf = leaves.Create();
+            root = first = last = leaf;
+        }
+
+        Key separator;
+        Node* right = insert(root, data, separator);
+        if (right) {
+            Inner* new_root = inners.Create();
+            new_root->children[0] = root;
+            new_root->children[1] = right;
+            new_root->keys[0] = std::move(separator);
+            new_root->size = 2;
+            root = new_root;
+        }
+        count++;
+    }
+
+    /// @brief Inserts all elements at once: merges them with the tree content
+    /// and builds the tree bottom-up in O(N + M log M)
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements) {
+        std::stable_sort(elements.begin(), elements.end(), lessValue);
+
+        std::vector<T> merged;
+        merged.reserve(count + elements.size());
+        moveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end(), lessValue);
+
+        build(merged);
+    }
+
+    /// @brief Removes up to n maximum elements.
+    /// When a large part of the tree is removed, the rest is rebuilt in O(N)
+    /// instead of removing elements one by one
+    /// @param n Number of elements to remove
+    /// @param removed Container to append removed elements to, in descending order
+    /// @return Number of removed elements
+    size_t RemoveMaxN(size_t n, std::vector<T>& removed) {
+        n = std::min(n, count);
+        if (n * height() < count) {
+            for (size_t i = 0; i < n; i++)
+                removed.push_back(PopMax());
+            return n;
+        }
+
+        std::vector<T> elements;
+        elements.reserve(count);
+        moveOut(elements);
+        removed.insert(removed.end(),
+            std::make_move_iterator(elements.rbegin()), std::make_move_iterator(elements.rbegin() + n));
+
+        elements.resize(elements.size() - n);
+        build(elements);
+        return n;
+    }
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    /// @brief Removes the specified value from the tree
+    /// @param data Value to remove
+    void remove(const T& data)
+    {
+        if (!root || !remove(root, key(data)))
+            return;
+
+        count--;
+        shrinkRoot();
+    }
+
+    /// @brief Removes maximum element of the tree. The tree must not be empty
+    /// @return Maximum element, moved out of the tree
+    T PopMax()
+    {
+        T max;
+        popMax(root, max);
+        count--;
+        shrinkRoot();
+        return max;
+    }
+
+    bool GetElem(const T& data) const {
+        return Find(key(data)) != nullptr;
+    }
+
+    /// @brief Finds the first element with the key
+    /// @param k Key to search
+    /// @return The element, nullptr if there is none
+    const T* Find(const Key& k) const {
+        return find(k);
+    }
+
+    /// @brief Finds the first element with the key to change it in place.
+    /// The change must keep the key of the element
+    /// @return The element, nullptr if there is none
+    T* Find(const Key& k) {
+        return find(k);
+    }
+
+    /// @brief Collects elements of the range walking along the linked leaves
+    std::list<T> GetElementsByInterval(const T& min, const T& max) const {
+        std::list<T> elements;
+        size_t pos;
+        for (Leaf* leaf = lowerBound(key(min), pos); leaf; leaf = leaf->next, pos = 0) {
+            for (; pos < leaf->size; pos++) {
+                if (key(max) < key(leaf->data[pos]))
+                    return elements;
+                elements.push_back(leaf->data[pos]);
+            }
+        }
+        return elements;
+    }
+
+    /// @brief Represents tree as array
+    /// @param elements Container to save
+    void InOrder(std::vector<T>& elements) const {
+        for (Leaf* leaf = first; leaf; leaf = leaf->next)
+            elements.insert(elements.end(), leaf->data, leaf->data + leaf->size);
+    }
+
+    /// @brief Calls the function for the elements from the maximum down, along the linked leaves,
+    /// until it returns false
+    template<typename Visit>
+    void ForEachDescending(Visit visit) const {
+        for (Leaf* leaf = last; leaf; leaf = leaf->prev)
+            for (size_t i = leaf->size; i-- > 0; )
+                if (!visit(leaf->data[i]))
+                    return;
+    }
+
+    void print() const {
+        for (Leaf* leaf = first; leaf; leaf = leaf->next)
+            for (size_t i = 0; i < leaf->size; i++)
+                std::cout << leaf->data[i] << '\n';
+    }
+
+    void FillRandom(size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            T elem;
+            elem.random();
+            this->append(std::move(elem));
+        }
+    }
+
+    /// @brief Fills the tree with random elements using AppendRange
+    /// @param size Number of elements
+    void FillRange(size_t size) {
+        std::vector<T> elements(size);
+        for (T& elem : elements)
+            elem.random();
+        this->AppendRange(std::move(elements));
+    }
+
+    /// @brief Deletes all elements. Node pool releases trivially destructible nodes at once
+    void clear() {
+        if (!root)
+            return;
+
+        if (!(Allocator<Leaf>::kReleasesAll && std::is_trivially_destructible<Leaf>::value &&
+            std::is_trivially_destructible<Inner>::value))
+            clearRecursive(root);
+        leaves.Release();
+        inners.Release();
+
+        root = nullptr;
+        first = last = nullptr;
+        count = 0;
+    }
+
+    /// @brief Gets maximum element of the tree in O(1)
+    /// @return Maximum element of the tree
+    const T& GetMax() const
+    {
+        return last->data[last->size - 1];
+    }
+
+    /// @brief Gets maximum element of the tree in O(1) to change it in place.
+    /// The change must keep the key of the element
+    T& GetMax()
+    {
+        return last->data[last->size - 1];
+    }
+
+    bool IsEmpty() const
+    {
+        return root == nullptr;
+    }
+
+    ~BTree()
+    {
+        this->clear();
+    }
+
+#ifdef BENCHMARK_BENCHMARK_H_
+
+private:
+
+    static void append_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+        tree.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            T data;
+            data.random();
+            tree.append(data);
+        }
+    }
+
+    static void get_element_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+        tree.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        tree.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(tree.GetElem(elements[mersenne() % elements.size()]));
+        }
+    }
+
+    static void get_elements_interval_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+        tree.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        tree.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        size_t start, end;
+
+        for (auto _ : state) {
+            start = mersenne() % elements.size(); end = mersenne() % elements.size();
+            if (start > end) std::swap(start, end);
+            tree.GetElementsByInterval(elements[start], elements[end]);
+        }
+    }
+
+    static void remove_element_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+        tree.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        tree.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            tree.remove(elements[mersenne() % elements.size()]);
+        }
+    }
+
+    static void pop_max_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            tree.FillRange(state.range(0));
+            state.ResumeTiming();
+
+            while (!tree.IsEmpty())
+                benchmark::DoNotOptimize(tree.PopMax());
+        }
+    }
+
+    static void fill_random_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+
+        for (auto _ : state) {
+            tree.FillRandom(state.range(0));
+        }
+    }
+
+    static void fill_range_BTree_BM(benchmark::State& state)
+    {
+        BTree tree;
+
+        for (auto _ : state) {
+            tree.FillRange(state.range(0));
+        }
+    }
+
+    template<template<typename> class NodeAllocator>
+    static void churn_BTree_BM(benchmark::State& state)
+    {
+        BTree<T, Fanout, NodeAllocator> tree;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements)
+            elem.random();
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            for (const T& elem : elements)
+                tree.append(elem);
+            for (size_t i = 0; i < elements.size() / 2; i++)
+                tree.remove(elements[mersenne() % elements.size()]);
+            tree.clear();
+        }
+
+        state.SetItemsProcessed(state.iterations() * elements.size());
+        state.counters["RSS_KB"] = ResidentSetBytes() / 1024.0;
+    }
+
+public:
+
+    // Benchmarks are named as the B23Tree ones, so the results can be compared side by side
+
+    // Appends benchmarking function to the benchmarking queue
+    void append_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(append_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetElem_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_element_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetElementsByInterval_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_elements_interval_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void remove_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(remove_element_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void PopMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(pop_max_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRandom_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_random_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_range_BTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking functions to the benchmarking queue
+    // Compares insert/remove/clear throughput and memory of the node pool and plain new/delete
+    void Churn_BM(size_t maxElems, size_t iterations) {
+        benchmark::RegisterBenchmark("churn_BTree_BM<NodePool>", churn_BTree_BM<NodePool>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+        benchmark::RegisterBenchmark("churn_BTree_BM<NewDeleteAllocator>", churn_BTree_BM<NewDeleteAllocator>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+
+#endif
+
+};
+
+#undef private
+#undef protected
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+#include "BTree.hpp"
+#include "priority_queue.h"
+
+#include "doctest.h"
+
+// For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+
+/// @brief Queue buckets are ordered by priority only,
+/// so inner nodes of the B-tree store priorities instead of the buckets copies
+template<typename T>
+struct BTreeKey<Bucket<T>>
+{
+    using type = int;
+
+    static const int& get(const Bucket<T>& bucket) { return bucket.priority; }
+};
+
+
+template<typename T>
+class BTreePriorityQueue : public PriorityQueue<T>
+{
+public:
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+
+private:
+    // One bucket per priority, equal priorities are popped in arrival order
+    BTree<Bucket<T>> tree;
+
+    /// @return Bucket of the priority, nullptr if there is none
+    Bucket<T>* findBucket(int priority);
+
+    bool isEmpty() const override;
+};
+
+#undef private
+#undef protected
+
+template<typename T>
+inline T BTreePriorityQueue<T>::Peek() const
+{
+	if (this->isEmpty())
+		throw std::underflow_error("Queue is empty");
+	else {
+		return tree.GetMax().Front();
+	}
+}
+
+template<typename T>
+inline T BTreePriorityQueue<T>::Pop()
+{
+	if (this->isEmpty())
+		throw std::underflow_error("Queue is empty");
+	else {
+		Bucket<T>& top = tree.GetMax();
+		T data = top.Pop();
+		if (top.Empty())
+			tree.PopMax();
+		return data;
+	}
+}
+
+template<typename T>
+inline void BTreePriorityQueue<T>::Insert(T data, int priority)
+{
+	if (Bucket<T>* bucket = findBucket(priority))
+		bucket->Push(std::move(data));
+	else
+		tree.append(Bucket<T>(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t BTreePriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	size_t whole = 0, taken = 0;
+	tree.ForEachDescending([&](const Bucket<T>& bucket) {
+		if (taken + bucket.Size() > count)
+			return false;
+		taken += bucket.Size();
+		whole++;
+		return true;
+	});
+	return PopBuckets(tree, count, whole, taken, out);
+}
+
+template<typename T>
+inline void BTreePriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	// Items of the present priorities join their buckets, the new buckets are built into the tree at once
+	std::vector<Bucket<T>> added;
+	for (Bucket<T>& group : Bucket<T>::Group(items)) {
+		if (Bucket<T>* bucket = findBucket(group.priority))
+			bucket->Append(std::move(group));
+		else
+			added.push_back(std::move(group));
+	}
+	if (!added.empty())
+		tree.AppendRange(std::move(added));
+}
+
+template<typename T>
+inline Bucket<T>* BTreePriorityQueue<T>::findBucket(int priority)
+{
+	return tree.Find(priority);
+}
+
+template<typename T>
+inline void BTreePriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+	tree.ForEachDescending([&](const Bucket<T>& bucket) {
+		bucket.ForEach([&](const T& data) { visit(data, bucket.priority); });
+		return true;
+	});
+}
+
+template<typename T>
+inline bool BTreePriorityQueue<T>::isEmpty() const
+{
+	return tree.IsEmpty();
+}
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+	BTreePriorityQueue<int> q;
+
+	q.Insert(1111, 1);
+	CHECK(q.tree.first->data[0].Front() == 1111);
+
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	CHECK(q.tree.first->data[0].Front() == 1111);
+	CHECK(q.tree.first->data[1].Front() == 3333);
+	CHECK(q.tree.first->data[2].Front() == 2222);
+}
+
+TEST_CASE("Peek")
+{
+	BTreePriorityQueue<int> q;
+
+	CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+
+	CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+	BTreePriorityQueue<int> q;
+
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+
+	CHECK(q.Pop() == 2222);
+	CHECK(q.Pop() == 3333);
+	CHECK(q.Pop() == 1111);
+
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+	BTreePriorityQueue<int> q;
+
+	q.Insert(5555, 6);
+
+	std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+	q.InsertRange(items.begin(), items.end());
+
+	std::vector<int> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+	CHECK(q.PopN(3, popped) == 2);
+	CHECK(popped.back() == 1111);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bulk build of a large queue with equal priorities")
+{
+	BTreePriorityQueue<int> q;
+
+	std::vector<Item<int>> items;
+	for (int i = 0; i < 3000; i++)
+		items.push_back(Item<int>(i, (i * 7919) % 1000));
+	q.InsertRange(items.begin(), items.begin() + 1000);
+	for (int i = 1000; i < 2000; i++)
+		q.Insert(i, (i * 7919) % 1000);
+	q.InsertRange(items.begin() + 2000, items.end());
+
+	std::vector<int> popped;
+	q.PopN(2, popped);
+	q.PopN(1500, popped);
+	while (popped.size() < 3000)
+		popped.push_back(q.Pop());
+
+	for (size_t i = 1; i < popped.size(); i++)
+		CHECK((popped[i - 1] * 7919) % 1000 >= (popped[i] * 7919) % 1000);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("B-tree keeps order under random inserts and removals")
+{
+	BTree<int, 4> tree;
+	std::vector<int> expected;
+
+	for (int i = 0; i < 2000; i++) {
+		tree.append((i * 7919) % 500);
+		expected.push_back((i * 7919) % 500);
+	}
+	for (int i = 0; i < 2000; i += 3) {
+		int value = (i * 104729) % 600;
+		tree.remove(value);
+		auto found = std::find(expected.begin(), expected.end(), value);
+		if (found != expected.end())
+			expected.erase(found);
+	}
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<int> elements;
+	tree.InOrder(elements);
+	CHECK(elements == expected);
+	CHECK(tree.Size() == expected.size());
+	CHECK(tree.GetMax() == expected.back());
+	CHECK(tree.GetElem(expected[100]));
+	CHECK_FALSE(tree.GetElem(550));
+
+	std::list<int> interval = tree.GetElementsByInterval(100, 200);
+	CHECK(std::vector<int>(interval.begin(), interval.end()) ==
+		std::vector<int>(std::lower_bound(expected.begin(), expected.end(), 100),
+			std::upper_bound(expected.begin(), expected.end(), 200)));
+
+	while (!tree.IsEmpty()) {
+		CHECK(tree.PopMax() == expected.back());
+		expected.pop_back();
+	}
+	CHECK(expected.empty());
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+	BTreePriorityQueue<int> q;
+
+	for (int i = 0; i < 300; i++)
+		q.Insert(i, i % 3);
+	std::vector<Item<int>> items;
+	for (int i = 300; i < 600; i++)
+		items.push_back(Item<int>(i, i % 3));
+	q.InsertRange(items.begin(), items.end());
+	CHECK(q.tree.Size() == 3);
+
+	std::vector<int> popped;
+	q.PopN(50, popped);
+	q.Insert(600, 2);
+	while (popped.size() < 601)
+		popped.push_back(q.Pop());
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	CHECK(popped[0] == 2);
+	CHECK(popped[199] == 599);
+	CHECK(popped[200] == 600);
+	for (size_t i = 1; i < popped.size(); i++) {
+		if (popped[i - 1] % 3 == popped[i] % 3)
+			CHECK(popped[i - 1] < popped[i]);
+	}
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+	BTreePriorityQueue<CopyCounter> q;
+	CopyCounter::copies = 0;
+
+	q.Insert(CopyCounter(1111), 1);
+	q.Insert(CopyCounter(2222), 10);
+	q.Emplace(5, 3333);
+
+	std::vector<Item<CopyCounter>> items;
+	items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+	items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+	q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+	CHECK(q.Pop().value == 2222);
+	CHECK(q.Pop().value == 4444);
+
+	std::vector<CopyCounter> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped[0].value == 3333);
+	CHECK(popped[1].value == 5555);
+	CHECK(popped[2].value == 1111);
+
+	CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+	BTreePriorityQueue<int> q;
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	q.Insert(4444, 7);
+	q.Insert(5555, 5);
+
+	std::stringstream stream;
+	q.Save(stream);
+
+	BTreePriorityQueue<int> loaded;
+	loaded.Load(stream);
+
+	// Both queues pop the same elements in the same order
+	for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+		CHECK(loaded.Pop() == value);
+		CHECK(q.Pop() == value);
+	}
+	CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
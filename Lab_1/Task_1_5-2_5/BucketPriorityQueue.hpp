@@ -0,0 +1,359 @@
+/*
+*
+ *  BucketPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+#include "bit_scan.h"
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Priority queue for small non-negative integer priorities.
+/// Every priority from 0 to MaxPriority has its own FIFO bucket, and a two-level bitmap
+/// marks the non-empty ones, so the top bucket is found by two count-leading-zeros scans.
+/// Insert and Pop are O(1) and don't depend on the number of elements
+/// @tparam T
+/// @tparam MaxPriority Highest allowed priority, less than 4096
+template<typename T, int MaxPriority = 1023>
+class BucketPriorityQueue
+    : public PriorityQueue<T>
+{
+    static_assert(MaxPriority >= 0, "Bucket queue priorities start from 0");
+    static_assert(MaxPriority < 64 * 64, "Bucket queue bitmap has two levels of 64 bits");
+
+public:
+    BucketPriorityQueue();
+
+    /// @exception std::out_of_range Thrown when the priority is not in [0, MaxPriority]
+    void Insert(T data, int priority) override;
+    T Pop() override;
+    T Peek() const override;
+
+protected:
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+    void checkPriority(int priority) const override;
+
+private:
+    static constexpr int kWords = MaxPriority / 64 + 1;
+
+    std::vector<Bucket<T>> buckets;
+    // Bit i of words[w] is set when bucket w * 64 + i is not empty
+    uint64_t words[kWords] = {};
+    // Bit w is set when words[w] is not zero
+    uint64_t summary = 0;
+
+    bool isEmpty() const override;
+
+    /// @return Highest priority with a non-empty bucket. The queue must not be empty
+    int top() const;
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T, int MaxPriority>
+inline BucketPriorityQueue<T, MaxPriority>::BucketPriorityQueue()
+{
+    buckets.reserve(MaxPriority + 1);
+    for (int priority = 0; priority <= MaxPriority; priority++)
+        buckets.push_back(Bucket<T>(priority));
+}
+
+template<typename T, int MaxPriority>
+inline void BucketPriorityQueue<T, MaxPriority>::Insert(T data, int priority)
+{
+    checkPriority(priority);
+
+    Bucket<T>& bucket = buckets[priority];
+    if (bucket.Empty())
+    {
+        words[priority / 64] |= uint64_t(1) << (priority % 64);
+        summary |= uint64_t(1) << (priority / 64);
+    }
+    bucket.Push(std::move(data));
+}
+
+template<typename T, int MaxPriority>
+inline void BucketPriorityQueue<T, MaxPriority>::checkPriority(int priority) const
+{
+    if (priority < 0 || priority > MaxPriority)
+        throw std::out_of_range("Priority is out of the queue range");
+}
+
+template<typename T, int MaxPriority>
+inline T BucketPriorityQueue<T, MaxPriority>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+    {
+        int priority = top();
+        Bucket<T>& bucket = buckets[priority];
+        T data = bucket.Pop();
+
+        if (bucket.Empty())
+        {
+            uint64_t& word = words[priority / 64];
+            word &= ~(uint64_t(1) << (priority % 64));
+            if (word == 0)
+                summary &= ~(uint64_t(1) << (priority / 64));
+        }
+        return data;
+    }
+}
+
+template<typename T, int MaxPriority>
+inline T BucketPriorityQueue<T, MaxPriority>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+        return buckets[top()].Front();
+}
+
+template<typename T, int MaxPriority>
+inline void BucketPriorityQueue<T, MaxPriority>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    for (int priority = MaxPriority; priority >= 0; priority--)
+        buckets[priority].ForEach([&](const T& data) { visit(data, priority); });
+}
+
+template<typename T, int MaxPriority>
+inline bool BucketPriorityQueue<T, MaxPriority>::isEmpty() const
+{
+    return summary == 0;
+}
+
+template<typename T, int MaxPriority>
+inline int BucketPriorityQueue<T, MaxPriority>::top() const
+{
+    int word = HighestBit(summary);
+    return word * 64 + HighestBit(words[word]);
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    BucketPriorityQueue<int> q;
+
+    q.Insert(1111, 1);
+    CHECK(q.buckets[1].Front() == 1111);
+    CHECK(q.words[0] == 0b10);
+    CHECK(q.summary == 0b1);
+
+    q.Insert(2222, 1000);
+    q.Insert(3333, 5);
+    CHECK(q.buckets[1000].Front() == 2222);
+    CHECK(q.words[0] == 0b100010);
+    CHECK(q.words[15] == uint64_t(1) << (1000 % 64));
+    CHECK(q.summary == ((uint64_t(1) << 15) | 1));
+    CHECK(q.top() == 1000);
+
+    CHECK_THROWS_AS(q.Insert(4444, -1), const std::out_of_range&);
+    CHECK_THROWS_AS(q.Insert(4444, 1024), const std::out_of_range&);
+}
+
+TEST_CASE("Peek")
+{
+    BucketPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    BucketPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+    CHECK(q.summary == 0);
+    CHECK(q.words[0] == 0);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    BucketPriorityQueue<int, 99> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items;
+    for (int i = 0; i < 100; i++)
+        items.push_back(Item<int>(i, (i * 37) % 100));
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 27, 54, 81 });
+
+    CHECK(q.PopN(1000, popped) == 98);
+    CHECK(popped.back() == 0);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bucket queue pops in priority and arrival order")
+{
+    BucketPriorityQueue<int, 4095> q;
+    std::vector<int> expected;
+    std::mt19937 mersenne(7);
+
+    for (int i = 0; i < 5000; i++)
+        q.Insert(i, 0);
+    for (int i = 0; i < 5000; i++)
+        CHECK(q.Pop() == i);
+
+    // Priority is encoded in the value, arrival number is the lower part
+    for (int i = 0; i < 20000; i++)
+    {
+        int priority = mersenne() % 4096;
+        q.Insert((priority << 16) | i, priority);
+        if (i % 3 == 0)
+            expected.push_back(q.Pop());
+    }
+    while (!q.isEmpty())
+        expected.push_back(q.Pop());
+
+    CHECK(expected.size() == 20000);
+    for (size_t i = 1 + 20000 / 3; i < expected.size(); i++)
+    {
+        int prev = expected[i - 1] >> 16, cur = expected[i] >> 16;
+        CHECK(prev >= cur);
+        if (prev == cur)
+            CHECK((expected[i - 1] & 0xFFFF) < (expected[i] & 0xFFFF));
+    }
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    BucketPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    BucketPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    BucketPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+
+    // Nothing is inserted when a saved priority is out of the range
+    BucketPriorityQueue<int, 1023> wide;
+    wide.Insert(1111, 1);
+    wide.Insert(2222, 1000);
+    std::stringstream wide_stream;
+    wide.Save(wide_stream);
+    BucketPriorityQueue<int, 63> narrow;
+    CHECK_THROWS_AS(narrow.Load(wide_stream), const std::out_of_range&);
+    CHECK_THROWS_AS(narrow.Pop(), const std::underflow_error&);
+}
+
+#endif
+
+
+#ifdef BENCHMARK_BENCHMARK_H_
+
+/// @brief Benchmarks of the BucketPriorityQueue throughput
+/// @tparam T
+template<typename T>
+class BucketQueueBenchmark
+{
+private:
+    static void insert_pop_Bucket_BM(benchmark::State& state)
+    {
+        BucketPriorityQueue<T> queue;
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+        for (int64_t i = 0; i < state.range(0); i++)
+            queue.Insert(T(), mersenne() % 1024);
+
+        for (auto _ : state) {
+            queue.Insert(T(), mersenne() % 1024);
+            benchmark::DoNotOptimize(queue.Pop());
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+
+public:
+    // Appends benchmarking function to the benchmarking queue
+    // Reports Insert+Pop throughput on a queue holding 1 to maxElems elements
+    void InsertPop_BM(size_t maxElems) {
+        BENCHMARK(insert_pop_Bucket_BM)->RangeMultiplier(10)->Range(1, maxElems);
+    }
+};
+
+#endif // BENCHMARK_BENCHMARK_H_
@@ -13,18 +13,34 @@
 #include "Expression.h"
 
 #include <string>
+#include <utility>
+#include <algorithm>
+#include <cmath>
 
 #include "doctest.h"
+#include "HeapPriorityQueue.hpp"
+#include "AVLPriorityQueue.hpp"
 
 
 namespace expr
 {
+    const std::map<std::string, int> Expression::kFunctionsPriorities =
+    { {"sin", 1}, {"cos", 1}, {"tg", 1}, {"log", 2}, {"ln", 1}, {"^", 3},
+        {"*", 4}, {"/", 4}, {"+", 5}, {"-", 5}, {"(", 6} };
+
     Expression::Expression(const Expression& expr)
     {
         this->tree.root = expr.tree.Copy(expr.tree.root);
         this->vars = expr.get_vars();
     }
 
+    Expression::Expression(Expression&& expr) noexcept
+        : vars(std::move(expr.vars))
+    {
+        this->tree.root = expr.tree.root;
+        expr.tree.root = nullptr;
+    }
+
     /// @brief Parses expression into RPN (reverse polish notation),
     ///  then fill it in binary tree
     /// @param expression Expression to handle
@@ -48,10 +64,7 @@ namespace expr
     /// @param expression New data
     void Expression::LoadExpression(std::string expression) 
     {
-        this->tree.Clear(tree.root);
-        delete tree.root;
-
-        new (this) Expression(expression);
+        *this = Expression(expression);
     }
 
     Expression::Expression(ENode* expr) {
@@ -82,12 +95,65 @@ namespace expr
 
     Expression& Expression::operator=(const Expression& expr)
     {
+        if (this == &expr)
+            return *this;
+
         this->tree.Clear();
+        delete this->tree.root;
         this->tree.root = expr.tree.Copy(expr.tree.root);
         this->vars = expr.get_vars();
         return *this;
     }
 
+    Expression& Expression::operator=(Expression&& expr) noexcept
+    {
+        // Old tree goes to expr and is released with it
+        std::swap(this->tree.root, expr.tree.root);
+        this->vars = std::move(expr.vars);
+        return *this;
+    }
+
+    void Expression::Serialize(std::string& out) const
+    {
+        SerializeSubTree(tree.root, out);
+
+        WriteNumber(out, uint32_t(vars.size()));
+        for (const std::string& var : vars)
+            Serializer<std::string>::Write(out, var);
+    }
+
+    Expression Expression::Deserialize(ByteReader& in)
+    {
+        Expression expression;
+        DeserializeSubTree(&expression.tree.root, in);
+
+        uint32_t vars_count = in.ReadNumber<uint32_t>();
+        for (uint32_t i = 0; i < vars_count; i++)
+            expression.vars.push_back(Serializer<std::string>::Read(in));
+        return expression;
+    }
+
+    void Expression::SerializeSubTree(const ENode* node, std::string& out)
+    {
+        WriteNumber(out, uint8_t(node != nullptr));
+        if (node == nullptr)
+            return;
+
+        Serializer<std::string>::Write(out, node->data);
+        SerializeSubTree(node->left, out);
+        SerializeSubTree(node->right, out);
+    }
+
+    void Expression::DeserializeSubTree(ENode** root, ByteReader& in)
+    {
+        if (in.ReadNumber<uint8_t>() == 0)
+            return;
+
+        *root = new ENode(Serializer<std::string>::Read(in));
+        DeserializeSubTree(&(*root)->left, in);
+        DeserializeSubTree(&(*root)->right, in);
+    }
+
     void Expression::ProcessOperation(std::string function, 
         std::stack<std::string>& operators, std::vector<std::string>& rpn) const
     {
@@ -608,6 +674,75 @@ namespace expr
         CHECK(e.to_string() == "(x)+((10)^(y))");
     }
 
+    TEST_CASE("Moving expression")
+    {
+        Expression e("10*a+b");
+        Expression::ENode* root = e.tree.root;
+
+        Expression moved(std::move(e));
+        CHECK(moved.tree.root == root);
+        CHECK(e.tree.root == nullptr);
+
+        Expression assigned("x");
+        assigned = std::move(moved);
+        CHECK(assigned.tree.root == root);
+        CHECK(assigned.to_string() == "((10)*(a))+(b)");
+    }
+
+    TEST_CASE("Moving expressions through the queues")
+    {
+        // Trees are not copied: the popped expressions own the very nodes they were inserted with
+        auto check = [](PriorityQueue<Expression>& q) {
+            Expression inserted("10*a+b"), emplaced("sin(x)"), first("x-y"), second("2^z");
+            Expression::ENode* roots[] = { inserted.tree.root, emplaced.tree.root, first.tree.root, second.tree.root };
+
+            q.Insert(std::move(inserted), 1);
+            q.Emplace(4, std::move(emplaced));
+            std::vector<Item<Expression>> items;
+            items.push_back(Item<Expression>(std::move(first), 3));
+            items.push_back(Item<Expression>(std::move(second), 2));
+            q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+            Expression popped = q.Pop();
+            CHECK(popped.tree.root == roots[1]);
+            CHECK(popped.to_string() == "sin(x)");
+
+            std::vector<Expression> rest;
+            CHECK(q.PopN(3, rest) == 3);
+            CHECK(rest[0].tree.root == roots[2]);
+            CHECK(rest[1].tree.root == roots[3]);
+            CHECK(rest[2].tree.root == roots[0]);
+            CHECK(rest[2].to_string() == "((10)*(a))+(b)");
+        };
+
+        HeapPriorityQueue<Expression> heap;
+        check(heap);
+        AVLPriorityQueue<Expression> avl;
+        check(avl);
+    }
+
+    TEST_CASE("Serializing expression")
+    {
+        Expression e("sin(x)+10*y");
+        std::string bytes;
+        Serializer<Expression>::Write(bytes, e);
+
+        ByteReader in(bytes.data(), bytes.size());
+        Expression read = Serializer<Expression>::Read(in);
+        CHECK(read.to_string() == e.to_string());
+        CHECK(read.get_vars() == e.get_vars());
+        CHECK(in.Left() == 0);
+
+        ByteReader cut(bytes.data(), bytes.size() - 1);
+        CHECK_THROWS_AS(Serializer<Expression>::Read(cut), const std::runtime_error&);
+
+        // Empty expression has no tree
+        bytes.clear();
+        Serializer<Expression>::Write(bytes, Expression());
+        ByteReader empty(bytes.data(), bytes.size());
+        CHECK(Serializer<Expression>::Read(empty).tree.root == nullptr);
+    }
+
     TEST_CASE("Simplifie expression") {
         Expression e("(x-x)+2");
         e.Simplify();
@@ -18,6 +18,7 @@
 #include <map>
 
 #include "BinaryTree.h"
+#include "serialization.h"
 
 
  // For private methods unit testing
@@ -38,6 +39,8 @@ namespace expr
 		/// @exception std::runtime_error Thrown when there is invalid input in the expression
 		Expression() {};
 		Expression(const Expression&);
+		/// @brief Takes the expression tree of other expression without copying it
+		Expression(Expression&&) noexcept;
 
 		/// @brief Creates the expression based on the binary tree
 		/// @param expression 
@@ -71,7 +74,18 @@ namespace expr
 
 		std::vector<std::string> get_vars() const;
 
+		/// @brief Appends the expression tree and its variables to the bytes, used by Serializer<Expression>
+		/// @param out Bytes to append to
+		void Serialize(std::string& out) const;
+
+		/// @brief Restores the expression written by Serialize
+		/// @param in Bytes to read
+		/// @exception std::runtime_error Thrown when the bytes are cut
+		/// @return The expression
+		static Expression Deserialize(ByteReader& in);
+
 		Expression& operator=(const Expression &expr);
+		Expression& operator=(Expression&& expr) noexcept;
 
 	private:
 
@@ -79,9 +93,7 @@ namespace expr
 
 		Expression(ENode*);
 
-		const std::map<std::string, int> kFunctionsPriorities =
-		{ {"sin", 1}, {"cos", 1}, {"tg", 1}, {"log", 2}, {"ln", 1}, {"^", 3},
-			{"*", 4}, {"/", 4}, {"+", 5}, {"-", 5}, {"(", 6} };
+		static const std::map<std::string, int> kFunctionsPriorities;
 		std::vector<std::string> vars;
 
 		/// @brief Compares function's priority with precending function's priority
@@ -103,6 +115,18 @@ namespace expr
 		/// @param start Starting RPN element
 		void GenSubTree(ENode** root, std::vector<std::string>::iterator& start);
 
+		/// @brief Writes the subtree in preorder with a marker for every missing child
+		/// @param node Root of the subtree
+		/// @param out Bytes to append to
+		static void SerializeSubTree(const ENode* node, std::string& out);
+
+		/// @brief Restores the subtree written by SerializeSubTree.
+		/// Every node is linked to its parent before its children are read,
+		/// so the nodes read before an error are released with the tree
+		/// @param root Place for the root of the subtree
+		/// @param in Bytes to read
+		static void DeserializeSubTree(ENode** root, ByteReader& in);
+
 		/// @brief Changes variables in the expression tree into numbers
 		/// @param values Values of the variables
 		/// @param node Current node of the expression tree
@@ -132,7 +156,7 @@ namespace expr
 		/// @param arg_1 
 		/// @param arg_2 
 		/// @return Function value
-		double CalculateFunction(std::string function, double arg_1, double arg_2 = NULL) const;
+		double CalculateFunction(std::string function, double arg_1, double arg_2 = 0) const;
 
 		/// @brief Compares data of two Expression trees
 		/// @param root_1 First tree's root
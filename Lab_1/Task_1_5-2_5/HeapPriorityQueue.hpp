@@ -0,0 +1,331 @@
+/*
+*
+ *  HeapPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Priority queue based on the implicit d-ary max-heap stored in the array.
+/// Peek is O(1), Insert and Pop are O(log N)
+/// @tparam T
+/// @tparam Arity Number of children of each heap node
+template<typename T, size_t Arity = 2>
+class HeapPriorityQueue
+    : public PriorityQueue<T>
+{
+    static_assert(Arity >= 2, "Heap arity must be at least 2");
+
+private:
+    struct Item
+    {
+        T get_value() const { return value; };
+        const T& peek_value() const { return value; };
+        T take_value() { return std::move(value); };
+        int get_priority() const { return priority; };
+
+        Item(T value, int priority)
+            : value(std::move(value)), priority(priority) {}
+
+    private:
+        T value;
+        int priority;
+    };
+
+public:
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+protected:
+    void insertRange(std::vector<::Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+
+private:
+    std::vector<Item> heap;
+
+    bool isEmpty() const override;
+
+    static size_t parent(size_t index) { return (index - 1) / Arity; }
+    static size_t firstChild(size_t index) { return index * Arity + 1; }
+
+    /// @brief Moves the element up until its parent has not lower priority
+    /// @param index Index of the element to move
+    void siftUp(size_t index);
+
+    /// @brief Moves the element down until all of its children have not higher priority
+    /// @param index Index of the element to move
+    void siftDown(size_t index);
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T, size_t Arity>
+inline T HeapPriorityQueue<T, Arity>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+        return heap.front().peek_value();
+}
+
+template<typename T, size_t Arity>
+inline T HeapPriorityQueue<T, Arity>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+    {
+        T value = heap.front().take_value();
+
+        std::swap(heap.front(), heap.back());
+        heap.pop_back();
+        if (!heap.empty())
+            siftDown(0);
+
+        return value;
+    }
+}
+
+template<typename T, size_t Arity>
+inline void HeapPriorityQueue<T, Arity>::Insert(T data, int priority)
+{
+    heap.push_back(Item(std::move(data), priority));
+    siftUp(heap.size() - 1);
+}
+
+template<typename T, size_t Arity>
+inline void HeapPriorityQueue<T, Arity>::insertRange(std::vector<::Item<T>>& items)
+{
+    const size_t old_size = heap.size();
+
+    heap.reserve(old_size + items.size());
+    for (::Item<T>& item : items)
+        heap.push_back(Item(std::move(item.data), item.priority));
+
+    if (items.size() < old_size)
+    {
+        for (size_t i = old_size; i < heap.size(); i++)
+            siftUp(i);
+    }
+    else if (heap.size() > 1)
+    {
+        // Floyd's bottom-up heap construction, O(N)
+        for (size_t i = parent(heap.size() - 1) + 1; i-- > 0; )
+            siftDown(i);
+    }
+}
+
+template<typename T, size_t Arity>
+inline void HeapPriorityQueue<T, Arity>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // The heap doesn't order equal priorities, any order is the pop order
+    for (const Item& item : heap)
+        visit(item.peek_value(), item.get_priority());
+}
+
+template<typename T, size_t Arity>
+inline bool HeapPriorityQueue<T, Arity>::isEmpty() const
+{
+    return heap.empty();
+}
+
+template<typename T, size_t Arity>
+inline void HeapPriorityQueue<T, Arity>::siftUp(size_t index)
+{
+    while (index > 0)
+    {
+        size_t up = parent(index);
+        if (heap[up].get_priority() >= heap[index].get_priority())
+            break;
+
+        std::swap(heap[up], heap[index]);
+        index = up;
+    }
+}
+
+template<typename T, size_t Arity>
+inline void HeapPriorityQueue<T, Arity>::siftDown(size_t index)
+{
+    const size_t size = heap.size();
+
+    while (true)
+    {
+        size_t first = firstChild(index);
+        if (first >= size)
+            break;
+
+        size_t last = std::min(first + Arity, size);
+        size_t max_child = first;
+        for (size_t i = first + 1; i < last; i++)
+        {
+            if (heap[i].get_priority() > heap[max_child].get_priority())
+                max_child = i;
+        }
+
+        if (heap[index].get_priority() >= heap[max_child].get_priority())
+            break;
+
+        std::swap(heap[index], heap[max_child]);
+        index = max_child;
+    }
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    HeapPriorityQueue<int> q;
+
+    q.Insert(1111, 1);
+    CHECK(q.heap[0].get_value() == 1111);
+
+    q.Insert(2222, 10);
+    CHECK(q.heap[0].get_value() == 2222);
+    CHECK(q.heap[1].get_value() == 1111);
+
+    q.Insert(3333, 5);
+    CHECK(q.heap[0].get_value() == 2222);
+    CHECK(q.heap[2].get_value() == 3333);
+}
+
+TEST_CASE("Peek")
+{
+    HeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    HeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Pop from 4-ary heap")
+{
+    HeapPriorityQueue<int, 4> q;
+
+    for (int i = 0; i < 100; i++)
+        q.Insert(i, (i * 37) % 100);
+
+    int prev = 100;
+    for (int i = 0; i < 100; i++)
+    {
+        int value = q.Pop();
+        CHECK((value * 37) % 100 < prev);
+        prev = (value * 37) % 100;
+    }
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    HeapPriorityQueue<int, 3> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<::Item<int>> items;
+    for (int i = 0; i < 100; i++)
+        items.push_back(::Item<int>(i, (i * 37) % 100));
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 27, 54, 81 });
+
+    CHECK(q.PopN(1000, popped) == 98);
+    CHECK(popped.back() == 0);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    HeapPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<::Item<CopyCounter>> items;
+    items.push_back(::Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(::Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    HeapPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    HeapPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <algorithm>
 #include <stdexcept>
 
 #include "priority_queue.h"
@@ -23,9 +27,11 @@ private:
     {
     public:
         Node(T data, int priority, Node* next = nullptr)
-            : data(data), priority(priority), next(next) {}
+            : data(std::move(data)), priority(priority), next(next) {}
 
         T get_data() const { return data; };
+        const T& peek_data() const { return data; };
+        T take_data() { return std::move(data); };
         int get_priority() const { return priority; };
         void set_next(Node* next) { this->next = next; };
         Node* get_next() const { return next; }
@@ -52,12 +58,17 @@ public:
     T Peek() const override;
     T Pop() override;
     void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
 
     ~LinkedListPriorityQueue();
     
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
 
 private:
-    Node* head;
+    Node* head = nullptr;
 
     bool isEmpty() const override;
 };
@@ -66,6 +77,13 @@ private:
 #undef protected
 
 
+template<typename T>
+inline void LinkedListPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    for (Node* cur = head; cur != nullptr; cur = cur->get_next())
+        visit(cur->peek_data(), cur->get_priority());
+}
+
 template<typename T>
 inline bool LinkedListPriorityQueue<T>::isEmpty() const
 {
@@ -88,7 +106,7 @@ inline T LinkedListPriorityQueue<T>::Pop()
         throw std::underflow_error("The queue is empty");
     else {
         Node* temp = head;
-        T data = temp->get_data();
+        T data = temp->take_data();
         head = head->get_next();
         delete temp;
         return data;
@@ -99,9 +117,9 @@ template<typename T>
 inline void LinkedListPriorityQueue<T>::Insert(T data, int priority)
 {
     if (this->isEmpty())
-        head = new Node(data, priority, nullptr);
+        head = new Node(std::move(data), priority, nullptr);
     else if (head->get_priority() < priority) {
-        head = new Node(data, priority, head);
+        head = new Node(std::move(data), priority, head);
     }
     else 
     {
@@ -111,7 +129,47 @@ inline void LinkedListPriorityQueue<T>::Insert(T data, int priority)
         {
             cur = cur->get_next();
         }
-        cur->set_next(new Node(data, priority, cur->get_next()));
+        cur->set_next(new Node(std::move(data), priority, cur->get_next()));
+    }
+}
+
+template<typename T>
+inline size_t LinkedListPriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+    size_t popped = 0;
+    for (; popped < count && head != nullptr; popped++)
+    {
+        Node* temp = head;
+        out.push_back(temp->take_data());
+        head = head->get_next();
+        delete temp;
+    }
+    return popped;
+}
+
+template<typename T>
+inline void LinkedListPriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+    std::stable_sort(items.begin(), items.end(),
+        [](const Item<T>& left, const Item<T>& right) { return left.priority > right.priority; });
+
+    // Merges sorted items into the list in one pass
+    Node* prev = nullptr;
+    Node* cur = head;
+    for (Item<T>& item : items)
+    {
+        while (cur != nullptr && cur->get_priority() >= item.priority)
+        {
+            prev = cur;
+            cur = cur->get_next();
+        }
+
+        Node* node = new Node(std::move(item.data), item.priority, cur);
+        if (prev == nullptr)
+            head = node;
+        else
+            prev->set_next(node);
+        prev = node;
     }
 }
 
@@ -172,4 +230,71 @@ TEST_CASE("Pop")
     CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
 }
 
+TEST_CASE("Insert range and pop several elements")
+{
+    LinkedListPriorityQueue<int> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+    CHECK(q.PopN(3, popped) == 2);
+    CHECK(popped.back() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    LinkedListPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    LinkedListPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    LinkedListPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 5555, 3333, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
 #endif
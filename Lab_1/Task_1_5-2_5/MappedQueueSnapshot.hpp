@@ -0,0 +1,328 @@
+/*
+*
+ *  MappedQueueSnapshot.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "serialization.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Read-only view of the queue saved by PriorityQueue::Save, mapped into memory.
+/// Opening reads the header and finds the top record, the elements are deserialised only when asked for.
+/// The tree based queues save their elements in pop order, so the top is the first record
+/// and the snapshot opens in O(1) whatever its size. Snapshots of the other queues scan
+/// the record headers once to find the top, still without deserialising the elements.
+/// The pages are shared with the file cache, so the processes peeking one snapshot keep one copy of it
+/// @tparam T
+template<typename T>
+class MappedQueueSnapshot
+{
+public:
+    /// @param path Saved queue
+    /// @exception std::runtime_error Thrown when the file can't be mapped or is not a saved queue
+    explicit MappedQueueSnapshot(const std::string& path);
+    ~MappedQueueSnapshot();
+
+    MappedQueueSnapshot(const MappedQueueSnapshot&) = delete;
+    MappedQueueSnapshot& operator=(const MappedQueueSnapshot&) = delete;
+
+    /// @brief Deserialises the element with the highest priority
+    /// @exception std::underflow_error Thrown when the saved queue is empty
+    /// @return Element's value
+    T Peek() const;
+
+    /// @brief Priority of the top element, nothing is deserialised
+    /// @exception std::underflow_error Thrown when the saved queue is empty
+    int TopPriority() const;
+
+    size_t Size() const { return size_t(header.count); }
+    bool Empty() const { return header.count == 0; }
+
+    /// @return Whether the records are in the order the elements are popped
+    bool InPopOrder() const { return header.InPopOrder(); }
+
+    /// @brief Calls the function for every record in the file order. The elements stay serialised,
+    /// QueueRecord::Element<T>() deserialises the needed ones
+    /// @exception std::runtime_error Thrown when the file is cut
+    template<typename Visit>
+    void ForEach(Visit visit) const;
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    QueueFileHeader header;
+    // The earliest record of the highest priority
+    QueueRecord top;
+
+    void map(const std::string& path);
+    void unmap();
+
+    /// @return Reader over the records after the header
+    ByteReader records() const;
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T>
+inline MappedQueueSnapshot<T>::MappedQueueSnapshot(const std::string& path)
+{
+    map(path);
+    try {
+        ByteReader in(data, length);
+        header = QueueFileHeader::Read(in);
+
+        if (header.count == 0)
+            return;
+        if (header.InPopOrder()) {
+            top = QueueRecord::Read(in);
+            return;
+        }
+        // Records of equal priorities are in pop order, the first one of the highest is the top
+        bool found = false;
+        ForEach([&](const QueueRecord& record) {
+            if (!found || record.priority > top.priority) {
+                top = record;
+                found = true;
+            }
+        });
+    }
+    catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+template<typename T>
+inline MappedQueueSnapshot<T>::~MappedQueueSnapshot()
+{
+    unmap();
+}
+
+template<typename T>
+inline T MappedQueueSnapshot<T>::Peek() const
+{
+    if (this->Empty())
+        throw std::underflow_error("The queue is empty");
+    else {
+        return top.template Element<T>();
+    }
+}
+
+template<typename T>
+inline int MappedQueueSnapshot<T>::TopPriority() const
+{
+    if (this->Empty())
+        throw std::underflow_error("The queue is empty");
+    return top.priority;
+}
+
+template<typename T>
+template<typename Visit>
+inline void MappedQueueSnapshot<T>::ForEach(Visit visit) const
+{
+    ByteReader in = records();
+    for (uint64_t i = 0; i < header.count; i++)
+        visit(QueueRecord::Read(in));
+}
+
+template<typename T>
+inline ByteReader MappedQueueSnapshot<T>::records() const
+{
+    return ByteReader(data + QueueFileHeader::kSize, length - QueueFileHeader::kSize);
+}
+
+template<typename T>
+inline void MappedQueueSnapshot<T>::map(const std::string& path)
+{
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Can't open " + path);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || uint64_t(size.QuadPart) < QueueFileHeader::kSize) {
+        unmap();
+        throw std::runtime_error("Not a saved priority queue: " + path);
+    }
+    length = size_t(size.QuadPart);
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        unmap();
+        throw std::runtime_error("Can't map " + path);
+    }
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("Can't open " + path);
+
+    struct stat info;
+    if (::fstat(file, &info) != 0 || size_t(info.st_size) < QueueFileHeader::kSize) {
+        ::close(file);
+        throw std::runtime_error("Not a saved priority queue: " + path);
+    }
+    length = size_t(info.st_size);
+
+    // The mapping keeps the file open by itself
+    void* view = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED)
+        throw std::runtime_error("Can't map " + path);
+    data = static_cast<const char*>(view);
+#endif
+}
+
+template<typename T>
+inline void MappedQueueSnapshot<T>::unmap()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data)
+        ::munmap(const_cast<char*>(data), length);
+#endif
+    data = nullptr;
+    length = 0;
+}
+
+
+#ifdef _DEBUG
+#include <fstream>
+#include <cstdio>
+#include <vector>
+
+#include "ArrayPriorityQueue.hpp"
+#include "AVLPriorityQueue.hpp"
+
+TEST_CASE("Snapshot of the tree based queue")
+{
+    const char* path = "mapped_queue_snapshot_test.bin";
+
+    AVLPriorityQueue<std::string> q;
+    q.Insert("1111", 1);
+    q.Insert("2222", 10);
+    q.Insert("3333", 5);
+    q.Insert("4444", 7);
+    q.Insert("5555", 5);
+    {
+        std::ofstream out(path, std::ios::binary);
+        q.Save(out);
+    }
+
+    {
+        MappedQueueSnapshot<std::string> snapshot(path);
+        CHECK(snapshot.Size() == 5);
+        CHECK(snapshot.InPopOrder());
+        CHECK(snapshot.TopPriority() == 10);
+        CHECK(snapshot.Peek() == "2222");
+
+        std::vector<std::string> values;
+        std::vector<int> priorities;
+        snapshot.ForEach([&](const QueueRecord& record) {
+            values.push_back(record.Element<std::string>());
+            priorities.push_back(record.priority);
+        });
+        CHECK(values == std::vector<std::string>{ "2222", "4444", "3333", "5555", "1111" });
+        CHECK(priorities == std::vector<int>{ 10, 7, 5, 5, 1 });
+    }
+    std::remove(path);
+}
+
+TEST_CASE("Snapshot of the unordered queue is scanned for the top")
+{
+    const char* path = "mapped_queue_snapshot_test.bin";
+
+    ArrayPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 10);
+    {
+        std::ofstream out(path, std::ios::binary);
+        q.Save(out);
+    }
+
+    {
+        MappedQueueSnapshot<int> snapshot(path);
+        CHECK(!snapshot.InPopOrder());
+        CHECK(snapshot.TopPriority() == 10);
+        // The earliest of the equal priorities
+        CHECK(snapshot.Peek() == 2222);
+    }
+    std::remove(path);
+}
+
+TEST_CASE("Snapshot of the empty queue and of the invalid file")
+{
+    const char* path = "mapped_queue_snapshot_test.bin";
+    {
+        AVLPriorityQueue<int> q;
+        std::ofstream out(path, std::ios::binary);
+        q.Save(out);
+    }
+
+    {
+        MappedQueueSnapshot<int> snapshot(path);
+        CHECK(snapshot.Empty());
+        CHECK_THROWS_AS(snapshot.Peek(), const std::underflow_error&);
+        CHECK_THROWS_AS(snapshot.TopPriority(), const std::underflow_error&);
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not a saved queue";
+    }
+    CHECK_THROWS_AS(MappedQueueSnapshot<int>{ path }, const std::runtime_error&);
+
+    std::remove(path);
+    CHECK_THROWS_AS(MappedQueueSnapshot<int>{ path }, const std::runtime_error&);
+}
+#endif
@@ -0,0 +1,426 @@
+/*
+*
+ *  MultiQueuePriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <iterator>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <limits>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "item.h"
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Thread-safe relaxed priority queue (MultiQueue).
+/// Elements are spread over several independently locked binary heaps.
+/// Insert pushes into a random heap, Pop takes the better top of two random heaps,
+/// so threads rarely contend for the same lock. The price is relaxed ordering:
+/// Pop returns one of the highest priority elements, not necessarily the highest one.
+/// With a single heap the queue is strict.
+/// @tparam T
+template<typename T>
+class MultiQueuePriorityQueue
+    : public PriorityQueue<T>
+{
+private:
+    static constexpr long long kEmpty = std::numeric_limits<long long>::min();
+
+    struct alignas(64) SubQueue
+    {
+        std::mutex lock;
+        std::vector<Item<T>> heap;
+        // Priority of the top element, read without locking
+        std::atomic<long long> top{ kEmpty };
+    };
+
+public:
+    /// @param queues_count Number of the internal heaps, two per hardware thread by default
+    explicit MultiQueuePriorityQueue(size_t queues_count = 0);
+
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+    size_t Size() const { return size.load(std::memory_order_relaxed); }
+
+protected:
+    /// @brief Splits items into equal chunks, each heap is locked once for its chunk
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+
+private:
+    mutable std::vector<SubQueue> queues;
+    std::atomic<size_t> size{ 0 };
+
+    bool isEmpty() const override;
+
+    static bool lowerPriority(const Item<T>& left, const Item<T>& right)
+    {
+        return left.priority < right.priority;
+    }
+
+    /// @brief Takes the top element of the locked heap
+    T popLocked(SubQueue& queue);
+
+    /// @brief Refreshes top priority hint of the locked heap
+    static void updateTop(SubQueue& queue);
+
+    size_t randomQueue() const;
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T>
+inline MultiQueuePriorityQueue<T>::MultiQueuePriorityQueue(size_t queues_count)
+    : queues(queues_count ? queues_count :
+        std::max<size_t>(2 * std::thread::hardware_concurrency(), 2))
+{
+}
+
+template<typename T>
+inline T MultiQueuePriorityQueue<T>::Peek() const
+{
+    size_t best = 0;
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        if (queues[i].top.load(std::memory_order_relaxed) >
+            queues[best].top.load(std::memory_order_relaxed))
+            best = i;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(queues[best].lock);
+        if (!queues[best].heap.empty())
+            return queues[best].heap.front().data;
+    }
+
+    // Hint was stale, take the best top of every heap
+    std::optional<T> top;
+    int top_priority = 0;
+    for (SubQueue& queue : queues)
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (!queue.heap.empty() && (!top || queue.heap.front().priority > top_priority))
+        {
+            top = queue.heap.front().data;
+            top_priority = queue.heap.front().priority;
+        }
+    }
+    if (!top)
+        throw std::underflow_error("The queue is empty");
+    return std::move(*top);
+}
+
+template<typename T>
+inline T MultiQueuePriorityQueue<T>::Pop()
+{
+    const size_t kAttempts = 8;
+
+    for (size_t attempt = 0; attempt < kAttempts && !this->isEmpty(); attempt++)
+    {
+        size_t i = randomQueue(), j = randomQueue();
+        SubQueue& queue = queues[i].top.load(std::memory_order_relaxed) >=
+            queues[j].top.load(std::memory_order_relaxed) ? queues[i] : queues[j];
+
+        if (queue.top.load(std::memory_order_relaxed) == kEmpty)
+            continue;
+
+        std::unique_lock<std::mutex> guard(queue.lock, std::try_to_lock);
+        if (!guard.owns_lock() || queue.heap.empty())
+            continue;
+
+        return popLocked(queue);
+    }
+
+    // Heaps are mostly empty or contended, so scan all of them
+    size_t start = randomQueue();
+    for (size_t k = 0; k < queues.size(); k++)
+    {
+        SubQueue& queue = queues[(start + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (!queue.heap.empty())
+            return popLocked(queue);
+    }
+    throw std::underflow_error("The queue is empty");
+}
+
+template<typename T>
+inline void MultiQueuePriorityQueue<T>::Insert(T data, int priority)
+{
+    while (true)
+    {
+        SubQueue& queue = queues[randomQueue()];
+
+        std::unique_lock<std::mutex> guard(queue.lock, std::try_to_lock);
+        if (!guard.owns_lock())
+            continue;
+
+        queue.heap.push_back(Item<T>(std::move(data), priority));
+        std::push_heap(queue.heap.begin(), queue.heap.end(), lowerPriority);
+        updateTop(queue);
+        size.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+template<typename T>
+inline void MultiQueuePriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+    const size_t chunk = (items.size() + queues.size() - 1) / queues.size();
+    const size_t start = randomQueue();
+
+    for (size_t k = 0; k * chunk < items.size(); k++)
+    {
+        SubQueue& queue = queues[(start + k) % queues.size()];
+        auto first = items.begin() + k * chunk;
+        auto last = items.begin() + std::min(items.size(), (k + 1) * chunk);
+
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.heap.insert(queue.heap.end(),
+            std::make_move_iterator(first), std::make_move_iterator(last));
+        std::make_heap(queue.heap.begin(), queue.heap.end(), lowerPriority);
+        updateTop(queue);
+    }
+    size.fetch_add(items.size(), std::memory_order_relaxed);
+}
+
+template<typename T>
+inline void MultiQueuePriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // All heaps are locked at once, so the visited elements are one state of the queue.
+    // Other methods hold one lock at a time, locking in index order can't deadlock with them
+    std::vector<std::unique_lock<std::mutex>> guards;
+    guards.reserve(queues.size());
+    for (SubQueue& queue : queues)
+        guards.emplace_back(queue.lock);
+
+    for (const SubQueue& queue : queues)
+    {
+        for (const Item<T>& item : queue.heap)
+            visit(item.data, item.priority);
+    }
+}
+
+template<typename T>
+inline bool MultiQueuePriorityQueue<T>::isEmpty() const
+{
+    return size.load(std::memory_order_relaxed) == 0;
+}
+
+template<typename T>
+inline T MultiQueuePriorityQueue<T>::popLocked(SubQueue& queue)
+{
+    std::pop_heap(queue.heap.begin(), queue.heap.end(), lowerPriority);
+    T data = std::move(queue.heap.back().data);
+    queue.heap.pop_back();
+    updateTop(queue);
+    size.fetch_sub(1, std::memory_order_relaxed);
+    return data;
+}
+
+template<typename T>
+inline void MultiQueuePriorityQueue<T>::updateTop(SubQueue& queue)
+{
+    queue.top.store(queue.heap.empty() ? kEmpty : queue.heap.front().priority,
+        std::memory_order_relaxed);
+}
+
+template<typename T>
+inline size_t MultiQueuePriorityQueue<T>::randomQueue() const
+{
+    thread_local std::minstd_rand generator(
+        static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+    return generator() % queues.size();
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    MultiQueuePriorityQueue<int> q(1);
+
+    q.Insert(1111, 1);
+    CHECK(q.queues[0].heap[0].data == 1111);
+
+    q.Insert(2222, 10);
+    CHECK(q.queues[0].heap[0].data == 2222);
+    CHECK(q.queues[0].top == 10);
+
+    q.Insert(3333, 5);
+    CHECK(q.Size() == 3);
+}
+
+TEST_CASE("Peek")
+{
+    MultiQueuePriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Peek with a stale hint")
+{
+    MultiQueuePriorityQueue<int> q(4);
+    q.queues[1].heap.push_back(Item<int>(1111, 1));
+    q.queues[2].heap.push_back(Item<int>(2222, 10));
+    q.queues[3].heap.push_back(Item<int>(3333, 5));
+    q.size = 3;
+
+    // The hinted heap is empty, the best top of the others is taken
+    q.queues[0].top = 100;
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    MultiQueuePriorityQueue<int> q(1);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    MultiQueuePriorityQueue<int> q(1);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 3333 });
+
+    CHECK(q.PopN(3, popped) == 1);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Concurrent insert and pop")
+{
+    const int kProducers = 4, kConsumers = 4, kPerProducer = 20000;
+
+    MultiQueuePriorityQueue<int> q(8);
+    std::vector<std::atomic<int>> popped(kProducers * kPerProducer);
+    std::atomic<int> popped_total{ 0 };
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; p++)
+    {
+        threads.emplace_back([&q, p]() {
+            for (int i = 0; i < kPerProducer; i++)
+                q.Insert(p * kPerProducer + i, (i * 7919) % 1000);
+        });
+    }
+    for (int c = 0; c < kConsumers; c++)
+    {
+        threads.emplace_back([&]() {
+            while (popped_total.load() < kProducers * kPerProducer)
+            {
+                try {
+                    popped[q.Pop()]++;
+                    popped_total++;
+                }
+                catch (std::underflow_error&) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK(q.Size() == 0);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+    CHECK(std::all_of(popped.begin(), popped.end(),
+        [](const std::atomic<int>& count) { return count == 1; }));
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    MultiQueuePriorityQueue<CopyCounter> q(1);
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    MultiQueuePriorityQueue<int> q(4);
+    for (int i = 0; i < 100; i++)
+        q.Insert(i, i);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    MultiQueuePriorityQueue<int> loaded(4);
+    loaded.Load(stream);
+    CHECK(loaded.Size() == 100);
+
+    // Pop order is relaxed, but all elements are there
+    std::vector<int> popped;
+    CHECK(loaded.PopN(100, popped) == 100);
+    std::sort(popped.begin(), popped.end());
+    for (int i = 0; i < 100; i++)
+        CHECK(popped[size_t(i)] == i);
+}
+
+#endif
+
@@ -0,0 +1,225 @@
+/*
+*
+ *  NodePool.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Slab allocator for the tree nodes with the free list.
+/// Nodes are carved one after another from large slabs, destroyed nodes are reused first.
+/// Release forgets all nodes at once in O(1) and keeps the slabs for the next nodes.
+/// Trees take the allocator as a template parameter: Allocator<Node>
+/// @tparam Node
+template<typename Node>
+class NodePool
+{
+public:
+    /// @brief True if Release frees the memory of all nodes, so the tree doesn't have to
+    /// destroy them one by one when the nodes are trivially destructible
+    static constexpr bool kReleasesAll = true;
+
+    NodePool() {}
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    /// @brief Constructs the node in the pool
+    /// @param args Arguments of the node's constructor
+    /// @return Created node
+    template<typename... Args>
+    Node* Create(Args&&... args);
+
+    /// @brief Destroys the node and returns its memory to the pool
+    void Destroy(Node* node);
+
+    /// @brief Forgets all nodes at once. Destructors are not called,
+    /// so the nodes with non-trivial destructors must be destroyed before
+    void Release();
+
+    /// @return Memory taken by the slabs, in bytes
+    size_t ReservedBytes() const { return slabs.size() * kSlabSlots * sizeof(Slot); }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    static constexpr size_t kSlabBytes = 64 * 1024;
+    static constexpr size_t kSlabSlots = sizeof(Slot) < kSlabBytes ? kSlabBytes / sizeof(Slot) : 1;
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    // Number of slabs the slots are carved from, the rest are spare
+    size_t carved = 0;
+    // Carved slots of the last carved slab
+    size_t used = kSlabSlots;
+    Slot* free_list = nullptr;
+
+    Slot* allocate();
+    void deallocate(Slot* slot);
+};
+
+/// @brief Allocator with the same interface as NodePool,
+/// that allocates each node separately on the heap
+/// @tparam Node
+template<typename Node>
+class NewDeleteAllocator
+{
+public:
+    static constexpr bool kReleasesAll = false;
+
+    template<typename... Args>
+    Node* Create(Args&&... args) { return new Node(std::forward<Args>(args)...); }
+
+    void Destroy(Node* node) { delete node; }
+
+    void Release() {}
+
+    /// @return Nothing is reserved, the nodes don't depend on the allocator
+    size_t ReservedBytes() const { return 0; }
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename Node>
+template<typename... Args>
+inline Node* NodePool<Node>::Create(Args&&... args)
+{
+    Slot* slot = allocate();
+    try {
+        return new (slot->storage) Node(std::forward<Args>(args)...);
+    }
+    catch (...) {
+        deallocate(slot);
+        throw;
+    }
+}
+
+template<typename Node>
+inline void NodePool<Node>::Destroy(Node* node)
+{
+    node->~Node();
+    deallocate(reinterpret_cast<Slot*>(node));
+}
+
+template<typename Node>
+inline void NodePool<Node>::Release()
+{
+    carved = 0;
+    used = kSlabSlots;
+    free_list = nullptr;
+}
+
+template<typename Node>
+inline typename NodePool<Node>::Slot* NodePool<Node>::allocate()
+{
+    if (free_list) {
+        Slot* slot = free_list;
+        free_list = slot->next;
+        return slot;
+    }
+
+    if (used == kSlabSlots) {
+        if (carved == slabs.size())
+            slabs.emplace_back(new Slot[kSlabSlots]);
+        carved++;
+        used = 0;
+    }
+    return &slabs[carved - 1][used++];
+}
+
+template<typename Node>
+inline void NodePool<Node>::deallocate(Slot* slot)
+{
+    slot->next = free_list;
+    free_list = slot;
+}
+
+
+#ifdef BENCHMARK_BENCHMARK_H_
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fstream>
+#include <unistd.h>
+#endif
+
+/// @brief Resident set size of the process for the benchmark counters
+/// @return Size in bytes, 0 if unknown
+inline size_t ResidentSetBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#else
+    size_t total = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    if (statm >> total >> resident)
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return 0;
+#endif
+}
+
+#endif // BENCHMARK_BENCHMARK_H_
+
+
+#ifdef _DEBUG
+TEST_CASE("Node pool reuses destroyed nodes")
+{
+    NodePool<std::pair<int, int>> pool;
+
+    std::pair<int, int>* first = pool.Create(1, 2);
+    std::pair<int, int>* second = pool.Create(3, 4);
+    CHECK(second == first + 1);
+    CHECK(pool.ReservedBytes() > 0);
+
+    pool.Destroy(first);
+    CHECK(pool.Create(5, 6) == first);
+    CHECK(first->first == 5);
+}
+
+TEST_CASE("Node pool release")
+{
+    NodePool<int> pool;
+
+    std::vector<int*> nodes;
+    for (int i = 0; i < 100000; i++)
+        nodes.push_back(pool.Create(i));
+    size_t reserved = pool.ReservedBytes();
+
+    pool.Release();
+    CHECK(pool.Create(-1) == nodes[0]);
+    for (int i = 1; i < 100000; i++)
+        pool.Create(i);
+    CHECK(pool.ReservedBytes() == reserved);
+}
+
+#endif
@@ -0,0 +1,522 @@
+/*
+*
+ *  PairingHeapPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <stdexcept>
+
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Mergeable priority queue based on the pairing max-heap.
+/// Insert returns a handle, that stays valid until the element leaves the queue,
+/// so the element's priority can be changed or the element can be erased in place.
+/// Insert, IncreaseKey and Meld are O(1), Pop, DecreaseKey and Erase are O(log N) amortized
+/// @tparam T
+template<typename T>
+class PairingHeapPriorityQueue
+    : public PriorityQueue<T>
+{
+private:
+    struct Node
+    {
+        T data;
+        int priority;
+        Node* child = nullptr;
+        Node* next = nullptr;
+        // Previous sibling, or parent for the first child
+        Node* prev = nullptr;
+
+        Node(T data, int priority)
+            : data(std::move(data)), priority(priority) {}
+    };
+
+public:
+    /// @brief Stable reference to the queue element
+    class Handle
+    {
+    public:
+        Handle() {}
+
+        bool operator==(const Handle& other) const { return node == other.node; }
+        bool operator!=(const Handle& other) const { return node != other.node; }
+
+    private:
+        Node* node = nullptr;
+
+        Handle(Node* node) : node(node) {}
+
+        friend class PairingHeapPriorityQueue;
+    };
+
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+    /// @brief Inserts element with it's priority
+    /// @return Handle of the inserted element
+    Handle Push(T data, int priority);
+
+    /// @brief Raises priority of the element
+    /// @exception std::invalid_argument Thrown when new priority is lower than current
+    void IncreaseKey(Handle handle, int priority);
+
+    /// @brief Lowers priority of the element
+    /// @exception std::invalid_argument Thrown when new priority is higher than current
+    void DecreaseKey(Handle handle, int priority);
+
+    /// @brief Sets new priority of the element, whichever direction it is
+    void ChangePriority(Handle handle, int priority);
+
+    /// @brief Removes the element from the queue
+    /// @return Element's value
+    T Erase(Handle handle);
+
+    int GetPriority(Handle handle) const { return handle.node->priority; }
+    T GetData(Handle handle) const { return handle.node->data; }
+
+    /// @brief Moves all elements of other queue into this one. Other queue becomes empty.
+    /// Handles of the moved elements remain valid
+    /// @param other Queue to merge with
+    void Meld(PairingHeapPriorityQueue& other);
+
+    PairingHeapPriorityQueue() {}
+    PairingHeapPriorityQueue(const PairingHeapPriorityQueue&) = delete;
+    PairingHeapPriorityQueue& operator=(const PairingHeapPriorityQueue&) = delete;
+
+    ~PairingHeapPriorityQueue();
+
+protected:
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+
+private:
+    Node* root = nullptr;
+
+    bool isEmpty() const override;
+
+    /// @brief Makes root with lower priority the first child of the other one
+    /// @return Root of the linked tree
+    static Node* link(Node* first, Node* second);
+
+    /// @brief Cuts subtree from it's parent and siblings
+    static void detach(Node* node);
+
+    /// @brief Two-pass pairing of the sibling list
+    /// @param first First node of the list
+    /// @return Root of the merged tree
+    static Node* mergePairs(Node* first);
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T>
+inline T PairingHeapPriorityQueue<T>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+        return root->data;
+}
+
+template<typename T>
+inline T PairingHeapPriorityQueue<T>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+        return Erase(Handle(root));
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::Insert(T data, int priority)
+{
+    Push(std::move(data), priority);
+}
+
+template<typename T>
+inline typename PairingHeapPriorityQueue<T>::Handle
+PairingHeapPriorityQueue<T>::Push(T data, int priority)
+{
+    Node* node = new Node(std::move(data), priority);
+    root = link(root, node);
+    return Handle(node);
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::IncreaseKey(Handle handle, int priority)
+{
+    Node* node = handle.node;
+    if (priority < node->priority)
+        throw std::invalid_argument("New priority is lower than current");
+
+    node->priority = priority;
+    if (node == root)
+        return;
+
+    detach(node);
+    root = link(root, node);
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::DecreaseKey(Handle handle, int priority)
+{
+    Node* node = handle.node;
+    if (priority > node->priority)
+        throw std::invalid_argument("New priority is higher than current");
+
+    node->priority = priority;
+
+    // Children may now outrank the node, so they are merged apart from it
+    Node* children = node->child;
+    node->child = nullptr;
+    if (node != root)
+        detach(node);
+    else
+        root = nullptr;
+
+    if (children)
+        children->prev = nullptr;
+    root = link(root, link(mergePairs(children), node));
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::ChangePriority(Handle handle, int priority)
+{
+    if (priority > handle.node->priority)
+        IncreaseKey(handle, priority);
+    else
+        DecreaseKey(handle, priority);
+}
+
+template<typename T>
+inline T PairingHeapPriorityQueue<T>::Erase(Handle handle)
+{
+    Node* node = handle.node;
+
+    Node* children = node->child;
+    if (children)
+        children->prev = nullptr;
+
+    if (node == root)
+        root = mergePairs(children);
+    else {
+        detach(node);
+        root = link(root, mergePairs(children));
+    }
+
+    T data = std::move(node->data);
+    delete node;
+    return data;
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::Meld(PairingHeapPriorityQueue& other)
+{
+    if (this == &other)
+        return;
+
+    root = link(root, other.root);
+    other.root = nullptr;
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    std::vector<const Node*> stack;
+    if (root)
+        stack.push_back(root);
+    while (!stack.empty()) {
+        const Node* node = stack.back();
+        stack.pop_back();
+        visit(node->data, node->priority);
+        if (node->next)
+            stack.push_back(node->next);
+        if (node->child)
+            stack.push_back(node->child);
+    }
+}
+
+template<typename T>
+inline bool PairingHeapPriorityQueue<T>::isEmpty() const
+{
+    return root == nullptr;
+}
+
+template<typename T>
+inline typename PairingHeapPriorityQueue<T>::Node*
+PairingHeapPriorityQueue<T>::link(Node* first, Node* second)
+{
+    if (!first)
+        return second;
+    if (!second)
+        return first;
+
+    if (second->priority > first->priority)
+        std::swap(first, second);
+
+    // second becomes the first child of first
+    second->next = first->child;
+    if (first->child)
+        first->child->prev = second;
+    second->prev = first;
+    first->child = second;
+
+    first->next = nullptr;
+    first->prev = nullptr;
+    return first;
+}
+
+template<typename T>
+inline void PairingHeapPriorityQueue<T>::detach(Node* node)
+{
+    if (node->prev->child == node)
+        node->prev->child = node->next;
+    else
+        node->prev->next = node->next;
+
+    if (node->next)
+        node->next->prev = node->prev;
+
+    node->next = nullptr;
+    node->prev = nullptr;
+}
+
+template<typename T>
+inline typename PairingHeapPriorityQueue<T>::Node*
+PairingHeapPriorityQueue<T>::mergePairs(Node* first)
+{
+    if (!first)
+        return nullptr;
+
+    // First pass: link pairs from left to right,
+    // the resulting trees are chained in reverse order through prev
+    Node* paired = nullptr;
+    while (first)
+    {
+        Node* a = first;
+        Node* b = first->next;
+        first = b ? b->next : nullptr;
+
+        a->next = a->prev = nullptr;
+        if (b)
+            b->next = b->prev = nullptr;
+
+        Node* tree = link(a, b);
+        tree->prev = paired;
+        paired = tree;
+    }
+
+    // Second pass: link trees from right to left
+    Node* result = nullptr;
+    while (paired)
+    {
+        Node* tree = paired;
+        paired = paired->prev;
+        tree->prev = nullptr;
+        result = link(result, tree);
+    }
+
+    return result;
+}
+
+template<typename T>
+inline PairingHeapPriorityQueue<T>::~PairingHeapPriorityQueue()
+{
+    // The heap may degenerate into a long chain, so it is released without recursion
+    std::vector<Node*> nodes;
+    if (root)
+        nodes.push_back(root);
+
+    while (!nodes.empty())
+    {
+        Node* node = nodes.back();
+        nodes.pop_back();
+
+        for (Node* cur = node->child; cur; cur = cur->next)
+            nodes.push_back(cur);
+
+        delete node;
+    }
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    PairingHeapPriorityQueue<int> q;
+
+    q.Insert(1111, 1);
+    CHECK(q.root->data == 1111);
+
+    q.Insert(2222, 10);
+    CHECK(q.root->data == 2222);
+    CHECK(q.root->child->data == 1111);
+
+    q.Insert(3333, 5);
+    CHECK(q.root->data == 2222);
+    CHECK(q.root->child->data == 3333);
+    CHECK(q.root->child->next->data == 1111);
+}
+
+TEST_CASE("Peek")
+{
+    PairingHeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    PairingHeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Change priority")
+{
+    PairingHeapPriorityQueue<int> q;
+
+    auto h1 = q.Push(1111, 1);
+    auto h2 = q.Push(2222, 10);
+    auto h3 = q.Push(3333, 5);
+    q.Push(4444, 7);
+
+    q.IncreaseKey(h1, 20);
+    CHECK(q.Peek() == 1111);
+    CHECK_THROWS_AS(q.IncreaseKey(h3, 0), const std::invalid_argument&);
+
+    q.DecreaseKey(h1, 0);
+    CHECK(q.Peek() == 2222);
+    CHECK_THROWS_AS(q.DecreaseKey(h3, 100), const std::invalid_argument&);
+
+    q.ChangePriority(h2, 6);
+    CHECK(q.GetPriority(h2) == 6);
+
+    CHECK(q.Pop() == 4444);
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+}
+
+TEST_CASE("Erase")
+{
+    PairingHeapPriorityQueue<int> q;
+
+    q.Push(1111, 1);
+    auto h2 = q.Push(2222, 10);
+    auto h3 = q.Push(3333, 5);
+    q.Push(4444, 7);
+
+    CHECK(q.Erase(h3) == 3333);
+    CHECK(q.Erase(h2) == 2222);
+
+    CHECK(q.Pop() == 4444);
+    CHECK(q.Pop() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Meld")
+{
+    PairingHeapPriorityQueue<int> q1, q2;
+
+    q1.Push(1111, 1);
+    q1.Push(3333, 5);
+    auto h = q2.Push(2222, 10);
+    q2.Push(4444, 7);
+
+    q1.Meld(q2);
+    CHECK_THROWS_AS(q2.Peek(), const std::underflow_error&);
+
+    q1.DecreaseKey(h, 3);
+
+    CHECK(q1.Pop() == 4444);
+    CHECK(q1.Pop() == 3333);
+    CHECK(q1.Pop() == 2222);
+    CHECK(q1.Pop() == 1111);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    PairingHeapPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    PairingHeapPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    PairingHeapPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
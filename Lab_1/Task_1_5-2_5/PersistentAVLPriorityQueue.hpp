@@ -0,0 +1,411 @@
+/*
+*
+ *  PersistentAVLPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <set>
+#include <unordered_set>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "item.h"
+#include "PersistentAVLTree.hpp"
+#include "priority_queue.h"
+
+#include "doctest.h"
+
+// For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Priority queue based on the persistent AVL tree.
+/// Snapshot() takes a read-only version of the queue in O(1), reporting threads can
+/// iterate it while the owner thread keeps inserting and popping.
+/// Elements are kept behind shared pointers, so the path copies don't copy them.
+/// Pop and Peek return copies, as the snapshots may still read the element
+/// @tparam T
+template<typename T>
+class PersistentAVLPriorityQueue
+    : public PriorityQueue<T>
+{
+public:
+    /// @brief Queue element. Entries are ordered as they are popped:
+    /// higher priority first, equal priorities in arrival order
+    struct Entry
+    {
+        std::shared_ptr<const T> data;
+        int priority;
+        uint64_t arrival;
+
+        bool operator<(const Entry& entry) const
+        {
+            return priority > entry.priority ||
+                (priority == entry.priority && arrival < entry.arrival);
+        }
+    };
+
+    /// @brief Read-only version of the queue, iterates its entries in the pop order
+    using Version = PersistentAVLTree<Entry>;
+
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+    /// @brief Takes the current version of the queue in O(1), from any thread
+    Version Snapshot() const;
+
+protected:
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+
+private:
+    PersistentAVLTree<Entry> tree;
+    uint64_t arrivals = 0;
+
+    bool isEmpty() const override;
+};
+
+#undef private
+#undef protected
+
+template<typename T>
+inline T PersistentAVLPriorityQueue<T>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("Queue is empty");
+    else {
+        return *tree.GetMin().data;
+    }
+}
+
+template<typename T>
+inline T PersistentAVLPriorityQueue<T>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("Queue is empty");
+    else {
+        return *tree.PopMin().data;
+    }
+}
+
+template<typename T>
+inline void PersistentAVLPriorityQueue<T>::Insert(T data, int priority)
+{
+    tree.append(Entry{ std::make_shared<const T>(std::move(data)), priority, arrivals++ });
+}
+
+template<typename T>
+inline typename PersistentAVLPriorityQueue<T>::Version PersistentAVLPriorityQueue<T>::Snapshot() const
+{
+    return tree.Snapshot();
+}
+
+template<typename T>
+inline void PersistentAVLPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    for (const Entry& entry : tree)
+        visit(*entry.data, entry.priority);
+}
+
+template<typename T>
+inline bool PersistentAVLPriorityQueue<T>::isEmpty() const
+{
+    return tree.isEmpty();
+}
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    q.Insert(1111, 1);
+    CHECK(*q.tree.root->data.data == 1111);
+
+    q.Insert(2222, 10);
+    CHECK(*q.tree.root->left->data.data == 2222);
+    CHECK(*q.tree.root->data.data == 1111);
+
+    q.Insert(3333, 5);
+    CHECK(*q.tree.root->data.data == 3333);
+    CHECK(*q.tree.root->left->data.data == 2222);
+    CHECK(*q.tree.root->right->data.data == 1111);
+}
+
+TEST_CASE("Peek")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+    CHECK(q.PopN(3, popped) == 2);
+    CHECK(popped.back() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    for (int i = 0; i < 300; i++)
+        q.Insert(i, i % 3);
+
+    std::vector<int> popped;
+    while (popped.size() < 300)
+        popped.push_back(q.Pop());
+
+    CHECK(popped[0] == 2);
+    CHECK(popped[99] == 299);
+    CHECK(popped[100] == 1);
+    for (size_t i = 1; i < popped.size(); i++) {
+        if (popped[i - 1] % 3 == popped[i] % 3)
+            CHECK(popped[i - 1] < popped[i]);
+    }
+}
+
+TEST_CASE("Snapshots keep their version of the queue")
+{
+    PersistentAVLPriorityQueue<int> q;
+
+    for (int i = 0; i < 100; i++)
+        q.Insert(i, i);
+    auto before = q.Snapshot();
+
+    CHECK(q.Pop() == 99);
+    q.Insert(1000, 1000);
+    q.Insert(-1, -1);
+    auto after = q.Snapshot();
+
+    CHECK(before.Size() == 100);
+    CHECK(*before.begin()->data == 99);
+    CHECK(*before.GetMax().data == 0);
+    CHECK(after.Size() == 101);
+    CHECK(*after.begin()->data == 1000);
+    CHECK(*after.GetMax().data == -1);
+
+    // Entries are iterated in the pop order
+    int expected = 99;
+    for (const auto& entry : before)
+        CHECK(*entry.data == expected--);
+
+    while (!q.isEmpty())
+        q.Pop();
+    CHECK(before.Size() == 100);
+    CHECK(after.Size() == 101);
+}
+
+TEST_CASE("Persistent tree shares the unchanged subtrees")
+{
+    PersistentAVLTree<int> tree;
+    for (int i = 0; i < 1000; i++)
+        tree.append(i);
+
+    // Balanced as the mutable AVL tree
+    CHECK(tree.root->height <= 15);
+    CHECK(tree.Size() == 1000);
+
+    // Nodes of the tree that are not in the other version
+    auto newNodes = [](const PersistentAVLTree<int>& tree, const PersistentAVLTree<int>& other) {
+        std::unordered_set<const void*> old_nodes;
+        std::vector<const void*> nodes;
+        for (auto it = other.begin(); it != other.end(); ++it)
+            old_nodes.insert(it.path[it.depth - 1]);
+        for (auto it = tree.begin(); it != tree.end(); ++it)
+            nodes.push_back(it.path[it.depth - 1]);
+        return std::count_if(nodes.begin(), nodes.end(),
+            [&](const void* node) { return old_nodes.count(node) == 0; });
+    };
+
+    PersistentAVLTree<int> old = tree.Snapshot();
+    CHECK(old.root == tree.root);
+
+    // Only the path to the changed node and the rotated nodes are copied
+    tree.append(1000);
+    CHECK(old.root != tree.root);
+    CHECK(newNodes(tree, old) <= tree.root->height + 2);
+
+    PersistentAVLTree<int> appended = tree.Snapshot();
+    tree.remove(500);
+    CHECK(newNodes(tree, appended) <= tree.root->height + 2);
+    CHECK(appended.GetElem(500));
+    CHECK(!tree.GetElem(500));
+    tree.append(500);
+
+    CHECK(!old.GetElem(1000));
+    CHECK(tree.GetElem(1000));
+    CHECK(old.Size() == 1000);
+    CHECK(tree.Size() == 1001);
+}
+
+TEST_CASE("Persistent tree matches the set under random changes")
+{
+    PersistentAVLTree<int> tree;
+    std::set<int> expected;
+    std::vector<std::pair<PersistentAVLTree<int>, std::set<int>>> versions;
+    std::mt19937 mersenne(7);
+
+    for (int i = 0; i < 5000; i++) {
+        int value = int(mersenne() % 2000);
+        if (mersenne() % 3 == 0) {
+            tree.remove(value);
+            expected.erase(value);
+        }
+        else {
+            tree.append(value);
+            expected.insert(value);
+        }
+
+        if (i % 7 == 0 && !expected.empty()) {
+            CHECK(tree.PopMax() == *expected.rbegin());
+            expected.erase(std::prev(expected.end()));
+        }
+        if (i % 500 == 0)
+            versions.push_back({ tree.Snapshot(), expected });
+    }
+
+    REQUIRE(tree.Size() == expected.size());
+    CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    CHECK(tree.GetMin() == *expected.begin());
+    CHECK(*tree.lower_bound(1000) == *expected.lower_bound(1000));
+
+    auto interval = tree.Interval(100, 200);
+    CHECK(std::equal(interval.begin(), interval.end(), expected.lower_bound(100), expected.upper_bound(200)));
+
+    for (auto& version : versions) {
+        CHECK(version.first.Size() == version.second.size());
+        CHECK(std::equal(version.first.begin(), version.first.end(), version.second.begin(), version.second.end()));
+    }
+}
+
+TEST_CASE("Readers iterate snapshots while the writer changes the queue")
+{
+    PersistentAVLPriorityQueue<int> q;
+    std::atomic<bool> done{ false };
+    std::atomic<int> checked{ 0 };
+    std::atomic<bool> sorted{ true };
+
+    std::thread reader([&]() {
+        while (!done.load() || checked.load() == 0) {
+            auto version = q.Snapshot();
+            size_t count = 0;
+            int prev = INT_MAX;
+            for (const auto& entry : version) {
+                if (entry.priority > prev)
+                    sorted = false;
+                prev = entry.priority;
+                count++;
+            }
+            if (count != version.Size())
+                sorted = false;
+            checked++;
+        }
+    });
+
+    std::mt19937 mersenne(7);
+    for (int i = 0; i < 20000; i++) {
+        int priority = int(mersenne() % 1000);
+        q.Insert(priority, priority);
+        if (i % 3 == 0)
+            q.Pop();
+    }
+    done = true;
+    reader.join();
+
+    CHECK(sorted.load());
+    CHECK(checked.load() > 0);
+}
+
+TEST_CASE("Insert without copying")
+{
+    PersistentAVLPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+    for (int i = 0; i < 100; i++)
+        q.Insert(CopyCounter(i), i);
+    CHECK(CopyCounter::copies == 0);
+
+    // The popped element is copied once, the snapshots may still hold it
+    CHECK(q.Pop().value == 99);
+    CHECK(CopyCounter::copies == 1);
+}
+
+TEST_CASE("Save and load")
+{
+    PersistentAVLPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    PersistentAVLPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+#endif
@@ -0,0 +1,440 @@
+/*
+*
+ *  PersistentAVLTree.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "TreeRange.hpp"
+
+
+// For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Persistent AVL tree: nodes are immutable and shared between the versions of the tree.
+/// Insert and remove copy only the path from the root to the changed node, O(log N) nodes,
+/// and return the new root, all the other subtrees are shared with the previous version.
+/// Old versions stay valid and readable, so Snapshot() is O(1): it only takes the root.
+/// One thread changes the tree, any threads can take snapshots and read them meanwhile.
+/// Nodes are owned by reference counting, as they live as long as any version refers to them,
+/// so the node pool of the other trees doesn't fit here.
+/// Values on the copied path are copied, so T should be cheap to copy
+/// @tparam T
+template<typename T>
+class PersistentAVLTree
+{
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node
+    {
+        T data;
+        NodePtr left;
+        NodePtr right;
+        size_t size; // number of nodes in the subtree
+        int height;
+
+        Node(T data, NodePtr left, NodePtr right, size_t size, int height)
+            : data(std::move(data)), left(std::move(left)), right(std::move(right)),
+            size(size), height(height) {}
+    };
+
+    NodePtr root;
+
+    static size_t subtreeSize(const NodePtr& node)
+    {
+        return node ? node->size : 0;
+    }
+
+    static int height(const NodePtr& node)
+    {
+        return node ? node->height : 0;
+    }
+
+    /// @brief Creates the node over two subtrees, their heights must differ by at most one
+    static NodePtr makeNode(T data, NodePtr left, NodePtr right)
+    {
+        size_t size = 1 + subtreeSize(left) + subtreeSize(right);
+        int node_height = 1 + std::max(height(left), height(right));
+        return std::make_shared<const Node>(std::move(data), std::move(left), std::move(right), size, node_height);
+    }
+
+    /// @brief Creates the balanced subtree over two subtrees, their heights may differ by two.
+    /// Rotations create new nodes instead of relinking, the grandchildren are shared
+    /// @param data Value of the subtree root before the rotation
+    /// @return Root of the balanced subtree
+    static NodePtr balance(T data, NodePtr left, NodePtr right)
+    {
+        if (height(left) > height(right) + 1) {
+            if (height(left->left) >= height(left->right)) {
+                // Right rotation
+                return makeNode(left->data, left->left,
+                    makeNode(std::move(data), left->right, std::move(right)));
+            }
+            // Left-right rotation
+            const Node* pivot = left->right.get();
+            return makeNode(pivot->data,
+                makeNode(left->data, left->left, pivot->left),
+                makeNode(std::move(data), pivot->right, std::move(right)));
+        }
+        if (height(right) > height(left) + 1) {
+            if (height(right->right) >= height(right->left)) {
+                // Left rotation
+                return makeNode(right->data,
+                    makeNode(std::move(data), std::move(left), right->left), right->right);
+            }
+            // Right-left rotation
+            const Node* pivot = right->left.get();
+            return makeNode(pivot->data,
+                makeNode(std::move(data), std::move(left), pivot->left),
+                makeNode(right->data, pivot->right, right->right));
+        }
+        return makeNode(std::move(data), std::move(left), std::move(right));
+    }
+
+    /// @brief Inserts the value into the subtree. Recursion depth is the height, O(log N)
+    /// @param data Value to insert, it is moved into the new node
+    /// @return New root of the subtree, nullptr if the value is already present
+    static NodePtr insert(const NodePtr& node, T& data)
+    {
+        if (!node)
+            return makeNode(std::move(data), nullptr, nullptr);
+
+        if (data < node->data) {
+            NodePtr left = insert(node->left, data);
+            return left ? balance(node->data, std::move(left), node->right) : nullptr;
+        }
+        if (node->data < data) {
+            NodePtr right = insert(node->right, data);
+            return right ? balance(node->data, node->left, std::move(right)) : nullptr;
+        }
+        return nullptr;
+    }
+
+    /// @brief Removes the minimum node of the not empty subtree
+    /// @param min Set to the removed value, it stays in the old version
+    /// @return New root of the subtree
+    static NodePtr removeMin(const NodePtr& node, const T*& min)
+    {
+        if (!node->left) {
+            min = &node->data;
+            return node->right;
+        }
+        NodePtr left = removeMin(node->left, min);
+        return balance(node->data, std::move(left), node->right);
+    }
+
+    /// @brief Removes the maximum node of the not empty subtree
+    /// @param max Set to the removed value, it stays in the old version
+    /// @return New root of the subtree
+    static NodePtr removeMax(const NodePtr& node, const T*& max)
+    {
+        if (!node->right) {
+            max = &node->data;
+            return node->left;
+        }
+        NodePtr right = removeMax(node->right, max);
+        return balance(node->data, node->left, std::move(right));
+    }
+
+    /// @brief Removes the value from the subtree
+    /// @param removed Set to false if there is no such value
+    /// @return New root of the subtree, the same one if nothing is removed
+    static NodePtr remove(const NodePtr& node, const T& data, bool& removed)
+    {
+        if (!node) {
+            removed = false;
+            return nullptr;
+        }
+
+        if (data < node->data) {
+            NodePtr left = remove(node->left, data, removed);
+            return removed ? balance(node->data, std::move(left), node->right) : node;
+        }
+        if (node->data < data) {
+            NodePtr right = remove(node->right, data, removed);
+            return removed ? balance(node->data, node->left, std::move(right)) : node;
+        }
+
+        removed = true;
+        if (!node->left)
+            return node->right;
+        if (!node->right)
+            return node->left;
+        // Successor takes the place of the removed value
+        const T* next = nullptr;
+        NodePtr right = removeMin(node->right, next);
+        return balance(*next, node->left, std::move(right));
+    }
+
+    /// @brief Makes the new version current. Readers load the root atomically in Snapshot()
+    void publish(NodePtr new_root)
+    {
+        std::atomic_store(&root, std::move(new_root));
+    }
+
+public:
+    /// @brief Forward iterator over the elements in sorted order.
+    /// Keeps the path from the root in a fixed-size stack, as the shared nodes have no parent links.
+    /// It is valid while the tree or the snapshot it came from is alive
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() {}
+
+        reference operator*() const { return path[depth - 1]->data; }
+        pointer operator->() const { return &path[depth - 1]->data; }
+
+        const_iterator& operator++()
+        {
+            const Node* node = path[--depth];
+            descendLeft(node->right.get());
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            if (depth == 0 || other.depth == 0)
+                return depth == other.depth;
+            return path[depth - 1] == other.path[other.depth - 1];
+        }
+
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PersistentAVLTree;
+
+        // Height of the AVL tree is below 1.45 log2(N + 2),
+        // so 64 levels hold more elements than fit in memory
+        static constexpr int kMaxDepth = 64;
+
+        // Nodes whose element and right subtree are not visited yet, the last one is current
+        const Node* path[kMaxDepth];
+        int depth = 0;
+
+        void descendLeft(const Node* node)
+        {
+            for (; node; node = node->left.get())
+                path[depth++] = node;
+        }
+    };
+
+    using iterator = const_iterator;
+    using range = TreeRange<const_iterator>;
+
+    PersistentAVLTree() {}
+
+    /// @brief Tree over the root of another version, shares all of its nodes
+    PersistentAVLTree(const PersistentAVLTree& other)
+        : root(std::atomic_load(&other.root)) {}
+
+    PersistentAVLTree& operator=(const PersistentAVLTree& other)
+    {
+        publish(std::atomic_load(&other.root));
+        return *this;
+    }
+
+    /// @brief Takes the current version of the tree in O(1).
+    /// Can be called from any thread while the owner thread changes the tree.
+    /// Nodes of the snapshot are freed when no version refers to them anymore
+    /// @return Read-only tree sharing all nodes with the current version
+    PersistentAVLTree Snapshot() const
+    {
+        return PersistentAVLTree(*this);
+    }
+
+    bool isEmpty() const
+    {
+        return root == nullptr;
+    }
+
+    size_t Size() const
+    {
+        return subtreeSize(root);
+    }
+
+    /// @brief Inserts data to the tree, copying the path to the new node.
+    /// Elements equal to the present ones are skipped
+    /// @param data Data to insert
+    void append(T data)
+    {
+        if (NodePtr new_root = insert(root, data))
+            publish(std::move(new_root));
+    }
+
+    /// @brief Removes the value, copying the path to its node
+    /// @param data Value to remove
+    void remove(const T& data)
+    {
+        bool removed = false;
+        NodePtr new_root = remove(root, data, removed);
+        if (removed)
+            publish(std::move(new_root));
+    }
+
+    /// @brief Gets maximum tree element in O(log N). The tree must not be empty
+    const T& GetMax() const
+    {
+        const Node* node = root.get();
+        while (node->right)
+            node = node->right.get();
+        return node->data;
+    }
+
+    /// @brief Gets minimum tree element in O(log N). The tree must not be empty
+    const T& GetMin() const
+    {
+        const Node* node = root.get();
+        while (node->left)
+            node = node->left.get();
+        return node->data;
+    }
+
+    /// @brief Removes maximum element of the tree. The tree must not be empty
+    /// @return Copy of the maximum element, the snapshots may still read it
+    T PopMax()
+    {
+        const T* max = nullptr;
+        NodePtr new_root = removeMax(root, max);
+        T data = *max;
+        publish(std::move(new_root));
+        return data;
+    }
+
+    /// @brief Removes minimum element of the tree. The tree must not be empty
+    /// @return Copy of the minimum element, the snapshots may still read it
+    T PopMin()
+    {
+        const T* min = nullptr;
+        NodePtr new_root = removeMin(root, min);
+        T data = *min;
+        publish(std::move(new_root));
+        return data;
+    }
+
+    bool GetElem(const T& data) const
+    {
+        const Node* node = root.get();
+        while (node) {
+            if (data < node->data)
+                node = node->left.get();
+            else if (node->data < data)
+                node = node->right.get();
+            else
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Respresents tree as array
+    /// @param elements Container to insert elements
+    void InOrder(std::vector<T>& elements) const
+    {
+        for (const T& elem : *this)
+            elements.push_back(elem);
+    }
+
+    const_iterator begin() const
+    {
+        const_iterator it;
+        it.descendLeft(root.get());
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(); }
+
+    /// @return Iterator to the first element not less than the value
+    const_iterator lower_bound(const T& data) const
+    {
+        const_iterator it;
+        for (const Node* node = root.get(); node; ) {
+            if (node->data < data)
+                node = node->right.get();
+            else {
+                it.path[it.depth++] = node;
+                node = node->left.get();
+            }
+        }
+        return it;
+    }
+
+    /// @brief Lazy view of the elements from the interval, nothing is copied
+    /// @return View of the elements in [min, max] in sorted order
+    range Interval(const T& min, const T& max) const
+    {
+        if (max < min)
+            return range(end(), end());
+        const_iterator last = lower_bound(max);
+        if (last != end() && !(max < *last))
+            ++last;
+        return range(lower_bound(min), last);
+    }
+
+    /// @brief Counts the distinct nodes of the versions, the shared ones are counted once.
+    /// Shows how many nodes the snapshots keep alive besides the current version
+    static size_t CountNodes(const std::vector<const PersistentAVLTree*>& versions)
+    {
+        std::unordered_set<const Node*> counted;
+        std::vector<const Node*> stack;
+        for (const PersistentAVLTree* version : versions)
+            stack.push_back(version->root.get());
+
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            // The whole subtree of a counted node is counted too
+            if (!node || !counted.insert(node).second)
+                continue;
+            stack.push_back(node->left.get());
+            stack.push_back(node->right.get());
+        }
+        return counted.size();
+    }
+
+    void print() const
+    {
+        for (const T& elem : *this)
+            std::cout << elem << std::endl;
+    }
+
+    /// @brief Drops the current version, the nodes shared with snapshots stay alive
+    void clear()
+    {
+        publish(nullptr);
+    }
+};
+
+
+#undef private
+#undef protected
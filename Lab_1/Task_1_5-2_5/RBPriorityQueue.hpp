@@ -0,0 +1,491 @@
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+#include "RBTree.hpp"
+#include "AVLTree.hpp"
+#include "priority_queue.h"
+
+#include "doctest.h"
+
+// For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+
+template<typename T>
+class RBPriorityQueue : public PriorityQueue<T>
+{
+public:
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+
+private:
+    // One bucket per priority, equal priorities are popped in arrival order
+    RBTree<Bucket<T>> tree;
+
+    /// @return Bucket of the priority, nullptr if there is none
+    Bucket<T>* findBucket(int priority);
+
+    bool isEmpty() const override;
+};
+
+#undef private
+#undef protected
+
+template<typename T>
+inline T RBPriorityQueue<T>::Peek() const
+{
+	if (this->isEmpty())
+		throw std::underflow_error("Queue is empty");
+	else {
+		return tree.GetMax().Front();
+	}
+}
+
+template<typename T>
+inline T RBPriorityQueue<T>::Pop()
+{
+	if (this->isEmpty())
+		throw std::underflow_error("Queue is empty");
+	else {
+		Bucket<T>& top = tree.GetMax();
+		T data = top.Pop();
+		if (top.Empty())
+			tree.PopMax();
+		return data;
+	}
+}
+
+template<typename T>
+inline void RBPriorityQueue<T>::Insert(T data, int priority)
+{
+	if (Bucket<T>* bucket = findBucket(priority))
+		bucket->Push(std::move(data));
+	else
+		tree.append(Bucket<T>(std::move(data), priority));
+}
+
+template<typename T>
+inline size_t RBPriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	size_t taken;
+	size_t whole = CountWholeBuckets(tree, count, taken);
+	return PopBuckets(tree, count, whole, taken, out);
+}
+
+template<typename T>
+inline void RBPriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	// Items of the present priorities join their buckets, the new buckets are built into the tree at once
+	std::vector<Bucket<T>> added;
+	for (Bucket<T>& group : Bucket<T>::Group(items)) {
+		if (Bucket<T>* bucket = findBucket(group.priority))
+			bucket->Append(std::move(group));
+		else
+			added.push_back(std::move(group));
+	}
+	if (!added.empty())
+		tree.AppendRange(std::move(added));
+}
+
+template<typename T>
+inline Bucket<T>* RBPriorityQueue<T>::findBucket(int priority)
+{
+	return tree.Find(Bucket<T>(priority));
+}
+
+template<typename T>
+inline void RBPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+	ForEachInPopOrder(tree, visit);
+}
+
+template<typename T>
+inline bool RBPriorityQueue<T>::isEmpty() const
+{
+	return tree.isEmpty();
+}
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+	RBPriorityQueue<int> q;
+
+	q.Insert(1111, 1);
+	CHECK(q.tree.root->data.Front() == 1111);
+
+
+	q.Insert(2222, 10);
+	CHECK(q.tree.root->right->data.Front() == 2222);
+	CHECK(q.tree.root->data.Front() == 1111);
+
+	q.Insert(3333, 5);
+	CHECK(q.tree.root->data.Front() == 3333);
+	CHECK(q.tree.root->right->data.Front() == 2222);
+	CHECK(q.tree.root->left->data.Front() == 1111);
+}
+
+TEST_CASE("Peek")
+{
+	RBPriorityQueue<int> q;
+
+	CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+
+	CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+	RBPriorityQueue<int> q;
+
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+
+	CHECK(q.Pop() == 2222);
+	CHECK(q.Pop() == 3333);
+	CHECK(q.Pop() == 1111);
+
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+	RBPriorityQueue<int> q;
+
+	q.Insert(5555, 6);
+
+	std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+	q.InsertRange(items.begin(), items.end());
+
+	std::vector<int> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+	CHECK(q.PopN(3, popped) == 2);
+	CHECK(popped.back() == 1111);
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Bulk build of a large queue")
+{
+	RBPriorityQueue<int> q;
+
+	std::vector<Item<int>> items;
+	for (int i = 0; i < 1000; i++)
+		items.push_back(Item<int>(i, (i * 7919) % 1000));
+	q.InsertRange(items.begin(), items.begin() + 500);
+	q.InsertRange(items.begin() + 500, items.end());
+
+	std::vector<int> popped;
+	q.PopN(2, popped);
+	q.PopN(500, popped);
+	while (popped.size() < 1000)
+		popped.push_back(q.Pop());
+
+	for (size_t i = 1; i < popped.size(); i++)
+		CHECK((popped[i - 1] * 7919) % 1000 > (popped[i] * 7919) % 1000);
+}
+
+TEST_CASE("Tree iterators and interval views")
+{
+	RBTree<int> tree;
+	std::vector<int> expected;
+
+	for (int size = 0; size < 200; size++) {
+		CHECK(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+		CHECK(std::equal(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()),
+			expected.rbegin(), expected.rend()));
+
+		int value = (size * 7919) % 200;
+		tree.append(value);
+		expected.insert(std::upper_bound(expected.begin(), expected.end(), value), value);
+	}
+
+	CHECK(*tree.lower_bound(50) == 50);
+	CHECK(*tree.upper_bound(50) == 51);
+	CHECK(*std::prev(tree.end()) == 199);
+	CHECK(tree.lower_bound(200) == tree.end());
+	CHECK(tree.upper_bound(-1) == tree.begin());
+
+	auto equal = tree.equal_range(42);
+	CHECK(std::distance(equal.first, equal.second) == 1);
+	CHECK(std::distance(tree.begin(), tree.end()) == 200);
+
+	int sum = 0;
+	for (int elem : tree.Interval(100, 149))
+		sum += elem;
+	CHECK(sum == 1 * (100 + 149) * 50 / 2);
+	CHECK(tree.Interval(150, 100).empty());
+	CHECK(std::count_if(tree.Interval(10, 19).begin(), tree.Interval(10, 19).end(),
+		[](int elem) { return elem % 2 == 0; }) == 1 * 5);
+}
+
+TEST_CASE("Order statistics")
+{
+	RBTree<int> tree;
+	std::vector<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 3000;
+		tree.append(value);
+		expected.push_back(value);
+	}
+	for (int i = 0; i < 3000; i += 3) {
+		int value = (i * 104729) % 3000;
+		tree.remove(value);
+		expected.erase(std::find(expected.begin(), expected.end(), value));
+	}
+	tree.PopMax();
+	std::sort(expected.begin(), expected.end());
+	expected.pop_back();
+	tree.append(expected[10]); // equal elements are skipped
+
+	for (size_t k = 0; k < expected.size(); k++)
+		CHECK(tree.Select(k) == expected[k]);
+	CHECK_THROWS_AS(tree.Select(expected.size()), const std::out_of_range&);
+
+	for (int value = -1; value <= 3000; value += 7) {
+		size_t rank = std::lower_bound(expected.begin(), expected.end(), value) - expected.begin();
+		CHECK(tree.Rank(value) == rank);
+		size_t count = std::upper_bound(expected.begin(), expected.end(), value + 100) - expected.begin() - rank;
+		CHECK(tree.CountInRange(value, value + 100) == count);
+	}
+	CHECK(tree.CountInRange(100, 50) == 0);
+
+	tree.AppendRange(std::vector<int>{ -5, 5000 });
+	CHECK(tree.Select(0) == -5);
+	CHECK(tree.Select(tree.Size() - 1) == 5000);
+	CHECK(tree.Rank(5000) == tree.Size() - 1);
+}
+
+TEST_CASE("Red-black tree keeps its invariants")
+{
+	RBTree<int> tree;
+
+	// Checks colors and black heights, returns the black height of the subtree
+	std::function<int(RBTree<int>::Node*)> blackHeight = [&](RBTree<int>::Node* node) {
+		if (!node)
+			return 1;
+		if (node->red) {
+			CHECK_FALSE(RBTree<int>::isRed(node->left));
+			CHECK_FALSE(RBTree<int>::isRed(node->right));
+		}
+		if (node->left)
+			CHECK(node->left->parent == node);
+		if (node->right)
+			CHECK(node->right->parent == node);
+		CHECK(node->size == 1 + RBTree<int>::subtreeSize(node->left) + RBTree<int>::subtreeSize(node->right));
+
+		int left = blackHeight(node->left);
+		CHECK(left == blackHeight(node->right));
+		return left + (node->red ? 0 : 1);
+	};
+
+	for (int i = 0; i < 2000; i++)
+		tree.append((i * 7919) % 2000);
+	CHECK_FALSE(tree.root->red);
+	blackHeight(tree.root);
+
+	for (int i = 0; i < 2000; i += 2)
+		tree.remove((i * 104729) % 2000);
+	for (int i = 0; i < 300; i++)
+		tree.PopMax();
+	CHECK(tree.Size() == 700);
+	blackHeight(tree.root);
+
+	for (int size : { 1, 2, 3, 7, 8, 100 }) {
+		std::vector<int> elements(size);
+		for (int i = 0; i < size; i++)
+			elements[i] = 5000 + i;
+		RBTree<int> built;
+		built.AppendRange(elements);
+		blackHeight(built.root);
+	}
+}
+
+TEST_CASE("Red-black tree rotates less than AVL tree")
+{
+	RBTree<int> rb;
+	AVLTree<int> avl;
+
+	for (int i = 0; i < 20000; i++) {
+		rb.append((i * 7919) % 20000);
+		avl.append((i * 7919) % 20000);
+	}
+	for (int i = 0; i < 20000; i++) {
+		rb.remove((i * 104729) % 20000);
+		avl.remove((i * 104729) % 20000);
+	}
+
+	CHECK(rb.isEmpty());
+	CHECK(avl.isEmpty());
+	CHECK(rb.Rotations() < avl.Rotations());
+}
+
+TEST_CASE("Cached minimum and maximum follow the changes")
+{
+	RBTree<int> tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 3000; i++) {
+		int value = (i * 7919) % 1000;
+		if (i % 3 == 2) {
+			tree.remove(value);
+			expected.erase(value);
+		}
+		else if (i % 7 == 6 && !expected.empty()) {
+			CHECK(tree.PopMax() == *expected.rbegin());
+			expected.erase(std::prev(expected.end()));
+		}
+		else {
+			tree.append(value);
+			expected.insert(value);
+		}
+
+		if (i % 500 == 0) {
+			tree.AppendRange(std::vector<int>{ i - 2000, i + 2000 });
+			expected.insert({ i - 2000, i + 2000 });
+		}
+
+		REQUIRE(tree.Size() == expected.size());
+		if (!expected.empty()) {
+			CHECK(tree.GetMin() == *expected.begin());
+			CHECK(tree.GetMax() == *expected.rbegin());
+			CHECK(*std::prev(tree.end()) == *expected.rbegin());
+		}
+	}
+
+	tree.clear();
+	tree.append(5);
+	CHECK(tree.GetMin() == 5);
+	CHECK(tree.GetMax() == 5);
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+	RBPriorityQueue<int> q;
+
+	for (int i = 0; i < 300; i++)
+		q.Insert(i, i % 3);
+	std::vector<Item<int>> items;
+	for (int i = 300; i < 600; i++)
+		items.push_back(Item<int>(i, i % 3));
+	q.InsertRange(items.begin(), items.end());
+	CHECK(q.tree.Size() == 3);
+
+	std::vector<int> popped;
+	q.PopN(50, popped);
+	q.Insert(600, 2);
+	while (popped.size() < 601)
+		popped.push_back(q.Pop());
+	CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+	CHECK(popped[0] == 2);
+	CHECK(popped[199] == 599);
+	CHECK(popped[200] == 600);
+	for (size_t i = 1; i < popped.size(); i++) {
+		if (popped[i - 1] % 3 == popped[i] % 3)
+			CHECK(popped[i - 1] < popped[i]);
+	}
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+	RBPriorityQueue<CopyCounter> q;
+	CopyCounter::copies = 0;
+
+	q.Insert(CopyCounter(1111), 1);
+	q.Insert(CopyCounter(2222), 10);
+	q.Emplace(5, 3333);
+
+	std::vector<Item<CopyCounter>> items;
+	items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+	items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+	q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+	CHECK(q.Pop().value == 2222);
+	CHECK(q.Pop().value == 4444);
+
+	std::vector<CopyCounter> popped;
+	CHECK(q.PopN(3, popped) == 3);
+	CHECK(popped[0].value == 3333);
+	CHECK(popped[1].value == 5555);
+	CHECK(popped[2].value == 1111);
+
+	CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Ascending keys don't overflow the stack")
+{
+	const int kKeys = 10000000;
+	RBTree<int, NewDeleteAllocator> tree;
+
+	for (int i = 0; i < kKeys; i++)
+		tree.append(i);
+	CHECK(tree.Size() == size_t(kKeys));
+	CHECK(tree.GetElem(kKeys - 1));
+	CHECK(tree.GetElementsByInterval(kKeys - 3, kKeys + 3).size() == 3);
+
+	for (int i = 0; i < kKeys; i += 2)
+		tree.remove(i);
+	CHECK(tree.PopMax() == kKeys - 1);
+
+	std::vector<int> elements;
+	tree.InOrder(elements);
+	CHECK(elements.size() == size_t(kKeys) / 2 - 1);
+	CHECK(std::is_sorted(elements.begin(), elements.end()));
+	CHECK(tree.root->parent == nullptr);
+
+	tree.clear();
+	CHECK(tree.isEmpty());
+}
+
+TEST_CASE("Save and load")
+{
+	RBPriorityQueue<int> q;
+	q.Insert(1111, 1);
+	q.Insert(2222, 10);
+	q.Insert(3333, 5);
+	q.Insert(4444, 7);
+	q.Insert(5555, 5);
+
+	std::stringstream stream;
+	q.Save(stream);
+
+	RBPriorityQueue<int> loaded;
+	loaded.Load(stream);
+
+	// Both queues pop the same elements in the same order
+	for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+		CHECK(loaded.Pop() == value);
+		CHECK(q.Pop() == value);
+	}
+	CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
\ No newline at end of file
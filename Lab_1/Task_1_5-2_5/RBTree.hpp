@@ -0,0 +1,1144 @@
+#pragma once 
+
+
+#include <random>
+#include <iostream>
+#include <cstddef>
+#include <list>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+#include "NodePool.hpp"
+#include "TreeRange.hpp"
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Red-black tree to store comparative values.
+/// Keeps the same interface as AVLTree, but the balance is looser:
+/// insertion makes at most two rotations and removal at most three
+/// @tparam T 
+/// @tparam Allocator Allocator of the tree nodes, NodePool by default
+template<typename T, template<typename> class Allocator = NodePool>
+class RBTree
+{
+private:
+    struct Node
+    {
+        T data;;
+        Node* left = nullptr;
+        Node* right = nullptr;
+        Node* parent = nullptr;
+        size_t size = 1; // number of nodes in the subtree
+        bool red = true;
+
+        Node(T data)
+            : data(std::move(data)) {}
+    };
+
+    Allocator<Node> pool;
+    Node* root = nullptr;
+    size_t count = 0;
+    // Extreme nodes are cached, so GetMax/GetMin and PopMax don't walk down the tree
+    Node* min_node = nullptr;
+    Node* max_node = nullptr;
+    size_t rotations = 0;
+
+    static size_t subtreeSize(Node* node)
+    {
+        return node ? node->size : 0;
+    }
+
+    static bool isRed(Node* node)
+    {
+        return node && node->red;
+    }
+
+    /// @brief Left rotates subtree rooted with x, x's right child takes its place
+    /// @param x Subtree to rotate
+    void leftRotate(Node* x)
+    {
+        Node* y = x->right;
+
+        x->right = y->left;
+        if (y->left)
+            y->left->parent = x;
+
+        replaceChild(x->parent, x, y);
+        y->left = x;
+        x->parent = y;
+
+        y->size = x->size;
+        x->size = 1 + subtreeSize(x->left) + subtreeSize(x->right);
+
+        rotations++;
+    }
+
+    /// @brief Right rotates subtree rooted with y, y's left child takes its place
+    /// @param y Subtree to rotate
+    void rightRotate(Node* y)
+    {
+        Node* x = y->left;
+
+        y->left = x->right;
+        if (x->right)
+            x->right->parent = y;
+
+        replaceChild(y->parent, y, x);
+        x->right = y;
+        y->parent = x;
+
+        x->size = y->size;
+        y->size = 1 + subtreeSize(y->left) + subtreeSize(y->right);
+
+        rotations++;
+    }
+
+    /// @brief Puts new child to the place of the old one
+    /// @param parent Parent of the old child, nullptr if the old child is the root
+    /// @param old_child Replaced node
+    /// @param new_child Node to link, may be nullptr
+    void replaceChild(Node* parent, Node* old_child, Node* new_child)
+    {
+        if (!parent)
+            root = new_child;
+        else if (parent->left == old_child)
+            parent->left = new_child;
+        else
+            parent->right = new_child;
+
+        if (new_child)
+            new_child->parent = parent;
+    }
+
+    /// @brief Restores the colors after the red node was linked.
+    /// Recolors up the tree and makes at most two rotations
+    /// @param node Inserted node
+    void insertFixup(Node* node)
+    {
+        while (isRed(node->parent)) {
+            Node* parent = node->parent;
+            Node* grandparent = parent->parent; // the root is black, so the red parent has a parent
+
+            if (parent == grandparent->left) {
+                Node* uncle = grandparent->right;
+                if (isRed(uncle)) {
+                    parent->red = uncle->red = false;
+                    grandparent->red = true;
+                    node = grandparent;
+                    continue;
+                }
+                if (node == parent->right) {
+                    leftRotate(parent);
+                    parent = node;
+                }
+                parent->red = false;
+                grandparent->red = true;
+                rightRotate(grandparent);
+                break;
+            }
+            else {
+                Node* uncle = grandparent->left;
+                if (isRed(uncle)) {
+                    parent->red = uncle->red = false;
+                    grandparent->red = true;
+                    node = grandparent;
+                    continue;
+                }
+                if (node == parent->left) {
+                    rightRotate(parent);
+                    parent = node;
+                }
+                parent->red = false;
+                grandparent->red = true;
+                leftRotate(grandparent);
+                break;
+            }
+        }
+        root->red = false;
+    }
+
+    /// @brief Restores the black heights after a black node was unlinked.
+    /// Recolors up the tree and makes at most three rotations
+    /// @param node Node that took the place of the removed one, may be nullptr
+    /// @param parent Parent of that node
+    void removeFixup(Node* node, Node* parent)
+    {
+        while (node != root && !isRed(node)) {
+            if (node == parent->left) {
+                Node* sibling = parent->right;
+                if (isRed(sibling)) {
+                    sibling->red = false;
+                    parent->red = true;
+                    leftRotate(parent);
+                    sibling = parent->right;
+                }
+                if (!isRed(sibling->left) && !isRed(sibling->right)) {
+                    sibling->red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+                if (!isRed(sibling->right)) {
+                    sibling->left->red = false;
+                    sibling->red = true;
+                    rightRotate(sibling);
+                    sibling = parent->right;
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->right->red = false;
+                leftRotate(parent);
+            }
+            else {
+                Node* sibling = parent->left;
+                if (isRed(sibling)) {
+                    sibling->red = false;
+                    parent->red = true;
+                    rightRotate(parent);
+                    sibling = parent->left;
+                }
+                if (!isRed(sibling->left) && !isRed(sibling->right)) {
+                    sibling->red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+                if (!isRed(sibling->left)) {
+                    sibling->right->red = false;
+                    sibling->red = true;
+                    leftRotate(sibling);
+                    sibling = parent->left;
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->left->red = false;
+                rightRotate(parent);
+            }
+            node = root;
+        }
+        if (node)
+            node->red = false;
+    }
+
+    /// @brief Unlinks the node with at most one child, destroys it and restores the colors
+    /// @param node Node to remove
+    void unlink(Node* node)
+    {
+        if (node == min_node)
+            min_node = successor(node);
+        if (node == max_node)
+            max_node = predecessor(node);
+
+        Node* parent = node->parent;
+        for (Node* ancestor = parent; ancestor; ancestor = ancestor->parent)
+            ancestor->size--;
+
+        Node* child = node->left ? node->left : node->right;
+        bool removed_black = !node->red;
+        replaceChild(parent, node, child);
+        pool.Destroy(node);
+        count--;
+
+        if (removed_black)
+            removeFixup(child, parent);
+    }
+
+    static Node* minValueNode(Node* node)
+    {
+        Node* current = node;
+        while (current && current->left != nullptr)
+        current = current->left;
+ 
+        return current;
+    }
+
+    static Node* maxValueNode(Node* node)
+    {
+        Node* current = node;
+        while (current && current->right != nullptr)
+            current = current->right;
+
+        return current;
+    }
+
+    /// @brief Finds the next node in sorted order using the parent links
+    /// @param node Current node
+    /// @return Next node, nullptr for the maximum one
+    static Node* successor(Node* node)
+    {
+        if (node->right)
+            return minValueNode(node->right);
+
+        while (node->parent && node == node->parent->right)
+            node = node->parent;
+        return node->parent;
+    }
+
+    /// @brief Finds the previous node in sorted order using the parent links
+    /// @param node Current node
+    /// @return Previous node, nullptr for the minimum one
+    static Node* predecessor(Node* node)
+    {
+        if (node->left)
+            return maxValueNode(node->left);
+
+        while (node->parent && node == node->parent->left)
+            node = node->parent;
+        return node->parent;
+    }
+
+    /// @brief Inserts a key into the tree and restores the colors
+    /// @param data Value to insert, it is moved into the new node
+    void insert(T& data)
+    {
+        Node* parent = nullptr;
+        Node* node = root;
+        while (node) {
+            parent = node;
+            if (data < node->data)
+                node = node->left;
+            else if (data > node->data)
+                node = node->right;
+            else {
+                // Already present, the sizes counted on the way down are restored
+                for (node = node->parent; node; node = node->parent)
+                    node->size--;
+                return;
+            }
+            parent->size++;
+        }
+
+        node = pool.Create(std::move(data));
+        node->parent = parent;
+        // A new extreme node is always linked below the old one
+        if (!min_node || (parent == min_node && node->data < parent->data))
+            min_node = node;
+        if (!max_node || (parent == max_node && parent->data < node->data))
+            max_node = node;
+        count++;
+        if (!parent)
+            root = node;
+        else if (node->data < parent->data)
+            parent->left = node;
+        else
+            parent->right = node;
+
+        insertFixup(node);
+    }
+
+    /// @brief Removes node with the specified value
+    /// @param data Value to remove
+    void deleteNode(const T& data)
+    {
+        Node* node = search(data);
+        if (!node)
+            return;
+
+        if (node->left && node->right)
+        {
+            // node with two children
+            // successor (smallest in the right subtree) replaces the deleted value
+            Node* next = minValueNode(node->right);
+            node->data = std::move(next->data);
+            node = next;
+        }
+        unlink(node);
+    }
+
+    /// @brief Searches specified value
+    /// @param data Value to find
+    /// @return Found node, nullptr if there is no such value
+    Node* search(const T& data) const
+    {
+        Node* node = root;
+        while (node && !(node->data == data))
+            node = node->data < data ? node->right : node->left;
+        return node;
+    }
+
+    /// @brief Searches the first node not less than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are less
+    Node* lowerBound(const T& data) const
+    {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (node->data < data)
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
+
+    /// @brief Searches the first node greater than the value
+    /// @param data Value to compare with
+    /// @return Found node, nullptr if all nodes are not greater
+    Node* upperBound(const T& data) const
+    {
+        Node* node = root;
+        Node* found = nullptr;
+        while (node) {
+            if (!(data < node->data))
+                node = node->right;
+            else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
+
+    /// @brief Counts elements not greater than the value
+    size_t countNotGreater(const T& data) const
+    {
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (!(data < node->data)) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
+
+    /// @brief Moves all elements out of the tree in sorted order.
+    /// Nodes are left with moved-from values and must be cleared afterwards
+    /// @param elements Container to move elements to
+    void moveOut(std::vector<T>& elements)
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(std::move(node->data));
+    }
+
+    /// @brief Builds balanced tree from the sorted range.
+    /// All levels but the last one are full, so the nodes of the last level are red and the rest are black
+    /// @param first First element of the range
+    /// @param last Element after the last one of the range
+    /// @return Root of the built tree
+    Node* buildBalanced(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last)
+    {
+        int last_level = 0;
+        while ((size_t(2) << last_level) <= size_t(last - first))
+            last_level++;
+        return buildSubtree(first, last, 0, last_level);
+    }
+
+    /// @brief Builds balanced subtree from the sorted range.
+    /// Recursion depth is only log N, as the built subtree is balanced
+    /// @param first First element of the range
+    /// @param last Element after the last one of the range
+    /// @param level Depth of the subtree root
+    /// @param red_level Depth of the red nodes
+    /// @return Root of the built subtree
+    Node* buildSubtree(typename std::vector<T>::iterator first, typename std::vector<T>::iterator last,
+        int level, int red_level)
+    {
+        if (first == last)
+            return nullptr;
+
+        auto middle = first + (last - first) / 2;
+        Node* node = pool.Create(std::move(*middle));
+        node->left = buildSubtree(first, middle, level + 1, red_level);
+        node->right = buildSubtree(middle + 1, last, level + 1, red_level);
+        if (node->left)
+            node->left->parent = node;
+        if (node->right)
+            node->right->parent = node;
+        node->size = 1 + subtreeSize(node->left) + subtreeSize(node->right);
+        node->red = level == red_level && level > 0;
+        return node;
+    }
+
+    /// @brief Delete all elements of the subtree without recursion:
+    /// left children are rotated up until the node has none and can be destroyed
+    /// @param node Subtree root
+    void clearSubtree(Node* node) {
+        while (node) {
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            }
+            else {
+                Node* right = node->right;
+                pool.Destroy(node);
+                node = right;
+            }
+        }
+    }
+
+    /// @brief Respresents tree as array
+    /// @param elements Container to save elements
+    void InOrder(std::vector<T>& elements) const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            elements.push_back(node->data);
+    }
+
+public:
+    /// @brief Bidirectional iterator over the elements in sorted order.
+    /// Steps along the parent links, so iterating doesn't allocate.
+    /// Elements can't be changed through it, as it would break the order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        const_iterator& operator++()
+        {
+            node = successor(node);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        /// @brief Steps back, end() steps to the maximum element
+        const_iterator& operator--()
+        {
+            node = node ? predecessor(node) : tree->max_node;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+    private:
+        friend class RBTree;
+
+        const_iterator(Node* node, const RBTree* tree)
+            : node(node), tree(tree) {}
+
+        Node* node = nullptr;
+        const RBTree* tree = nullptr;
+    };
+
+    using iterator = const_iterator;
+    using range = TreeRange<const_iterator>;
+
+    /// @brief Inserts value to the tree
+    /// @param data Value to insert
+    void append(T data)
+    {
+        insert(data); // data is moved into the tree
+    }
+
+    /// @brief Inserts all elements at once: merges them with the tree content
+    /// and rebuilds the balanced tree in O(N + M log M).
+    /// As in append, elements equal to the already present ones are skipped
+    /// @param elements Elements to insert
+    void AppendRange(std::vector<T> elements)
+    {
+        std::stable_sort(elements.begin(), elements.end());
+
+        std::vector<T> merged;
+        merged.reserve(count + elements.size());
+        moveOut(merged);
+        size_t old_size = merged.size();
+        merged.insert(merged.end(),
+            std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+        std::inplace_merge(merged.begin(), merged.begin() + old_size, merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        clear();
+        root = buildBalanced(merged.begin(), merged.end());
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = merged.size();
+    }
+
+    /// @brief Removes tree element with the specified value
+    /// @param data Value to remove
+    void remove(const T& data)
+    {
+        deleteNode(data);
+    }
+
+    /// @brief Removes up to n maximum elements.
+    /// When a large part of the tree is removed, the rest is rebuilt in O(N)
+    /// instead of removing elements one by one
+    /// @param n Number of elements to remove
+    /// @param removed Container to append removed elements to, in descending order
+    /// @return Number of removed elements
+    size_t RemoveMaxN(size_t n, std::vector<T>& removed)
+    {
+        n = std::min(n, count);
+        size_t depth = 1;
+        while ((size_t(1) << depth) <= count)
+            depth++;
+
+        if (n * depth < count) {
+            for (size_t i = 0; i < n; i++)
+                removed.push_back(PopMax());
+            return n;
+        }
+
+        std::vector<T> elements;
+        elements.reserve(count);
+        moveOut(elements);
+        removed.insert(removed.end(),
+            std::make_move_iterator(elements.rbegin()), std::make_move_iterator(elements.rbegin() + n));
+
+        clear();
+        root = buildBalanced(elements.begin(), elements.end() - n);
+        min_node = minValueNode(root);
+        max_node = maxValueNode(root);
+        count = elements.size() - n;
+        return n;
+    }
+
+    size_t Size() const
+    {
+        return count;
+    }
+
+    /// @return Number of rotations made since the tree was created
+    size_t Rotations() const
+    {
+        return rotations;
+    }
+
+    bool GetElem(const T& data) const{
+        return search(data);
+    }
+
+    std::list<T> GetElementsByInterval(T min, T max) const
+    {
+        range elements = Interval(min, max);
+        return std::list<T>(elements.begin(), elements.end());
+    }
+
+    const_iterator begin() const { return const_iterator(min_node, this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    /// @return Iterator to the first element not less than the value
+    const_iterator lower_bound(const T& data) const { return const_iterator(lowerBound(data), this); }
+
+    /// @return Iterator to the first element greater than the value
+    const_iterator upper_bound(const T& data) const { return const_iterator(upperBound(data), this); }
+
+    /// @return Iterators to the range of elements equal to the value
+    std::pair<const_iterator, const_iterator> equal_range(const T& data) const
+    {
+        return { lower_bound(data), upper_bound(data) };
+    }
+
+    /// @brief Lazy view of the elements from the interval, nothing is copied
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return View of the elements in [min, max] in sorted order
+    range Interval(const T& min, const T& max) const
+    {
+        if (max < min)
+            return range(end(), end());
+        return range(lower_bound(min), upper_bound(max));
+    }
+
+    /// @brief Finds the element by its position in sorted order in O(height).
+    /// The k-th highest element is Select(Size() - 1 - k)
+    /// @param k Zero-based position of the element
+    /// @return The element, throws std::out_of_range if k is not less than the size
+    const T& Select(size_t k) const
+    {
+        if (k >= count)
+            throw std::out_of_range("Position is out of the tree");
+
+        Node* node = root;
+        while (true) {
+            size_t left = subtreeSize(node->left);
+            if (k < left)
+                node = node->left;
+            else if (k == left)
+                return node->data;
+            else {
+                k -= left + 1;
+                node = node->right;
+            }
+        }
+    }
+
+    /// @brief Counts elements less than the value in O(height)
+    /// @param data Value to compare with
+    /// @return Position the value would take in sorted order
+    size_t Rank(const T& data) const
+    {
+        size_t rank = 0;
+        for (Node* node = root; node; ) {
+            if (node->data < data) {
+                rank += subtreeSize(node->left) + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
+        return rank;
+    }
+
+    /// @brief Counts elements of the interval in O(height), without visiting them
+    /// @param min Minimum element of the interval
+    /// @param max Maximum element of the interval
+    /// @return Number of elements in [min, max]
+    size_t CountInRange(const T& min, const T& max) const
+    {
+        if (max < min)
+            return 0;
+        return countNotGreater(max) - Rank(min);
+    }
+
+    void print() const
+    {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            std::cout << node->data << std::endl;
+    }
+
+    void IncrementElemByOne() {
+        for (Node* node = minValueNode(root); node; node = successor(node))
+            ++(node->data);
+    }
+
+    /// @brief Deletes all elements. Node pool releases trivially destructible nodes at once
+    void clear() {
+        if (!root)
+            return;
+
+        if (!(Allocator<Node>::kReleasesAll && std::is_trivially_destructible<Node>::value))
+            clearSubtree(this->root);
+        pool.Release();
+
+        root = nullptr;
+        min_node = max_node = nullptr;
+        count = 0;
+    }
+
+    void FillRandom(size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            T elem;
+            elem.random();
+            this->append(std::move(elem));
+        }
+    }
+
+    /// @brief Fills the tree with random elements using AppendRange
+    /// @param size Number of elements
+    void FillRange(size_t size) {
+        std::vector<T> elements(size);
+        for (T& elem : elements)
+            elem.random();
+        this->AppendRange(elements);
+    }
+
+    bool isEmpty() const
+    {
+        return root == nullptr;
+    }
+
+    /// @brief Gets maximum tree element in O(1). The tree must not be empty
+    /// @return Maximum element
+    const T& GetMax() const
+    {
+        return max_node->data;
+    }
+
+    /// @brief Gets maximum tree element in O(1) to change it in place. The tree must not be empty.
+    /// The change must keep the order of the element
+    /// @return Maximum element
+    T& GetMax()
+    {
+        return max_node->data;
+    }
+
+    /// @brief Finds the element equal to the value to change it in place.
+    /// The change must keep the order of the element
+    /// @return The element, nullptr if there is none
+    T* Find(const T& data)
+    {
+        Node* node = search(data);
+        return node ? &node->data : nullptr;
+    }
+
+    /// @brief Gets minimum tree element in O(1). The tree must not be empty
+    /// @return Minimum element
+    const T& GetMin() const
+    {
+        return min_node->data;
+    }
+
+    /// @brief Removes maximum tree element. The tree must not be empty
+    /// @return Maximum element, moved out of the tree
+    T PopMax()
+    {
+        Node* node = max_node;
+        T max = std::move(node->data);
+        unlink(node);
+        return max;
+    }
+
+    ~RBTree()
+    {
+        this->clear();
+    }
+
+
+#ifdef BENCHMARK_BENCHMARK_H_
+
+private:
+
+    static void append_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            T data;
+            data.random();
+            rb.append(data);
+        }
+
+        rb.clear();
+    }
+
+    static void get_element_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        rb.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            rb.GetElem(elements[mersenne() % elements.size()]);
+        }
+
+        rb.clear();
+    }
+
+    static void get_elements_interval_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        rb.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        size_t start, end;
+
+        for (auto _ : state) {
+            start = mersenne() % elements.size(); end = mersenne() % elements.size();
+            if (start > end) std::swap(start, end);
+            rb.GetElementsByInterval(elements[start], elements[end]);
+        }
+
+        rb.clear();
+    }
+
+    static void count_in_range_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        rb.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        size_t start, end;
+
+        for (auto _ : state) {
+            start = mersenne() % elements.size(); end = mersenne() % elements.size();
+            if (start > end) std::swap(start, end);
+            benchmark::DoNotOptimize(rb.CountInRange(elements[start], elements[end]));
+        }
+
+        rb.clear();
+    }
+
+    static void select_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(rb.Select(mersenne() % rb.Size()));
+        }
+
+        rb.clear();
+    }
+
+    static void get_max_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(rb.GetMax());
+        }
+
+        rb.clear();
+    }
+
+    static void pop_max_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+
+        for (auto _ : state) {
+            state.PauseTiming();
+            rb.FillRange(state.range(0));
+            state.ResumeTiming();
+
+            while (!rb.isEmpty())
+                benchmark::DoNotOptimize(rb.PopMax());
+        }
+    }
+
+    static void remove_element_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        std::vector<T> elements;
+        rb.InOrder(elements);
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            rb.remove(elements[mersenne() % elements.size()]);
+        }
+
+        rb.clear();
+    }
+
+    static void increase_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+        rb.FillRandom(state.range(0));
+
+        for (auto _ : state) {
+            rb.IncrementElemByOne();
+        }
+
+        rb.clear();
+    }
+
+    static void fill_random_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+
+        for (auto _ : state) {
+            rb.FillRandom(state.range(0));
+        }
+
+        rb.clear();
+    }
+
+    static void fill_range_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+
+        for (auto _ : state) {
+            rb.FillRange(state.range(0));
+        }
+
+        rb.clear();
+    }
+
+    static void fill_random_ascending_order_RBTree_BM(benchmark::State& state)
+    {
+        RBTree tree;
+
+        T elem; elem.random();
+
+        for (auto _ : state) {
+            for (size_t i = 0; i < state.range(0); i++) {
+                tree.append(++elem);
+            }
+        }
+        tree.clear();
+    }
+
+    static void fill_random_descending_order_RBTree_BM(benchmark::State& state)
+    {
+        RBTree tree;
+
+        T elem; elem.random();
+
+        for (auto _ : state) {
+            for (size_t i = 0; i < state.range(0); i++) {
+                tree.append(--elem);
+            }
+        }
+        tree.clear();
+    }
+
+
+    template<template<typename> class NodeAllocator>
+    static void churn_RBTree_BM(benchmark::State& state)
+    {
+        RBTree<T, NodeAllocator> rb;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements)
+            elem.random();
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+
+        for (auto _ : state) {
+            for (const T& elem : elements)
+                rb.append(elem);
+            for (size_t i = 0; i < elements.size() / 2; i++)
+                rb.remove(elements[mersenne() % elements.size()]);
+            rb.clear();
+        }
+
+        state.SetItemsProcessed(state.iterations() * elements.size());
+        state.counters["RSS_KB"] = ResidentSetBytes() / 1024.0;
+    }
+
+    static void mixed_RBTree_BM(benchmark::State& state)
+    {
+        RBTree rb;
+
+        std::vector<T> elements(state.range(0));
+        for (T& elem : elements) {
+            elem.random();
+            rb.append(elem);
+        }
+
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+        size_t start_rotations = rb.rotations;
+
+        for (auto _ : state) {
+            // Replaces a random element, as the queue does under mixed traffic
+            size_t i = mersenne() % elements.size();
+            rb.remove(elements[i]);
+            elements[i].random();
+            rb.append(elements[i]);
+        }
+
+        state.SetItemsProcessed(state.iterations() * 2);
+        state.counters["rotations"] = benchmark::Counter(
+            double(rb.rotations - start_rotations), benchmark::Counter::kAvgIterations);
+        rb.clear();
+    }
+
+public:
+
+    // Appends benchmarking function to the benchmarking queue
+    void append_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(append_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetElem_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_element_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetElementsByInterval_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_elements_interval_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    // Counts the interval elements using subtree sizes, compare with GetElementsByInterval_BM
+    void CountInRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(count_in_range_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void Select_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(select_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void GetMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(get_max_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void PopMax_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(pop_max_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void remove_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(remove_element_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void IncreaseByOne_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(increase_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRandom_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_random_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRange_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_range_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRandomAscendingOrder_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_random_ascending_order_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    void FillRandomDescendingOrder_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(fill_random_descending_order_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking function to the benchmarking queue
+    // Counts rotations per removal and insertion, compare with AVLTree::Mixed_BM
+    void Mixed_BM(size_t maxElems, size_t iterations) {
+        BENCHMARK(mixed_RBTree_BM)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+    // Appends benchmarking functions to the benchmarking queue
+    // Compares insert/remove/clear throughput and memory of the node pool and plain new/delete
+    void Churn_BM(size_t maxElems, size_t iterations) {
+        benchmark::RegisterBenchmark("churn_RBTree_BM<NodePool>", churn_RBTree_BM<NodePool>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+        benchmark::RegisterBenchmark("churn_RBTree_BM<NewDeleteAllocator>", churn_RBTree_BM<NewDeleteAllocator>)->Unit(benchmark::kMicrosecond)->RangeMultiplier(10)->Range(1, maxElems)->Iterations(iterations);
+    }
+
+#endif
+
+};
+
+
+#undef private
+#undef protected
\ No newline at end of file
@@ -0,0 +1,413 @@
+/*
+*
+ *  RadixHeapPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <cstdint>
+#include <climits>
+#include <random>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+#include "bit_scan.h"
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Radix heap for monotone workloads, where no element is inserted
+/// with a higher priority than the last popped one (event simulation, Dijkstra-like searches).
+/// Unlike BucketPriorityQueue it takes any int priority. Elements are spread over 33 buckets
+/// by the highest bit in which their priority differs from the last popped one.
+/// Insert is O(1), Pop is amortised O(log U): every element moves to a lower bucket
+/// at most 32 times. Equal priorities are popped in arrival order
+/// @tparam T
+template<typename T>
+class RadixHeapPriorityQueue
+    : public PriorityQueue<T>
+{
+public:
+    /// @exception std::out_of_range Thrown when the priority is higher than the last popped one
+    void Insert(T data, int priority) override;
+    T Pop() override;
+    T Peek() const override;
+
+protected:
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    void checkPriority(int priority) const override;
+
+private:
+    struct Entry
+    {
+        uint32_t key;
+        T data;
+
+        Entry(uint32_t key, T data)
+            : key(key), data(std::move(data)) {}
+    };
+
+    static constexpr int kBuckets = 32;
+
+    // Elements with the key equal to last
+    Bucket<T> top;
+    // buckets[i] holds elements whose key differs from last first in bit i
+    std::vector<Entry> buckets[kBuckets];
+    // Bit i is set when buckets[i] is not empty
+    uint64_t non_empty = 0;
+    // Key of the last popped element, keys of all elements are not less than it
+    uint32_t last = 0;
+    // Elements of the bucket being spread, kept to reuse its storage
+    std::vector<Entry> spread;
+
+    bool isEmpty() const override;
+
+    /// @brief Maps priorities to keys in reverse order, so the highest priority has the lowest key
+    static uint32_t toKey(int priority) { return uint32_t(INT_MAX) - uint32_t(priority); }
+    static int toPriority(uint32_t key) { return int(uint32_t(INT_MAX) - key); }
+
+    void push(uint32_t key, T data);
+
+    /// @brief Makes top not empty: takes the lowest non-empty bucket, moves last to its minimum
+    /// and spreads its elements over the lower buckets. The queue must not be empty
+    void settle();
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T>
+inline void RadixHeapPriorityQueue<T>::Insert(T data, int priority)
+{
+    checkPriority(priority);
+    push(toKey(priority), std::move(data));
+}
+
+template<typename T>
+inline void RadixHeapPriorityQueue<T>::checkPriority(int priority) const
+{
+    if (toKey(priority) < last)
+        throw std::out_of_range("Priority is higher than the last popped one");
+}
+
+template<typename T>
+inline T RadixHeapPriorityQueue<T>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else
+    {
+        if (top.Empty())
+            settle();
+        return top.Pop();
+    }
+}
+
+template<typename T>
+inline T RadixHeapPriorityQueue<T>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else if (!top.Empty())
+        return top.Front();
+    else
+    {
+        const std::vector<Entry>& bucket = buckets[LowestBit(non_empty)];
+        const Entry* min = &bucket.front();
+        for (const Entry& entry : bucket)
+        {
+            if (entry.key < min->key)
+                min = &entry;
+        }
+        return min->data;
+    }
+}
+
+template<typename T>
+inline void RadixHeapPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // Equal keys share the bucket in arrival order, they are spread together
+    int top_priority = toPriority(last);
+    top.ForEach([&](const T& data) { visit(data, top_priority); });
+    for (const std::vector<Entry>& bucket : buckets)
+    {
+        for (const Entry& entry : bucket)
+            visit(entry.data, toPriority(entry.key));
+    }
+}
+
+template<typename T>
+inline bool RadixHeapPriorityQueue<T>::isEmpty() const
+{
+    return top.Empty() && non_empty == 0;
+}
+
+template<typename T>
+inline void RadixHeapPriorityQueue<T>::push(uint32_t key, T data)
+{
+    if (key == last)
+        top.Push(std::move(data));
+    else
+    {
+        int index = HighestBit(key ^ last);
+        buckets[index].push_back(Entry(key, std::move(data)));
+        non_empty |= uint64_t(1) << index;
+    }
+}
+
+template<typename T>
+inline void RadixHeapPriorityQueue<T>::settle()
+{
+    int index = LowestBit(non_empty);
+    spread.swap(buckets[index]);
+    non_empty &= ~(uint64_t(1) << index);
+
+    uint32_t min = spread.front().key;
+    for (const Entry& entry : spread)
+    {
+        if (entry.key < min)
+            min = entry.key;
+    }
+
+    // Elements differ from the new last in lower bits only, so they all land in the lower buckets
+    last = min;
+    for (Entry& entry : spread)
+        push(entry.key, std::move(entry.data));
+    spread.clear();
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    RadixHeapPriorityQueue<int> q;
+
+    q.Insert(1111, INT_MAX);
+    CHECK(q.top.Front() == 1111);
+
+    q.Insert(2222, INT_MAX - 1);
+    q.Insert(3333, INT_MAX - 5);
+    CHECK(q.buckets[0][0].data == 2222);
+    CHECK(q.buckets[2][0].data == 3333);
+    CHECK(q.non_empty == 0b101);
+
+    q.Insert(4444, INT_MIN);
+    CHECK(q.buckets[31][0].data == 4444);
+}
+
+TEST_CASE("Peek")
+{
+    RadixHeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+    q.Pop();
+    CHECK(q.Peek() == 3333);
+}
+
+TEST_CASE("Pop")
+{
+    RadixHeapPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, -5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK_THROWS_AS(q.Insert(4444, 11), const std::out_of_range&);
+    q.Insert(4444, 10);
+    q.Insert(5555, 7);
+
+    CHECK(q.Pop() == 4444);
+    CHECK(q.Pop() == 5555);
+    CHECK(q.Pop() == 1111);
+    CHECK(q.Pop() == 3333);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    RadixHeapPriorityQueue<int> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items;
+    for (int i = 0; i < 100; i++)
+        items.push_back(Item<int>(i, (i * 37) % 100));
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 27, 54, 81 });
+
+    CHECK(q.PopN(1000, popped) == 98);
+    CHECK(popped.back() == 0);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Radix heap pops a monotone workload in priority and arrival order")
+{
+    RadixHeapPriorityQueue<std::pair<int, int>> q;
+    std::mt19937 mersenne(7);
+    int arrival = 0;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        int priority = INT_MAX - int(mersenne() % 100000);
+        q.Insert({ priority, arrival++ }, priority);
+    }
+
+    // Every popped element brings new ones not higher than itself, as in the Dijkstra search
+    std::pair<int, int> prev = q.Pop();
+    for (int i = 0; i < 50000; i++)
+    {
+        for (int k = 0; k < 2 && prev.first > INT_MIN + 1000000; k++)
+        {
+            int priority = prev.first - int(mersenne() % (k == 0 ? 4 : 1000000));
+            q.Insert({ priority, arrival++ }, priority);
+        }
+        std::pair<int, int> cur = q.Pop();
+        CHECK(cur.first <= prev.first);
+        if (cur.first == prev.first)
+            CHECK(cur.second > prev.second);
+        prev = cur;
+    }
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    RadixHeapPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    RadixHeapPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    RadixHeapPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+
+    // Nothing is inserted when a saved priority is higher than the last popped one
+    RadixHeapPriorityQueue<int> source;
+    source.Insert(1111, 1);
+    source.Insert(2222, 10);
+    std::stringstream higher;
+    source.Save(higher);
+    RadixHeapPriorityQueue<int> target;
+    target.Insert(3333, 5);
+    CHECK(target.Pop() == 3333);
+    CHECK_THROWS_AS(target.Load(higher), const std::out_of_range&);
+    CHECK_THROWS_AS(target.Pop(), const std::underflow_error&);
+}
+
+#endif
+
+
+#ifdef BENCHMARK_BENCHMARK_H_
+
+/// @brief Benchmarks of the RadixHeapPriorityQueue throughput.
+/// Elements are their priorities, so every popped element brings a new one
+/// not higher than itself and the workload stays monotone
+class RadixHeapBenchmark
+{
+private:
+    static void fill(RadixHeapPriorityQueue<int>& queue, int64_t count, std::mt19937& mersenne)
+    {
+        queue = RadixHeapPriorityQueue<int>();
+        for (int64_t i = 0; i < count; i++) {
+            int priority = INT_MAX - int(mersenne() % 1024);
+            queue.Insert(priority, priority);
+        }
+    }
+
+    static void insert_pop_RadixHeap_BM(benchmark::State& state)
+    {
+        RadixHeapPriorityQueue<int> queue;
+        std::random_device rd;
+        std::mt19937 mersenne(rd());
+        fill(queue, state.range(0), mersenne);
+
+        for (auto _ : state) {
+            int popped = queue.Pop();
+            int priority = popped - int(mersenne() % 1024);
+            queue.Insert(priority, priority);
+
+            // Priorities only go down, the queue is refilled before they run out
+            if (popped < 0) {
+                state.PauseTiming();
+                fill(queue, state.range(0), mersenne);
+                state.ResumeTiming();
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+
+public:
+    // Appends benchmarking function to the benchmarking queue
+    // Reports Pop+Insert throughput on a queue holding 1 to maxElems elements
+    void InsertPop_BM(size_t maxElems) {
+        BENCHMARK(insert_pop_RadixHeap_BM)->RangeMultiplier(10)->Range(1, maxElems);
+    }
+};
+
+#endif // BENCHMARK_BENCHMARK_H_
@@ -0,0 +1,387 @@
+/*
+*
+ *  SortedVectorPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <sstream>
+#include <map>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "item.h"
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Priority queue on the sorted array with the unsorted insertion buffer.
+/// Insert appends to the buffer. The full buffer is sorted and merged into the array in one pass
+/// over the tail of the array it falls into, and Pop takes the last element of the array in O(1).
+/// The buffer may grow up to the size of the array, so the merges of N inserts cost O(N log N)
+/// in total, as for the trees, over contiguous memory.
+/// Pop merges the buffer first only if it holds a priority above the top of the array,
+/// so the batch of inserts followed by the pops merges once, while the pops interleaved
+/// with inserts deep below the top pay O(N) for each merge
+/// @tparam T
+/// @tparam BufferSize Least size of the full buffer
+template<typename T, size_t BufferSize = 64>
+class SortedVectorPriorityQueue
+    : public PriorityQueue<T>
+{
+public:
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+    size_t PopN(size_t count, std::vector<T>& out) override;
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+
+private:
+    // Ascending priority, equal priorities in reverse arrival order: the last element is popped first
+    std::vector<Item<T>> sorted;
+    // Elements in arrival order, not merged yet
+    std::vector<Item<T>> buffer;
+    // Index of the buffer element popped first: the highest priority, the earliest one
+    size_t buffer_top = 0;
+    // Tail of the array during the merge, the storage is kept between the merges
+    std::vector<Item<T>> merged;
+
+    /// @return Whether the buffer holds the element to pop first
+    bool bufferOnTop() const;
+
+    /// @brief Moves the buffer into the sorted array
+    void flush();
+
+    bool isEmpty() const override;
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T, size_t BufferSize>
+inline T SortedVectorPriorityQueue<T, BufferSize>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else {
+        return bufferOnTop() ? buffer[buffer_top].data : sorted.back().data;
+    }
+}
+
+template<typename T, size_t BufferSize>
+inline T SortedVectorPriorityQueue<T, BufferSize>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else {
+        if (bufferOnTop())
+            flush();
+        T data = std::move(sorted.back().data);
+        sorted.pop_back();
+        return data;
+    }
+}
+
+template<typename T, size_t BufferSize>
+inline void SortedVectorPriorityQueue<T, BufferSize>::Insert(T data, int priority)
+{
+    // Equal priority doesn't take the top, the earlier element is popped first
+    if (buffer.empty() || priority > buffer[buffer_top].priority)
+        buffer_top = buffer.size();
+    buffer.push_back(Item<T>(std::move(data), priority));
+
+    if (buffer.size() >= std::max(BufferSize, sorted.size()))
+        flush();
+}
+
+template<typename T, size_t BufferSize>
+inline size_t SortedVectorPriorityQueue<T, BufferSize>::PopN(size_t count, std::vector<T>& out)
+{
+    flush();
+    count = std::min(count, sorted.size());
+
+    auto first = sorted.end() - count;
+    for (auto it = sorted.end(); it != first; )
+        out.push_back(std::move((--it)->data));
+    sorted.erase(first, sorted.end());
+    return count;
+}
+
+template<typename T, size_t BufferSize>
+inline void SortedVectorPriorityQueue<T, BufferSize>::insertRange(std::vector<Item<T>>& items)
+{
+    // The range is merged at once, after the elements inserted before it
+    buffer.insert(buffer.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+    flush();
+}
+
+template<typename T, size_t BufferSize>
+inline bool SortedVectorPriorityQueue<T, BufferSize>::bufferOnTop() const
+{
+    // Equal priority of the array is popped first, it arrived before the buffer
+    return !buffer.empty() && (sorted.empty() || buffer[buffer_top].priority > sorted.back().priority);
+}
+
+template<typename T, size_t BufferSize>
+inline void SortedVectorPriorityQueue<T, BufferSize>::flush()
+{
+    if (buffer.empty())
+        return;
+
+    auto lower_priority = [](const Item<T>& left, const Item<T>& right) {
+        return left.priority < right.priority;
+    };
+
+    // Reversed and stably sorted, equal priorities are in reverse arrival order as in the array
+    std::reverse(buffer.begin(), buffer.end());
+    std::stable_sort(buffer.begin(), buffer.end(), lower_priority);
+
+    // Only the part of the array from the least buffered priority takes part in the merge,
+    // the buffer taken back after the pops goes near the top and moves a short tail
+    auto first = std::lower_bound(sorted.begin(), sorted.end(), buffer.front(), lower_priority);
+    merged.assign(std::make_move_iterator(first), std::make_move_iterator(sorted.end()));
+    sorted.erase(first, sorted.end());
+
+    // On equal priorities the merge takes the buffer first, so its elements are popped later
+    std::merge(std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()),
+        std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.end()),
+        std::back_inserter(sorted), lower_priority);
+    merged.clear();
+    buffer.clear();
+    buffer_top = 0;
+}
+
+template<typename T, size_t BufferSize>
+inline void SortedVectorPriorityQueue<T, BufferSize>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // The array from the top, then the buffer: its equal priorities arrived later
+    for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
+        visit(it->data, it->priority);
+    for (const Item<T>& item : buffer)
+        visit(item.data, item.priority);
+}
+
+template<typename T, size_t BufferSize>
+inline bool SortedVectorPriorityQueue<T, BufferSize>::isEmpty() const
+{
+    return sorted.empty() && buffer.empty();
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    SortedVectorPriorityQueue<int, 4> q;
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    CHECK(q.sorted.empty());
+    CHECK(q.buffer.size() == 3);
+    CHECK(q.buffer[q.buffer_top].data == 2222);
+
+    // The full buffer is merged into the array
+    q.Insert(4444, 7);
+    CHECK(q.buffer.empty());
+    REQUIRE(q.sorted.size() == 4);
+    CHECK(q.sorted[0].data == 1111);
+    CHECK(q.sorted[3].data == 2222);
+}
+
+TEST_CASE("Peek")
+{
+    SortedVectorPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    SortedVectorPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.buffer.empty());
+
+    // Below the top of the array, the buffer isn't merged
+    q.Insert(4444, 2);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.buffer.size() == 1);
+    CHECK(q.Pop() == 4444);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    SortedVectorPriorityQueue<int> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+
+    CHECK(q.PopN(3, popped) == 2);
+    CHECK(popped.back() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+    SortedVectorPriorityQueue<int, 16> q;
+
+    for (int i = 0; i < 300; i++)
+        q.Insert(i, i % 3);
+
+    std::vector<int> popped;
+    while (popped.size() < 300)
+        popped.push_back(q.Pop());
+
+    CHECK(popped[0] == 2);
+    CHECK(popped[99] == 299);
+    CHECK(popped[100] == 1);
+    for (size_t i = 1; i < popped.size(); i++) {
+        if (popped[i - 1] % 3 == popped[i] % 3)
+            CHECK(popped[i - 1] < popped[i]);
+    }
+}
+
+TEST_CASE("Pop order matches the ordered map")
+{
+    SortedVectorPriorityQueue<int, 16> q;
+    std::map<int, std::vector<int>> expected;
+    std::mt19937 mersenne(7);
+
+    auto popExpected = [&]() {
+        auto top = std::prev(expected.end());
+        int value = top->second.front();
+        top->second.erase(top->second.begin());
+        if (top->second.empty())
+            expected.erase(top);
+        return value;
+    };
+
+    for (int i = 0; i < 20000; i++) {
+        switch (mersenne() % 5)
+        {
+        case 0:
+            if (!expected.empty()) {
+                CHECK(q.Peek() == std::prev(expected.end())->second.front());
+                CHECK(q.Pop() == popExpected());
+            }
+            break;
+        case 1:
+        {
+            std::vector<Item<int>> items;
+            for (int j = 0; j < 20; j++, i++) {
+                items.push_back(Item<int>(i, int(mersenne() % 50)));
+                expected[items.back().priority].push_back(i);
+            }
+            q.InsertRange(items.begin(), items.end());
+            break;
+        }
+        default:
+        {
+            int priority = int(mersenne() % 50);
+            q.Insert(i, priority);
+            expected[priority].push_back(i);
+            break;
+        }
+        }
+    }
+
+    std::vector<int> popped;
+    q.PopN(10, popped);
+    for (int value : popped)
+        CHECK(value == popExpected());
+    while (!expected.empty())
+        CHECK(q.Pop() == popExpected());
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    SortedVectorPriorityQueue<CopyCounter, 2> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    for (int i = 0; i < 10; i++)
+        items.push_back(Item<CopyCounter>(CopyCounter(4444 + i), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 3333);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 4444);
+    CHECK(popped[2].value == 4446);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    SortedVectorPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    SortedVectorPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*
+*
+ *  TaskPool.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Fork-join pool of worker threads for the recursive parallel algorithms of the trees.
+/// Invoke runs two functions, one of them may be taken by a worker. While the caller waits
+/// for it, it runs the other queued tasks, so nested Invoke calls don't block the workers.
+/// The caller takes the newest tasks (the small nested ones), the workers take the oldest (the large ones)
+class TaskPool
+{
+public:
+    /// @param threads Number of threads running the tasks together with the caller,
+    /// one per hardware thread by default. With one thread everything runs in the caller
+    explicit TaskPool(size_t threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /// @return Number of threads running the tasks, the caller included
+    size_t Threads() const { return workers.size() + 1; }
+
+    /// @brief Runs both functions, possibly in parallel, and returns when both are done.
+    /// The exception of any of them is rethrown after both are done
+    template<typename First, typename Second>
+    void Invoke(First&& first, Second&& second);
+
+private:
+    struct Task
+    {
+        std::function<void()> run;
+        std::atomic<bool> done{ false };
+        std::exception_ptr error;
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<Task*> tasks;
+    std::mutex lock;
+    std::condition_variable added;
+    bool stopping = false;
+
+    void work();
+
+    static void execute(Task& task);
+
+    /// @brief Runs the newest queued task in the calling thread
+    /// @return False if there are no tasks
+    bool runNewest();
+};
+
+
+#undef private
+#undef protected
+
+
+inline TaskPool::TaskPool(size_t threads)
+{
+    if (threads == 0)
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t i = 1; i < threads; i++)
+        workers.emplace_back([this]() { work(); });
+}
+
+inline TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    added.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+template<typename First, typename Second>
+inline void TaskPool::Invoke(First&& first, Second&& second)
+{
+    if (workers.empty()) {
+        first();
+        second();
+        return;
+    }
+
+    Task task;
+    task.run = std::forward<Second>(second);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push_back(&task);
+    }
+    added.notify_one();
+
+    std::exception_ptr error;
+    try {
+        first();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    // The task lives on this stack, so it is waited for even if the first function threw
+    while (!task.done.load(std::memory_order_acquire)) {
+        if (!runNewest())
+            std::this_thread::yield();
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+    if (task.error)
+        std::rethrow_exception(task.error);
+}
+
+inline void TaskPool::work()
+{
+    while (true) {
+        Task* task = nullptr;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            added.wait(guard, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        execute(*task);
+    }
+}
+
+inline void TaskPool::execute(Task& task)
+{
+    try {
+        task.run();
+    }
+    catch (...) {
+        task.error = std::current_exception();
+    }
+    task.done.store(true, std::memory_order_release);
+}
+
+inline bool TaskPool::runNewest()
+{
+    Task* task = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty())
+            return false;
+        task = tasks.back();
+        tasks.pop_back();
+    }
+    execute(*task);
+    return true;
+}
+
+
+/// @brief Stable merge sort on the task pool: the halves are sorted in parallel and merged in place.
+/// Ranges below the grain are sorted by std::stable_sort. The last merge runs in one thread,
+/// so the speedup is bounded by log2 of the range over the grain
+/// @param grain Size of the range that is sorted without splitting
+template<typename RandomIt>
+inline void ParallelStableSort(RandomIt first, RandomIt last, TaskPool& tasks, size_t grain = 1 << 15)
+{
+    size_t size = size_t(last - first);
+    if (size <= grain || tasks.Threads() == 1) {
+        std::stable_sort(first, last);
+        return;
+    }
+
+    RandomIt middle = first + size / 2;
+    tasks.Invoke([=, &tasks]() { ParallelStableSort(first, middle, tasks, grain); },
+        [=, &tasks]() { ParallelStableSort(middle, last, tasks, grain); });
+    std::inplace_merge(first, middle, last);
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Task pool runs nested tasks")
+{
+    TaskPool tasks(4);
+    CHECK(tasks.Threads() == 4);
+
+    // Sums the range recursively, every level forks
+    std::function<long long(int, int)> sum = [&](int from, int to) -> long long {
+        if (to - from <= 16) {
+            long long result = 0;
+            for (int i = from; i < to; i++)
+                result += i;
+            return result;
+        }
+        int middle = from + (to - from) / 2;
+        long long left = 0, right = 0;
+        tasks.Invoke([&]() { left = sum(from, middle); }, [&]() { right = sum(middle, to); });
+        return left + right;
+    };
+    CHECK(sum(0, 100000) == 100000LL * 99999 / 2);
+
+    TaskPool single(1);
+    int order = 0, first = 0, second = 0;
+    single.Invoke([&]() { first = ++order; }, [&]() { second = ++order; });
+    CHECK(first == 1);
+    CHECK(second == 2);
+}
+
+TEST_CASE("Task pool rethrows the exceptions of the tasks")
+{
+    TaskPool tasks(2);
+    bool finished = false;
+
+    CHECK_THROWS_AS(tasks.Invoke([]() {}, []() { throw std::runtime_error("task"); }), const std::runtime_error&);
+    CHECK_THROWS_AS(tasks.Invoke([]() { throw std::logic_error("caller"); }, [&]() { finished = true; }),
+        const std::logic_error&);
+    CHECK(finished);
+}
+
+TEST_CASE("Parallel stable sort")
+{
+    TaskPool tasks(4);
+    std::mt19937 mersenne(7);
+
+    std::vector<std::pair<int, int>> elements;
+    for (int i = 0; i < 100000; i++)
+        elements.push_back({ int(mersenne() % 1000), i });
+    std::vector<std::pair<int, int>> expected = elements;
+    std::stable_sort(expected.begin(), expected.end(),
+        [](const std::pair<int, int>& left, const std::pair<int, int>& right) { return left.first < right.first; });
+
+    // Equal keys keep the order of the second elements, so the pairs order equals the stable order
+    ParallelStableSort(elements.begin(), elements.end(), tasks, 1000);
+    CHECK(elements == expected);
+}
+#endif
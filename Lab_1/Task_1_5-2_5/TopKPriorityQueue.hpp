@@ -0,0 +1,499 @@
+/*
+*
+ *  TopKPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sstream>
+#include <map>
+#include <set>
+#include <iterator>
+#include <random>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "priority_queue.h"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Bounded priority queue that keeps only the K elements popped first and drops the rest.
+/// Elements are kept in the min-max heap of size K: its root is the element popped last,
+/// one of the root children is the element popped first.
+/// Once the queue is full, an element not above the root is dropped in O(1),
+/// a higher one replaces the root in O(log K). Equal priorities are popped in arrival order,
+/// so the later one of the equal elements is dropped.
+/// Peek is O(1), Pop is O(log K), so inserts and pops may interleave freely
+/// @tparam T
+template<typename T>
+class TopKPriorityQueue
+    : public PriorityQueue<T>
+{
+public:
+    /// @brief Called with the dropped element and its priority: the evicted root or the rejected element
+    using EvictionCallback = std::function<void(T, int)>;
+
+    /// @param capacity Number of the kept elements K
+    /// @param on_evict Called for every dropped element, may be empty
+    explicit TopKPriorityQueue(size_t capacity, EvictionCallback on_evict = nullptr);
+
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+    size_t Capacity() const { return capacity; }
+    size_t Size() const { return heap.size(); }
+
+    /// @return Number of the elements dropped since the queue was created
+    size_t Evicted() const { return evicted; }
+
+    /// @brief Priority an inserted element must exceed to be kept. The queue must be full
+    int Threshold() const { return heap.front().priority; }
+
+    bool Full() const { return heap.size() == capacity; }
+
+protected:
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+
+private:
+    struct Entry
+    {
+        T data;
+        int priority;
+        uint64_t arrival;
+    };
+
+    // Min-max heap in the pop order: the nodes of the even levels are popped after their descendants,
+    // the nodes of the odd levels before them. The root is popped last
+    std::vector<Entry> heap;
+
+    size_t capacity;
+    EvictionCallback on_evict;
+    uint64_t arrivals = 0;
+    size_t evicted = 0;
+
+    /// @return Whether the left entry is popped after the right one
+    static bool popsLater(const Entry& left, const Entry& right)
+    {
+        return left.priority < right.priority ||
+            (left.priority == right.priority && left.arrival > right.arrival);
+    }
+
+    /// @return Whether the node is on an even level, popped after its descendants
+    static bool onMinLevel(size_t index);
+
+    /// @return Index of the entry popped first. The heap must not be empty
+    size_t top() const;
+
+    /// @brief Moves the new entry up to its place
+    void siftUp(size_t index);
+
+    /// @brief Moves the entry up along its grandparents of the same kind of level
+    /// @param min Whether the entry goes along the min levels or along the max ones
+    void siftUpLevels(size_t index, bool min);
+
+    /// @brief Moves the replaced entry down to its place
+    void siftDown(size_t index);
+
+    /// @return Whether the left entry goes above the right one on the min levels, or on the max ones
+    static bool above(const Entry& left, const Entry& right, bool min)
+    {
+        return min ? popsLater(left, right) : popsLater(right, left);
+    }
+
+    void evict(T data, int priority);
+
+    bool isEmpty() const override;
+};
+
+
+#undef private
+#undef protected
+
+
+template<typename T>
+inline TopKPriorityQueue<T>::TopKPriorityQueue(size_t capacity, EvictionCallback on_evict)
+    : capacity(capacity), on_evict(std::move(on_evict))
+{
+    if (capacity == 0)
+        throw std::invalid_argument("Capacity of the top-K queue must be positive");
+    heap.reserve(capacity);
+}
+
+template<typename T>
+inline T TopKPriorityQueue<T>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else {
+        return heap[top()].data;
+    }
+}
+
+template<typename T>
+inline T TopKPriorityQueue<T>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("The queue is empty");
+    else {
+        size_t index = top();
+        T data = std::move(heap[index].data);
+        if (index + 1 < heap.size()) {
+            heap[index] = std::move(heap.back());
+            heap.pop_back();
+            siftDown(index);
+        }
+        else
+            heap.pop_back();
+        return data;
+    }
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::Insert(T data, int priority)
+{
+    if (heap.size() < capacity) {
+        heap.push_back(Entry{ std::move(data), priority, arrivals++ });
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    // Equal to the root, the element arrived later and is popped after it
+    if (priority <= heap.front().priority) {
+        evict(std::move(data), priority);
+        return;
+    }
+
+    Entry root = std::move(heap.front());
+    heap.front() = Entry{ std::move(data), priority, arrivals++ };
+    siftDown(0);
+    evict(std::move(root.data), root.priority);
+}
+
+template<typename T>
+inline bool TopKPriorityQueue<T>::onMinLevel(size_t index)
+{
+    int level = 0;
+    for (size_t nodes = index + 1; nodes > 1; nodes /= 2)
+        level++;
+    return level % 2 == 0;
+}
+
+template<typename T>
+inline size_t TopKPriorityQueue<T>::top() const
+{
+    if (heap.size() <= 2)
+        return heap.size() - 1;
+    return popsLater(heap[1], heap[2]) ? 2 : 1;
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::siftUp(size_t index)
+{
+    if (index == 0)
+        return;
+
+    // The entry goes along the min levels or the max ones, depending on its parent
+    bool min = onMinLevel(index);
+    size_t parent = (index - 1) / 2;
+    if (above(heap[parent], heap[index], min)) {
+        std::swap(heap[parent], heap[index]);
+        siftUpLevels(parent, !min);
+    }
+    else
+        siftUpLevels(index, min);
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::siftUpLevels(size_t index, bool min)
+{
+    while (index > 2) {
+        size_t grandparent = ((index - 1) / 2 - 1) / 2;
+        if (!above(heap[index], heap[grandparent], min))
+            break;
+        std::swap(heap[grandparent], heap[index]);
+        index = grandparent;
+    }
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::siftDown(size_t index)
+{
+    const size_t size = heap.size();
+    const bool min = onMinLevel(index);
+
+    while (true) {
+        // The child or the grandchild that goes above the others on this kind of level
+        size_t first_child = index * 2 + 1;
+        if (first_child >= size)
+            break;
+        size_t best = first_child;
+        if (first_child + 1 < size && above(heap[first_child + 1], heap[best], min))
+            best = first_child + 1;
+        for (size_t grandchild = first_child * 2 + 1; grandchild < std::min(first_child * 2 + 5, size); grandchild++) {
+            if (above(heap[grandchild], heap[best], min))
+                best = grandchild;
+        }
+
+        if (!above(heap[best], heap[index], min))
+            break;
+        std::swap(heap[best], heap[index]);
+        if (best <= first_child + 1)
+            break;
+
+        // The entry moved down two levels, it may belong above its new parent of the other kind
+        size_t parent = (best - 1) / 2;
+        if (above(heap[parent], heap[best], min))
+            std::swap(heap[parent], heap[best]);
+        index = best;
+    }
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::evict(T data, int priority)
+{
+    evicted++;
+    if (on_evict)
+        on_evict(std::move(data), priority);
+}
+
+template<typename T>
+inline void TopKPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    // The heap stays as it is, the entries are ordered by their indices
+    std::vector<size_t> order(heap.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this](size_t left, size_t right) {
+        return popsLater(heap[right], heap[left]);
+    });
+    for (size_t index : order)
+        visit(heap[index].data, heap[index].priority);
+}
+
+template<typename T>
+inline bool TopKPriorityQueue<T>::isEmpty() const
+{
+    return heap.empty();
+}
+
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    TopKPriorityQueue<int> q(2);
+
+    q.Insert(1111, 1);
+    CHECK(q.heap[0].data == 1111);
+    CHECK(!q.Full());
+
+    q.Insert(2222, 10);
+    CHECK(q.heap[0].data == 1111);
+    CHECK(q.Full());
+    CHECK(q.Threshold() == 1);
+
+    // The root is replaced by the higher element
+    q.Insert(3333, 5);
+    CHECK(q.heap[0].data == 3333);
+    CHECK(q.Size() == 2);
+    CHECK(q.Evicted() == 1);
+
+    CHECK_THROWS_AS(TopKPriorityQueue<int>(0), const std::invalid_argument&);
+}
+
+TEST_CASE("Peek")
+{
+    TopKPriorityQueue<int> q(10);
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+}
+
+TEST_CASE("Pop")
+{
+    TopKPriorityQueue<int> q(10);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    // Inserted after the sort
+    q.Insert(4444, 7);
+    CHECK(q.Pop() == 4444);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    TopKPriorityQueue<int> q(3);
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(5, popped) == 3);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 5555 });
+    CHECK(q.Evicted() == 2);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Top-K keeps the elements popped first and reports the dropped ones")
+{
+    const size_t kCapacity = 100;
+    std::vector<std::pair<int, int>> dropped;
+    TopKPriorityQueue<int> q(kCapacity, [&](int data, int priority) { dropped.push_back({ data, priority }); });
+
+    // Priorities with arrival order of the equal ones, ordered as they are popped
+    std::map<std::pair<int, int>, int> all;
+    std::mt19937 mersenne(7);
+    for (int i = 0; i < 10000; i++) {
+        int priority = int(mersenne() % 500);
+        q.Insert(i, priority);
+        all[{ -priority, i }] = i;
+        if (i % 1000 == 999)
+            CHECK(q.Peek() == all.begin()->second);
+    }
+
+    CHECK(q.Size() == kCapacity);
+    CHECK(q.Evicted() == 10000 - kCapacity);
+    CHECK(dropped.size() == 10000 - kCapacity);
+
+    // Every element is either kept or dropped
+    std::vector<bool> seen(10000);
+    for (const auto& elem : dropped)
+        seen[size_t(elem.first)] = true;
+
+    auto expected = all.begin();
+    int lowest_kept = 0;
+    for (size_t i = 0; i < kCapacity; i++, ++expected) {
+        int value = q.Pop();
+        CHECK(value == expected->second);
+        CHECK(!seen[size_t(value)]);
+        seen[size_t(value)] = true;
+        lowest_kept = -expected->first.first;
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](bool elem) { return elem; }));
+
+    // Dropped elements are not above the kept ones
+    for (const auto& elem : dropped)
+        CHECK(elem.second <= lowest_kept);
+}
+
+TEST_CASE("Top-K pops in order while inserts and pops interleave")
+{
+    const size_t kCapacity = 37;
+    TopKPriorityQueue<int> q(kCapacity);
+
+    // Kept elements by their pop order: priority descending, then arrival
+    std::set<std::pair<int, int>> kept;
+    std::mt19937 mersenne(11);
+    for (int i = 0; i < 20000; i++) {
+        if (mersenne() % 3 == 0) {
+            if (kept.empty()) {
+                CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+                continue;
+            }
+            CHECK(q.Peek() == kept.begin()->second);
+            CHECK(q.Pop() == kept.begin()->second);
+            kept.erase(kept.begin());
+            continue;
+        }
+
+        int priority = int(mersenne() % 100);
+        q.Insert(i, priority);
+        if (kept.size() < kCapacity)
+            kept.insert({ -priority, i });
+        else if (priority > -std::prev(kept.end())->first) {
+            kept.erase(std::prev(kept.end()));
+            kept.insert({ -priority, i });
+        }
+        REQUIRE(q.Size() == kept.size());
+        if (q.Full())
+            CHECK(q.Threshold() == -std::prev(kept.end())->first);
+    }
+
+    for (const auto& elem : kept)
+        CHECK(q.Pop() == elem.second);
+    CHECK(q.Size() == 0);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    TopKPriorityQueue<CopyCounter> q(4);
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    items.push_back(Item<CopyCounter>(CopyCounter(6666), 0));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 2);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    TopKPriorityQueue<int> q(10);
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    TopKPriorityQueue<int> loaded(10);
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+
+#endif
@@ -0,0 +1,32 @@
+/*
+*
+ *  TreeRange.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+
+/// @brief Lazy view of the tree elements between two iterators.
+/// Nothing is copied, elements are read from the tree while iterating,
+/// so the view is valid until the tree is modified
+/// @tparam Iterator Tree iterator
+template<typename Iterator>
+class TreeRange
+{
+public:
+    TreeRange(Iterator first, Iterator last)
+        : first(first), last(last) {}
+
+    Iterator begin() const { return first; }
+    Iterator end() const { return last; }
+    bool empty() const { return first == last; }
+
+private:
+    Iterator first;
+    Iterator last;
+};
@@ -0,0 +1,357 @@
+/*
+*
+ *  VEBPriorityQueue.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <sstream>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <random>
+#include <iterator>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+#include "VEBTree.hpp"
+#include "priority_queue.h"
+
+#include "doctest.h"
+
+// For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Priority queue over the ordered set of the integer priorities.
+/// The priorities are int, so the set is the van Emde Boas tree: the top priority is found in O(1),
+/// a new or emptied priority is added or removed in O(log log U) instead of O(log N).
+/// Elements are kept in one bucket per priority, found by hashing
+/// @tparam T
+template<typename T>
+class VEBPriorityQueue : public PriorityQueue<T>
+{
+public:
+    T Peek() const override;
+    T Pop() override;
+    void Insert(T data, int priority) override;
+
+    /// @return Priority of the elements popped first, the queue must not be empty
+    int TopPriority() const;
+
+    /// @brief Finds the priority popped right after the given one in O(log log U)
+    /// @return False if there are no lower priorities
+    bool NextPriority(int priority, int& next) const;
+
+    /// @return Number of the elements of the priority
+    size_t Count(int priority) const;
+
+protected:
+    void insertRange(std::vector<Item<T>>& items) override;
+    void forEach(const std::function<void(const T&, int)>& visit) const override;
+    bool visitsInPopOrder() const override { return true; }
+
+private:
+    OrderedKeySet<int> priorities;
+    std::unordered_map<int, Bucket<T>> buckets;
+
+    bool isEmpty() const override;
+};
+
+#undef private
+#undef protected
+
+template<typename T>
+inline T VEBPriorityQueue<T>::Peek() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("Queue is empty");
+    else {
+        return buckets.find(priorities.Max())->second.Front();
+    }
+}
+
+template<typename T>
+inline T VEBPriorityQueue<T>::Pop()
+{
+    if (this->isEmpty())
+        throw std::underflow_error("Queue is empty");
+    else {
+        int priority = priorities.Max();
+        auto top = buckets.find(priority);
+        T data = top->second.Pop();
+        if (top->second.Empty()) {
+            buckets.erase(top);
+            priorities.Erase(priority);
+        }
+        return data;
+    }
+}
+
+template<typename T>
+inline void VEBPriorityQueue<T>::Insert(T data, int priority)
+{
+    auto found = buckets.find(priority);
+    if (found != buckets.end())
+        found->second.Push(std::move(data));
+    else {
+        buckets.emplace(priority, Bucket<T>(std::move(data), priority));
+        priorities.Insert(priority);
+    }
+}
+
+template<typename T>
+inline int VEBPriorityQueue<T>::TopPriority() const
+{
+    if (this->isEmpty())
+        throw std::underflow_error("Queue is empty");
+    return priorities.Max();
+}
+
+template<typename T>
+inline bool VEBPriorityQueue<T>::NextPriority(int priority, int& next) const
+{
+    return priorities.Predecessor(priority, next);
+}
+
+template<typename T>
+inline size_t VEBPriorityQueue<T>::Count(int priority) const
+{
+    auto found = buckets.find(priority);
+    return found == buckets.end() ? 0 : found->second.Size();
+}
+
+template<typename T>
+inline void VEBPriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+    // Each priority is looked up once for the whole group
+    for (Bucket<T>& group : Bucket<T>::Group(items)) {
+        auto found = buckets.find(group.priority);
+        if (found != buckets.end())
+            found->second.Append(std::move(group));
+        else {
+            priorities.Insert(group.priority);
+            buckets.emplace(group.priority, std::move(group));
+        }
+    }
+}
+
+template<typename T>
+inline void VEBPriorityQueue<T>::forEach(const std::function<void(const T&, int)>& visit) const
+{
+    if (priorities.Empty())
+        return;
+    int priority = priorities.Max();
+    while (true) {
+        buckets.find(priority)->second.ForEach([&](const T& data) { visit(data, priority); });
+        int next;
+        if (!priorities.Predecessor(priority, next))
+            break;
+        priority = next;
+    }
+}
+
+template<typename T>
+inline bool VEBPriorityQueue<T>::isEmpty() const
+{
+    return priorities.Empty();
+}
+
+#ifdef _DEBUG
+TEST_CASE("Insert")
+{
+    VEBPriorityQueue<int> q;
+
+    q.Insert(1111, 1);
+    CHECK(q.priorities.Max() == 1);
+    CHECK(q.buckets.at(1).Front() == 1111);
+
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 5);
+    CHECK(q.priorities.Size() == 3);
+    CHECK(q.priorities.Min() == 1);
+    CHECK(q.priorities.Max() == 10);
+    CHECK(q.Count(5) == 2);
+    CHECK(q.Count(7) == 0);
+}
+
+TEST_CASE("Peek")
+{
+    VEBPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Peek(), const std::underflow_error&);
+    CHECK_THROWS_AS(q.TopPriority(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Peek() == 2222);
+    CHECK(q.TopPriority() == 10);
+}
+
+TEST_CASE("Pop")
+{
+    VEBPriorityQueue<int> q;
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+
+    CHECK(q.Pop() == 2222);
+    CHECK(q.Pop() == 3333);
+    CHECK(q.Pop() == 1111);
+
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+    CHECK(q.buckets.empty());
+}
+
+TEST_CASE("Insert range and pop several elements")
+{
+    VEBPriorityQueue<int> q;
+
+    q.Insert(5555, 6);
+
+    std::vector<Item<int>> items = { {1111, 1}, {2222, 10}, {3333, 5}, {4444, 7}, {6666, 6} };
+    q.InsertRange(items.begin(), items.end());
+
+    std::vector<int> popped;
+    CHECK(q.PopN(4, popped) == 4);
+    CHECK(popped == std::vector<int>{ 2222, 4444, 5555, 6666 });
+
+    CHECK(q.PopN(3, popped) == 2);
+    CHECK(popped.back() == 1111);
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Next priority")
+{
+    VEBPriorityQueue<int> q;
+
+    q.Insert(1, -1000000);
+    q.Insert(2, 0);
+    q.Insert(3, 1000000);
+
+    int next = 0;
+    CHECK(q.NextPriority(1000000, next));
+    CHECK(next == 0);
+    CHECK(q.NextPriority(0, next));
+    CHECK(next == -1000000);
+    CHECK(!q.NextPriority(-1000000, next));
+
+    q.Pop();
+    CHECK(q.TopPriority() == 0);
+    CHECK(q.NextPriority(INT_MAX, next));
+    CHECK(next == 0);
+}
+
+TEST_CASE("Equal priorities are popped in arrival order")
+{
+    VEBPriorityQueue<int> q;
+
+    for (int i = 0; i < 300; i++)
+        q.Insert(i, i % 3);
+
+    std::vector<int> popped;
+    while (popped.size() < 300)
+        popped.push_back(q.Pop());
+
+    CHECK(popped[0] == 2);
+    CHECK(popped[99] == 299);
+    CHECK(popped[100] == 1);
+    for (size_t i = 1; i < popped.size(); i++) {
+        if (popped[i - 1] % 3 == popped[i] % 3)
+            CHECK(popped[i - 1] < popped[i]);
+    }
+}
+
+TEST_CASE("Pop order matches the ordered map")
+{
+    VEBPriorityQueue<int> q;
+    std::map<int, std::vector<int>> expected;
+    std::mt19937 mersenne(7);
+
+    for (int i = 0; i < 20000; i++) {
+        if (mersenne() % 3 == 0 && !expected.empty()) {
+            auto top = std::prev(expected.end());
+            CHECK(q.Pop() == top->second.front());
+            top->second.erase(top->second.begin());
+            if (top->second.empty())
+                expected.erase(top);
+        }
+        else {
+            int priority = (i % 2) ? int(mersenne() % 100) : int(mersenne());
+            q.Insert(i, priority);
+            expected[priority].push_back(i);
+        }
+    }
+    while (!expected.empty()) {
+        auto top = std::prev(expected.end());
+        for (int value : top->second)
+            CHECK(q.Pop() == value);
+        expected.erase(top);
+    }
+    CHECK_THROWS_AS(q.Pop(), const std::underflow_error&);
+}
+
+TEST_CASE("Insert and pop without copying")
+{
+    VEBPriorityQueue<CopyCounter> q;
+    CopyCounter::copies = 0;
+
+    q.Insert(CopyCounter(1111), 1);
+    q.Insert(CopyCounter(2222), 10);
+    q.Emplace(5, 3333);
+
+    std::vector<Item<CopyCounter>> items;
+    items.push_back(Item<CopyCounter>(CopyCounter(4444), 7));
+    items.push_back(Item<CopyCounter>(CopyCounter(5555), 3));
+    q.InsertRange(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+
+    CHECK(q.Pop().value == 2222);
+    CHECK(q.Pop().value == 4444);
+
+    std::vector<CopyCounter> popped;
+    CHECK(q.PopN(3, popped) == 3);
+    CHECK(popped[0].value == 3333);
+    CHECK(popped[1].value == 5555);
+    CHECK(popped[2].value == 1111);
+
+    CHECK(CopyCounter::copies == 0);
+}
+
+TEST_CASE("Save and load")
+{
+    VEBPriorityQueue<int> q;
+    q.Insert(1111, 1);
+    q.Insert(2222, 10);
+    q.Insert(3333, 5);
+    q.Insert(4444, 7);
+    q.Insert(5555, 5);
+
+    std::stringstream stream;
+    q.Save(stream);
+
+    VEBPriorityQueue<int> loaded;
+    loaded.Load(stream);
+
+    // Both queues pop the same elements in the same order
+    for (int value : { 2222, 4444, 3333, 5555, 1111 }) {
+        CHECK(loaded.Pop() == value);
+        CHECK(q.Pop() == value);
+    }
+    CHECK_THROWS_AS(loaded.Pop(), const std::underflow_error&);
+}
+#endif
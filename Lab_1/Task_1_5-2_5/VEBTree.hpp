@@ -0,0 +1,539 @@
+/*
+*
+ *  VEBTree.hpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+#include <set>
+#include <random>
+#include <iterator>
+
+#include "bit_scan.h"
+#include "AVLTree.hpp"
+#include "doctest.h"
+
+
+ // For private methods unit testing
+#ifdef _DEBUG
+#define private public
+#define protected public
+#endif
+
+/// @brief Clusters of the vEB node, created on the first key and freed with the last one.
+/// Up to 256 clusters are kept in a table, more of them in a hash map,
+/// as most clusters of a large sparse universe are never used
+/// @tparam Cluster
+/// @tparam HighBits Cluster index bits
+template<typename Cluster, int HighBits, typename = void>
+class VEBClusters
+{
+public:
+    Cluster* Find(uint64_t index) const
+    {
+        auto found = clusters.find(index);
+        return found == clusters.end() ? nullptr : found->second.get();
+    }
+
+    Cluster& Create(uint64_t index)
+    {
+        std::unique_ptr<Cluster>& cluster = clusters[index];
+        cluster.reset(new Cluster());
+        return *cluster;
+    }
+
+    void Erase(uint64_t index) { clusters.erase(index); }
+
+private:
+    std::unordered_map<uint64_t, std::unique_ptr<Cluster>> clusters;
+};
+
+template<typename Cluster, int HighBits>
+class VEBClusters<Cluster, HighBits, typename std::enable_if<(HighBits <= 8)>::type>
+{
+public:
+    Cluster* Find(uint64_t index) const { return table ? table[index].get() : nullptr; }
+
+    Cluster& Create(uint64_t index)
+    {
+        if (!table)
+            table.reset(new std::unique_ptr<Cluster>[size_t(1) << HighBits]);
+        table[index].reset(new Cluster());
+        return *table[index];
+    }
+
+    void Erase(uint64_t index) { table[index].reset(); }
+
+private:
+    std::unique_ptr<std::unique_ptr<Cluster>[]> table;
+};
+
+
+/// @brief Van Emde Boas node over the keys of Bits bits.
+/// Keys are split into the cluster index (high bits) and the key in the cluster (low bits).
+/// The minimum is kept only in the node and the summary holds the indices of the non-empty clusters,
+/// so every operation goes down into one half of the bits: O(log Bits) = O(log log U).
+/// Nodes of up to 6 bits are single 64-bit words
+/// @tparam Bits
+template<int Bits, typename = void>
+class VEBNode
+{
+public:
+    bool Empty() const { return empty; }
+
+    /// @brief Minimum key in O(1). The node must not be empty
+    uint64_t Min() const { return min; }
+
+    /// @brief Maximum key in O(1). The node must not be empty
+    uint64_t Max() const { return max; }
+
+    bool Contains(uint64_t key) const
+    {
+        if (empty)
+            return false;
+        if (key == min || key == max)
+            return true;
+        Cluster* cluster = clusters.Find(high(key));
+        return cluster && cluster->Contains(low(key));
+    }
+
+    /// @return False if the key is already present
+    bool Insert(uint64_t key)
+    {
+        if (empty) {
+            min = max = key;
+            empty = false;
+            return true;
+        }
+        if (key == min)
+            return false;
+        // The new minimum stays in the node, the old one goes down
+        if (key < min)
+            std::swap(key, min);
+
+        uint64_t index = high(key);
+        Cluster* cluster = clusters.Find(index);
+        if (!cluster) {
+            summary.Insert(index);
+            clusters.Create(index).Insert(low(key));
+        }
+        else if (!cluster->Insert(low(key)))
+            return false;
+
+        if (key > max)
+            max = key;
+        return true;
+    }
+
+    /// @return False if there is no such key
+    bool Erase(uint64_t key)
+    {
+        if (empty)
+            return false;
+        if (min == max) {
+            if (key != min)
+                return false;
+            empty = true;
+            return true;
+        }
+
+        if (key == min) {
+            // The next key becomes the minimum and is erased from its cluster
+            uint64_t first = summary.Min();
+            key = min = index(first, clusters.Find(first)->Min());
+        }
+
+        uint64_t cluster_index = high(key);
+        Cluster* cluster = clusters.Find(cluster_index);
+        if (!cluster || !cluster->Erase(low(key)))
+            return false;
+        if (cluster->Empty()) {
+            clusters.Erase(cluster_index);
+            summary.Erase(cluster_index);
+        }
+
+        if (key == max) {
+            if (summary.Empty())
+                max = min;
+            else {
+                uint64_t last = summary.Max();
+                max = index(last, clusters.Find(last)->Max());
+            }
+        }
+        return true;
+    }
+
+    /// @brief Finds the least key greater than the given one
+    /// @return False if there is none
+    bool Successor(uint64_t key, uint64_t& next) const
+    {
+        if (empty || key >= max)
+            return false;
+        if (key < min) {
+            next = min;
+            return true;
+        }
+
+        uint64_t cluster_index = high(key);
+        Cluster* cluster = clusters.Find(cluster_index);
+        uint64_t found = 0;
+        if (cluster && low(key) < cluster->Max()) {
+            cluster->Successor(low(key), found);
+            next = index(cluster_index, found);
+            return true;
+        }
+        summary.Successor(cluster_index, found);
+        next = index(found, clusters.Find(found)->Min());
+        return true;
+    }
+
+    /// @brief Finds the greatest key less than the given one
+    /// @return False if there is none
+    bool Predecessor(uint64_t key, uint64_t& prev) const
+    {
+        if (empty || key <= min)
+            return false;
+        if (key > max) {
+            prev = max;
+            return true;
+        }
+
+        uint64_t cluster_index = high(key);
+        Cluster* cluster = clusters.Find(cluster_index);
+        uint64_t found = 0;
+        if (cluster && low(key) > cluster->Min()) {
+            cluster->Predecessor(low(key), found);
+            prev = index(cluster_index, found);
+            return true;
+        }
+        if (summary.Predecessor(cluster_index, found))
+            prev = index(found, clusters.Find(found)->Max());
+        else
+            prev = min;
+        return true;
+    }
+
+private:
+    static constexpr int kLowBits = Bits / 2;
+    static constexpr int kHighBits = Bits - kLowBits;
+
+    using Cluster = VEBNode<kLowBits>;
+
+    uint64_t min = 0;
+    uint64_t max = 0;
+    bool empty = true;
+    // Indices of the non-empty clusters
+    VEBNode<kHighBits> summary;
+    VEBClusters<Cluster, kHighBits> clusters;
+
+    static uint64_t high(uint64_t key) { return key >> kLowBits; }
+    static uint64_t low(uint64_t key) { return key & ((uint64_t(1) << kLowBits) - 1); }
+    static uint64_t index(uint64_t high, uint64_t low) { return (high << kLowBits) | low; }
+};
+
+/// @brief Van Emde Boas node over up to 64 keys, a bitmap searched by single bit scans
+template<int Bits>
+class VEBNode<Bits, typename std::enable_if<(Bits <= 6)>::type>
+{
+public:
+    bool Empty() const { return bits == 0; }
+    uint64_t Min() const { return uint64_t(LowestBit(bits)); }
+    uint64_t Max() const { return uint64_t(HighestBit(bits)); }
+
+    bool Contains(uint64_t key) const { return (bits >> key) & 1; }
+
+    bool Insert(uint64_t key)
+    {
+        uint64_t bit = uint64_t(1) << key;
+        bool added = !(bits & bit);
+        bits |= bit;
+        return added;
+    }
+
+    bool Erase(uint64_t key)
+    {
+        uint64_t bit = uint64_t(1) << key;
+        bool erased = (bits & bit) != 0;
+        bits &= ~bit;
+        return erased;
+    }
+
+    bool Successor(uint64_t key, uint64_t& next) const
+    {
+        // Shifting 2 keeps the shift below 64 for the key 63
+        uint64_t above = bits & ~((uint64_t(2) << key) - 1);
+        if (!above)
+            return false;
+        next = uint64_t(LowestBit(above));
+        return true;
+    }
+
+    bool Predecessor(uint64_t key, uint64_t& prev) const
+    {
+        uint64_t below = bits & ((uint64_t(1) << key) - 1);
+        if (!below)
+            return false;
+        prev = uint64_t(HighestBit(below));
+        return true;
+    }
+
+private:
+    uint64_t bits = 0;
+};
+
+
+/// @brief Ordered set of integral keys on the van Emde Boas tree.
+/// Insert, Erase, Successor and Predecessor are O(log log U) for the universe U of the key type,
+/// Min and Max are O(1). Signed keys are mapped to unsigned ones keeping the order
+/// @tparam Key Integral type of up to 64 bits
+template<typename Key>
+class VEBTree
+{
+    static_assert(std::is_integral<Key>::value, "van Emde Boas tree keys must be integral");
+
+public:
+    bool Empty() const { return root.Empty(); }
+    size_t Size() const { return count; }
+
+    /// @brief Minimum key. The set must not be empty
+    Key Min() const { return fromKey(root.Min()); }
+
+    /// @brief Maximum key. The set must not be empty
+    Key Max() const { return fromKey(root.Max()); }
+
+    bool Contains(Key key) const { return root.Contains(toKey(key)); }
+
+    /// @return False if the key is already present
+    bool Insert(Key key)
+    {
+        bool added = root.Insert(toKey(key));
+        count += added;
+        return added;
+    }
+
+    /// @return False if there is no such key
+    bool Erase(Key key)
+    {
+        bool erased = root.Erase(toKey(key));
+        count -= erased;
+        return erased;
+    }
+
+    /// @brief Finds the least key greater than the given one
+    /// @return False if there is none
+    bool Successor(Key key, Key& next) const
+    {
+        uint64_t found = 0;
+        if (!root.Successor(toKey(key), found))
+            return false;
+        next = fromKey(found);
+        return true;
+    }
+
+    /// @brief Finds the greatest key less than the given one
+    /// @return False if there is none
+    bool Predecessor(Key key, Key& prev) const
+    {
+        uint64_t found = 0;
+        if (!root.Predecessor(toKey(key), found))
+            return false;
+        prev = fromKey(found);
+        return true;
+    }
+
+private:
+    using Unsigned = typename std::make_unsigned<Key>::type;
+
+    static constexpr int kBits = int(sizeof(Key) * CHAR_BIT);
+    // Flipping the sign bit maps the negative keys below the positive ones
+    static constexpr Unsigned kSignBit = std::is_signed<Key>::value ? Unsigned(Unsigned(1) << (kBits - 1)) : Unsigned(0);
+
+    VEBNode<kBits> root;
+    size_t count = 0;
+
+    static uint64_t toKey(Key key) { return uint64_t(Unsigned(Unsigned(key) ^ kSignBit)); }
+    static Key fromKey(uint64_t key) { return Key(Unsigned(Unsigned(key) ^ kSignBit)); }
+};
+
+
+/// @brief Ordered set with the interface of VEBTree for any comparable keys, kept in the AVL tree.
+/// Integral keys get the van Emde Boas tree by the specialisation below, so the users
+/// of OrderedKeySet<Key> get O(log log U) operations whenever the key type allows it
+/// @tparam Key
+template<typename Key, typename = void>
+class OrderedKeySet
+{
+public:
+    bool Empty() const { return tree.isEmpty(); }
+    size_t Size() const { return tree.Size(); }
+    Key Min() const { return tree.GetMin(); }
+    Key Max() const { return tree.GetMax(); }
+    bool Contains(const Key& key) const { return tree.GetElem(key); }
+
+    bool Insert(const Key& key)
+    {
+        size_t size = tree.Size();
+        tree.append(key);
+        return tree.Size() != size;
+    }
+
+    bool Erase(const Key& key)
+    {
+        size_t size = tree.Size();
+        tree.remove(key);
+        return tree.Size() != size;
+    }
+
+    bool Successor(const Key& key, Key& next) const
+    {
+        auto found = tree.upper_bound(key);
+        if (found == tree.end())
+            return false;
+        next = *found;
+        return true;
+    }
+
+    bool Predecessor(const Key& key, Key& prev) const
+    {
+        auto found = tree.lower_bound(key);
+        if (found == tree.begin())
+            return false;
+        prev = *--found;
+        return true;
+    }
+
+private:
+    AVLTree<Key> tree;
+};
+
+template<typename Key>
+class OrderedKeySet<Key, typename std::enable_if<std::is_integral<Key>::value>::type>
+    : public VEBTree<Key>
+{
+};
+
+
+#undef private
+#undef protected
+
+
+#ifdef _DEBUG
+TEST_CASE("Van Emde Boas tree matches the set")
+{
+    VEBTree<int> tree;
+    std::set<int> expected;
+    std::mt19937 mersenne(7);
+
+    CHECK(tree.Empty());
+    int found = 0;
+    CHECK(!tree.Successor(0, found));
+    CHECK(!tree.Predecessor(0, found));
+
+    for (int i = 0; i < 20000; i++) {
+        // Dense keys near zero and sparse keys over the whole range
+        int key = (i % 2) ? int(mersenne() % 2000) - 1000 : int(mersenne());
+        if (mersenne() % 3 == 0)
+            CHECK(tree.Erase(key) == (expected.erase(key) == 1));
+        else
+            CHECK(tree.Insert(key) == expected.insert(key).second);
+
+        REQUIRE(tree.Size() == expected.size());
+        if (expected.empty())
+            continue;
+        CHECK(tree.Min() == *expected.begin());
+        CHECK(tree.Max() == *expected.rbegin());
+
+        int probe = (i % 2) ? int(mersenne() % 2000) - 1000 : int(mersenne());
+        CHECK(tree.Contains(probe) == (expected.count(probe) == 1));
+        auto next = expected.upper_bound(probe);
+        CHECK(tree.Successor(probe, found) == (next != expected.end()));
+        if (next != expected.end())
+            CHECK(found == *next);
+        auto prev = expected.lower_bound(probe);
+        CHECK(tree.Predecessor(probe, found) == (prev != expected.begin()));
+        if (prev != expected.begin())
+            CHECK(found == *std::prev(prev));
+    }
+
+    // Walk in both directions
+    int key = tree.Min();
+    size_t steps = 1;
+    while (tree.Successor(key, key))
+        steps++;
+    CHECK(key == tree.Max());
+    CHECK(steps == expected.size());
+    while (tree.Predecessor(key, key))
+        steps--;
+    CHECK(key == tree.Min());
+    CHECK(steps == 1);
+}
+
+TEST_CASE("Van Emde Boas tree keys at the ends of the range")
+{
+    VEBTree<int> tree;
+    CHECK(tree.Insert(INT_MIN));
+    CHECK(tree.Insert(INT_MAX));
+    CHECK(tree.Insert(-1));
+    CHECK(tree.Insert(0));
+    CHECK(!tree.Insert(0));
+    CHECK(tree.Min() == INT_MIN);
+    CHECK(tree.Max() == INT_MAX);
+
+    int found = 0;
+    CHECK(tree.Successor(-1, found));
+    CHECK(found == 0);
+    CHECK(tree.Predecessor(0, found));
+    CHECK(found == -1);
+    CHECK(!tree.Successor(INT_MAX, found));
+    CHECK(!tree.Predecessor(INT_MIN, found));
+
+    CHECK(tree.Erase(INT_MIN));
+    CHECK(tree.Erase(INT_MAX));
+    CHECK(!tree.Erase(INT_MAX));
+    CHECK(tree.Min() == -1);
+    CHECK(tree.Max() == 0);
+
+    VEBTree<uint64_t> wide;
+    wide.Insert(~uint64_t(0));
+    wide.Insert(1);
+    uint64_t next = 0;
+    CHECK(wide.Successor(1, next));
+    CHECK(next == ~uint64_t(0));
+
+    VEBTree<unsigned char> narrow;
+    for (int i = 0; i < 256; i += 5)
+        narrow.Insert((unsigned char)i);
+    CHECK(narrow.Size() == 52);
+    CHECK(narrow.Max() == 255);
+}
+
+TEST_CASE("Ordered key set picks the van Emde Boas tree for integral keys")
+{
+    CHECK(std::is_base_of<VEBTree<int>, OrderedKeySet<int>>::value);
+    CHECK(std::is_base_of<VEBTree<unsigned long long>, OrderedKeySet<unsigned long long>>::value);
+    CHECK(!std::is_base_of<VEBTree<int>, OrderedKeySet<double>>::value);
+
+    OrderedKeySet<double> keys;
+    CHECK(keys.Insert(1.5));
+    CHECK(keys.Insert(-2.5));
+    CHECK(!keys.Insert(1.5));
+    double found = 0;
+    CHECK(keys.Successor(-2.5, found));
+    CHECK(found == 1.5);
+    CHECK(keys.Predecessor(1.5, found));
+    CHECK(found == -2.5);
+    CHECK(keys.Erase(1.5));
+    CHECK(keys.Max() == -2.5);
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// @brief Index of the highest set bit, found by a single count-leading-zeros instruction
+/// @param bits Must not be zero
+inline int HighestBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll(bits);
+#endif
+}
+
+/// @brief Index of the lowest set bit, found by a single count-trailing-zeros instruction
+/// @param bits Must not be zero
+inline int LowestBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+#include "item.h"
+
+/// @brief Queue elements of the same priority in arrival order.
+/// Tree based queues store one bucket per priority, so equal priorities
+/// are appended and popped in O(1) and the tree holds only distinct priorities.
+/// Buckets are compared on priority only, so the trees let the queues change the items
+/// of a bucket in place through GetMax and Find.
+/// @tparam T
+template<typename T>
+struct Bucket
+{
+	int priority;
+
+	bool operator<(const Bucket& bucket) const
+	{
+		return (this->priority < bucket.priority);
+	}
+	bool operator>(const Bucket& bucket) const
+	{
+		return (this->priority > bucket.priority);
+	}
+	bool operator==(const Bucket& bucket) const
+	{
+		return (this->priority == bucket.priority);
+	}
+	bool operator<=(const Bucket& bucket) const
+	{
+		return (this->priority <= bucket.priority);
+	}
+	bool operator>=(const Bucket& bucket) const
+	{
+		return (this->priority >= bucket.priority);
+	}
+
+	Bucket() : priority(0) {}
+
+	/// @brief Creates empty bucket, used as a key to search the tree
+	explicit Bucket(int priority)
+		: priority(priority) {}
+
+	Bucket(T data, int priority)
+		: priority(priority)
+	{
+		items.push_back(std::move(data));
+	}
+
+	bool Empty() const
+	{
+		return head == items.size();
+	}
+
+	size_t Size() const
+	{
+		return items.size() - head;
+	}
+
+	/// @return The earliest element
+	const T& Front() const
+	{
+		return items[head];
+	}
+
+	/// @brief Calls the function for every element from the earliest one
+	template<typename Visit>
+	void ForEach(Visit visit) const
+	{
+		for (size_t i = head; i < items.size(); i++)
+			visit(items[i]);
+	}
+
+	/// @brief Appends the element after all the present ones
+	void Push(T data)
+	{
+		items.push_back(std::move(data));
+	}
+
+	/// @brief Moves all elements of the other bucket after the present ones, the other one is left empty
+	void Append(Bucket&& other)
+	{
+		items.insert(items.end(),
+			std::make_move_iterator(other.items.begin() + other.head), std::make_move_iterator(other.items.end()));
+		other.items.clear();
+		other.head = 0;
+	}
+
+	/// @brief Removes the earliest element. The bucket must not be empty
+	/// @return The element, moved out of the bucket
+	T Pop()
+	{
+		T data = std::move(items[head++]);
+		if (head == items.size()) {
+			items.clear();
+			head = 0;
+		}
+		else if (head >= kCompactSize && head * 2 >= items.size()) {
+			// Popped elements are dropped once they take half of the storage
+			items.erase(items.begin(), items.begin() + head);
+			head = 0;
+		}
+		return data;
+	}
+
+	/// @brief Moves all elements to the container from the earliest one, the bucket is left empty
+	void TakeAll(std::vector<T>& out)
+	{
+		out.insert(out.end(), std::make_move_iterator(items.begin() + head), std::make_move_iterator(items.end()));
+		items.clear();
+		head = 0;
+	}
+
+	/// @brief Groups the items by priority keeping their order inside each group
+	/// @param items Items to group, their data is moved to the buckets
+	/// @return Buckets in ascending order of priority
+	static std::vector<Bucket> Group(std::vector<Item<T>>& items)
+	{
+		std::stable_sort(items.begin(), items.end());
+
+		std::vector<Bucket> buckets;
+		for (Item<T>& item : items) {
+			if (buckets.empty() || buckets.back().priority != item.priority)
+				buckets.push_back(Bucket(item.priority));
+			buckets.back().Push(std::move(item.data));
+		}
+		return buckets;
+	}
+
+private:
+	static constexpr size_t kCompactSize = 32;
+
+	std::vector<T> items;
+	// Index of the earliest element, the ones before it are already popped
+	size_t head = 0;
+};
+
+/// @brief Visits the elements of the search tree of buckets in the order they are popped:
+/// from the highest priority down, each bucket from the earliest element
+/// @param tree Tree with bidirectional iterators, decrementing end() gives the maximum
+/// @param visit Called with the element and its priority
+template<typename Tree, typename Visit>
+inline void ForEachInPopOrder(const Tree& tree, Visit visit)
+{
+	for (auto it = tree.end(); it != tree.begin(); ) {
+		--it;
+		int priority = it->priority;
+		it->ForEach([&](const auto& data) { visit(data, priority); });
+	}
+}
+
+/// @brief Counts the top buckets of the tree that PopN of count elements takes whole
+/// @param tree Tree with bidirectional iterators, decrementing end() gives the maximum
+/// @param count Number of elements to pop
+/// @param taken Number of the elements in the counted buckets
+/// @return Number of the buckets from the maximum down with not more than count elements in total
+template<typename Tree>
+inline size_t CountWholeBuckets(const Tree& tree, size_t count, size_t& taken)
+{
+	size_t whole = 0;
+	taken = 0;
+	for (auto it = tree.end(); it != tree.begin(); whole++) {
+		--it;
+		if (taken + it->Size() > count)
+			break;
+		taken += it->Size();
+	}
+	return whole;
+}
+
+/// @brief Pops count elements from the search tree of buckets in the order they are popped.
+/// The whole top buckets are removed from the tree at once by RemoveMaxN,
+/// the rest is popped from the next bucket, which keeps some of its elements and stays in the tree
+/// @param tree Tree without empty buckets
+/// @param whole Number of the top buckets to take whole, see CountWholeBuckets
+/// @param taken Number of the elements in them, not more than count
+/// @param out Container to append elements to
+/// @return Number of popped elements
+template<typename T, typename Tree>
+inline size_t PopBuckets(Tree& tree, size_t count, size_t whole, size_t taken, std::vector<T>& out)
+{
+	std::vector<Bucket<T>> removed;
+	removed.reserve(whole);
+	tree.RemoveMaxN(whole, removed);
+
+	out.reserve(out.size() + taken);
+	for (Bucket<T>& bucket : removed)
+		bucket.TakeAll(out);
+
+	size_t popped = taken;
+	if (popped < count && tree.Size() > 0) {
+		Bucket<T>& top = tree.GetMax();
+		for (; popped < count; popped++)
+			out.push_back(top.Pop());
+	}
+	return popped;
+}
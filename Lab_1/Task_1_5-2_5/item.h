@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utility>
+
 /// @brief Extra class to store and compare queue elements. 
 /// Includes overloaded comparative operators.
 /// Tree based queues must have comparative elements. 
@@ -10,36 +12,29 @@ struct Item
 	T data;
 	int priority;
 
-	bool operator<(Item item)
+	bool operator<(const Item& item) const
 	{
 		return (this->priority < item.priority);
 	}
-	bool operator>(Item item)
+	bool operator>(const Item& item) const
 	{
 		return (this->priority > item.priority);
 	}
-	bool operator==(Item item)
+	bool operator==(const Item& item) const
 	{
 		return (this->priority == item.priority);
 	}
-	bool operator<=(Item item)
+	bool operator<=(const Item& item) const
 	{
 		return (this->priority <= item.priority);
 	}
-	bool operator>=(Item item)
+	bool operator>=(const Item& item) const
 	{
 		return (this->priority >= item.priority);
 	}
 
-	Item& operator=(const Item& item)
-	{
-		this->data = item.data;
-		this->priority = item.priority;
-		return *this;
-	}
-
 	Item() {}
 
 	Item(T data, int priority)
-		: data(data), priority(priority) {}
+		: data(std::move(data)), priority(priority) {}
 };
\ No newline at end of file
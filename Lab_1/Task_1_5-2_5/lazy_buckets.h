@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+
+#include "item.h"
+#include "bucket.h"
+
+/// @brief Lazy deletion of the buckets in the tree based queues.
+/// The bucket emptied by Pop stays in the tree as a tombstone instead of being removed,
+/// so a priority that is popped and soon inserted again revives its node without restructuring the tree.
+/// Once the tombstones take more than the garbage ratio of the nodes, the tree is rebuilt
+/// from the live buckets in O(N), which is amortised over the pops that left them.
+/// The price is the memory of the tombstones and the walk past them to the next live bucket
+/// @tparam T
+/// @tparam Tree Search tree of the buckets with bidirectional iterators
+template<typename T, typename Tree>
+class LazyBuckets
+{
+public:
+	static constexpr double kDefaultGarbage = 0.5;
+
+	bool Enabled() const { return enabled; }
+
+	/// @brief Starts keeping the emptied buckets in the tree
+	/// @param max_garbage Part of the tree nodes the tombstones may take, in (0, 1)
+	void Enable(const Tree& tree, double max_garbage = kDefaultGarbage)
+	{
+		if (!(max_garbage > 0 && max_garbage < 1))
+			throw std::invalid_argument("Garbage ratio must be in (0, 1)");
+		this->max_garbage = max_garbage;
+		if (enabled)
+			return;
+		enabled = true;
+		dead = 0;
+		live = tree.Size();
+		// The maximum is taken through the iterators, so the compiler sees the tree is checked for emptiness
+		if (tree.begin() != tree.end())
+			top = std::prev(tree.end())->priority;
+	}
+
+	/// @brief Removes the tombstones, the emptied buckets are removed at once again
+	void Disable(Tree& tree)
+	{
+		if (dead)
+			Compact(tree);
+		enabled = false;
+	}
+
+	bool Empty() const { return live == 0; }
+
+	/// @return Number of the empty buckets in the tree
+	size_t Tombstones() const { return dead; }
+
+	/// @return Number of the rebuilds of the tree
+	size_t Compactions() const { return compactions; }
+
+	/// @return Bucket of the highest priority, the queue must not be empty
+	const Bucket<T>& Top(const Tree& tree) const
+	{
+		// Usually the maximum is live, otherwise it is found by the cached priority
+		const Bucket<T>& max = tree.GetMax();
+		if (!max.Empty())
+			return max;
+		return *find(tree, top);
+	}
+
+	/// @brief Pops the top element leaving its bucket in the tree. The queue must not be empty
+	T Pop(Tree& tree)
+	{
+		Bucket<T>& bucket = topBucket(tree);
+		T data = bucket.Pop();
+		if (!bucket.Empty())
+			return data;
+
+		dead++;
+		live--;
+		if (live) {
+			// The highest live bucket is below the emptied one, past the tombstones
+			auto it = tree.lower_bound(Bucket<T>(top));
+			do
+				--it;
+			while (it->Empty());
+			top = it->priority;
+		}
+		if (double(dead) > max_garbage * double(dead + live))
+			Compact(tree);
+		return data;
+	}
+
+	void Insert(Tree& tree, T data, int priority)
+	{
+		if (Bucket<T>* bucket = tree.Find(Bucket<T>(priority))) {
+			if (bucket->Empty())
+				revive();
+			bucket->Push(std::move(data));
+		}
+		else {
+			tree.append(Bucket<T>(std::move(data), priority));
+			live++;
+		}
+		if (live == 1 || priority > top)
+			top = priority;
+	}
+
+	void InsertRange(Tree& tree, std::vector<Item<T>>& items)
+	{
+		bool was_empty = live == 0;
+		std::vector<Bucket<T>> groups = Bucket<T>::Group(items);
+		if (groups.empty())
+			return;
+		// Groups are in ascending order of priority
+		int highest = groups.back().priority;
+
+		std::vector<Bucket<T>> added;
+		for (Bucket<T>& group : groups) {
+			if (Bucket<T>* bucket = tree.Find(Bucket<T>(group.priority))) {
+				if (bucket->Empty())
+					revive();
+				bucket->Append(std::move(group));
+			}
+			else {
+				added.push_back(std::move(group));
+				live++;
+			}
+		}
+		if (!added.empty())
+			tree.AppendRange(std::move(added));
+
+		if (was_empty || highest > top)
+			top = highest;
+	}
+
+	/// @brief Rebuilds the tree from the live buckets in O(N)
+	void Compact(Tree& tree)
+	{
+		// All buckets are moved out in O(N), from the maximum down
+		std::vector<Bucket<T>> all, buckets;
+		all.reserve(dead + live);
+		tree.RemoveMaxN(tree.Size(), all);
+
+		buckets.reserve(live);
+		for (auto it = all.rbegin(); it != all.rend(); ++it) {
+			if (!it->Empty())
+				buckets.push_back(std::move(*it));
+		}
+
+		if (!buckets.empty())
+			tree.AppendRange(std::move(buckets));
+		dead = 0;
+		compactions++;
+	}
+
+private:
+	bool enabled = false;
+	double max_garbage = kDefaultGarbage;
+	// Empty buckets in the tree and the non-empty ones
+	size_t dead = 0;
+	size_t live = 0;
+	size_t compactions = 0;
+	// Priority of the highest live bucket, valid while the queue is not empty
+	int top = 0;
+
+	void revive()
+	{
+		dead--;
+		live++;
+	}
+
+	/// @return Bucket of the highest priority to pop from, the queue must not be empty
+	Bucket<T>& topBucket(Tree& tree)
+	{
+		Bucket<T>& max = tree.GetMax();
+		if (!max.Empty())
+			return max;
+		return *tree.Find(Bucket<T>(top));
+	}
+
+	/// @return Bucket of the priority, live or not, nullptr if there is none
+	static const Bucket<T>* find(const Tree& tree, int priority)
+	{
+		auto found = tree.lower_bound(Bucket<T>(priority));
+		if (found != tree.end() && found->priority == priority)
+			return &*found;
+		return nullptr;
+	}
+};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <map>
 #include <exception>
@@ -9,6 +10,17 @@
 #include "BSTPriorityQueue.hpp"
 #include "AVLPriorityQueue.hpp"
 #include "23TreePriorityQueue.hpp"
+#include "HeapPriorityQueue.hpp"
+#include "PairingHeapPriorityQueue.hpp"
+#include "MultiQueuePriorityQueue.hpp"
+#include "BTreePriorityQueue.hpp"
+#include "RBPriorityQueue.hpp"
+#include "BucketPriorityQueue.hpp"
+#include "RadixHeapPriorityQueue.hpp"
+#include "PersistentAVLPriorityQueue.hpp"
+#include "VEBPriorityQueue.hpp"
+#include "SortedVectorPriorityQueue.hpp"
+#include "TopKPriorityQueue.hpp"
 
 
 
@@ -91,6 +103,8 @@ void PriorityQueueMenu(PriorityQueue<expr::Expression>* pqueue)
 		kPeek = 1,
 		kPop,
 		kInsert,
+		kSave,
+		kLoad,
 		kIsEmpty,
 		kExit = 0
 	};
@@ -102,6 +116,8 @@ void PriorityQueueMenu(PriorityQueue<expr::Expression>* pqueue)
 			"    1 - Peek\n" <<
 			"    2 - Pop\n" <<
 			"    3 - Insert\n" <<
+			"    4 - Save to file\n" <<
+			"    5 - Load from file (adds to the queue)\n" <<
 			"    0 - Exit\n\n";
 
 		int ans;
@@ -146,6 +162,44 @@ void PriorityQueueMenu(PriorityQueue<expr::Expression>* pqueue)
 			{
 				std::cout << "Insertion failed" << std::endl;
 			}
+			catch (std::out_of_range& e)
+			{
+				std::cout << "Out of range error: " << e.what() << std::endl;
+			}
+			break;
+		}
+		case kSave:
+		{
+			std::string path;
+			std::cout << "Type file name: ";
+			std::cin >> path;
+			try {
+				std::ofstream out(path, std::ios::binary);
+				pqueue->Save(out);
+			}
+			catch (std::runtime_error& e)
+			{
+				std::cout << "Saving failed: " << e.what() << std::endl;
+			}
+			break;
+		}
+		case kLoad:
+		{
+			std::string path;
+			std::cout << "Type file name: ";
+			std::cin >> path;
+			try {
+				std::ifstream in(path, std::ios::binary);
+				pqueue->Load(in);
+			}
+			catch (std::runtime_error& e)
+			{
+				std::cout << "Loading failed: " << e.what() << std::endl;
+			}
+			catch (std::out_of_range& e)
+			{
+				std::cout << "Out of range error: " << e.what() << std::endl;
+			}
 			break;
 		}
 		case kExit:
@@ -165,6 +219,17 @@ void MainMenu()
 		kBST,
 		kAVL,
 		k23,
+		kHeap,
+		kPairingHeap,
+		kMultiQueue,
+		kBTree,
+		kRB,
+		kBucket,
+		kRadixHeap,
+		kPersistentAVL,
+		kVEB,
+		kSortedVector,
+		kTopK,
 		kExit = 0
 	};
 
@@ -180,6 +245,17 @@ void MainMenu()
 			"    3 - BST based priority queue\n" <<
 			"    4 - AVL based priority queue\n" <<
 			"    5 - 2-3Tree based priority queue\n" <<
+			"    6 - Binary heap based priority queue\n" <<
+			"    7 - Pairing heap based priority queue\n" <<
+			"    8 - Concurrent (MultiQueue) priority queue\n" <<
+			"    9 - B-tree based priority queue\n" <<
+			"    10 - Red-black tree based priority queue\n" <<
+			"    11 - Bucket priority queue (priorities 0 to 1023)\n" <<
+			"    12 - Radix heap priority queue (priorities not above the last popped)\n" <<
+			"    13 - Persistent AVL based priority queue (with snapshots)\n" <<
+			"    14 - van Emde Boas based priority queue (integer priorities)\n" <<
+			"    15 - Sorted array priority queue (with insertion buffer)\n" <<
+			"    16 - Top-K priority queue (keeps 10 elements of the highest priorities)\n" <<
 			"    0 - Exit\n\n";
 
 		int ans;
@@ -207,6 +283,50 @@ void MainMenu()
 			queue = new B23TreePriorityQueue<expr::Expression>();
 			PriorityQueueMenu(queue);
 			break;
+		case kHeap:
+			queue = new HeapPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kPairingHeap:
+			queue = new PairingHeapPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kMultiQueue:
+			queue = new MultiQueuePriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kBTree:
+			queue = new BTreePriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kRB:
+			queue = new RBPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kBucket:
+			queue = new BucketPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kRadixHeap:
+			queue = new RadixHeapPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kPersistentAVL:
+			queue = new PersistentAVLPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kVEB:
+			queue = new VEBPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kSortedVector:
+			queue = new SortedVectorPriorityQueue<expr::Expression>();
+			PriorityQueueMenu(queue);
+			break;
+		case kTopK:
+			queue = new TopKPriorityQueue<expr::Expression>(10);
+			PriorityQueueMenu(queue);
+			break;
 		case kExit:
 			return;
 		default:
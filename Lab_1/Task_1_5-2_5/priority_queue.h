@@ -1,17 +1,41 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "item.h"
+#include "serialization.h"
+
 /// @brief Interface for the priority queue classes
 /// @tparam T 
 template<typename T>
 class PriorityQueue
 {
 public:
-	/// @brief Insert element with it's priority
+	/// @brief Insert element with it's priority.
+	/// Element is taken by value and moved inside, so rvalues are never copied
 	/// @param data 
 	/// @param priority 
 	virtual void Insert(T data, int priority) = 0;
 
-	/// @brief Pull element with the highest priority and delete it from the queue
+	/// @brief Construct element in place from the arguments and insert it
+	/// @param priority
+	/// @param args Arguments of the element's constructor
+	template<typename... Args>
+	void Emplace(int priority, Args&&... args)
+	{
+		this->Insert(T(std::forward<Args>(args)...), priority);
+	}
+
+	/// @brief Pull element with the highest priority and delete it from the queue.
+	/// Element is moved out of the queue
 	/// @exception std::underflow_error Thrown when there is no elemente
 	/// @return Element's value
 	virtual T Pop() = 0;
@@ -21,13 +45,151 @@ public:
 	/// @return Element's value
 	virtual T Peek() const = 0;
 
+	/// @brief Insert all elements of the range at once
+	/// @tparam InputIt Iterator over Item<T> elements
+	/// @param first
+	/// @param last
+	template<typename InputIt>
+	void InsertRange(InputIt first, InputIt last)
+	{
+		std::vector<Item<T>> items(first, last);
+		insertRange(items);
+	}
+
+	/// @brief Pull up to count elements with the highest priority and delete them from the queue
+	/// @param count Number of elements to pull
+	/// @param out Container to append elements to, in the order they would be popped
+	/// @return Number of pulled elements
+	virtual size_t PopN(size_t count, std::vector<T>& out);
+
+	/// @brief Writes all elements with their priorities in the binary format of QueueFileHeader.
+	/// Elements are converted to bytes by Serializer<T>, the queue stays as it is
+	/// @exception std::runtime_error Thrown when the stream fails
+	void Save(std::ostream& out) const;
+
+	/// @brief Reads the elements written by Save and inserts them at once, with the bulk build of the backend.
+	/// Elements already in the queue stay, equal priorities of the saved ones keep their order after them.
+	/// The whole data is read and every priority is checked before the first insert, so the queue is not changed when it throws
+	/// @exception std::runtime_error Thrown when the data is not a saved queue or is cut
+	/// @exception std::out_of_range Thrown when a saved priority can't be inserted into this queue
+	void Load(std::istream& in);
+
 	virtual ~PriorityQueue();
 
+protected:
+	/// @brief Bulk insertion, backends override it with their bulk build algorithm.
+	/// By default inserts elements one by one
+	/// @param items Elements to insert, may be reordered
+	virtual void insertRange(std::vector<Item<T>>& items);
+
+	/// @brief Calls the function for every element with its priority without changing the queue.
+	/// Elements of equal priority are visited in the order they are popped.
+	/// Concurrent backends visit the consistent state of the queue
+	virtual void forEach(const std::function<void(const T&, int)>& visit) const = 0;
+
+	/// @return Whether forEach visits all elements in the order they are popped
+	virtual bool visitsInPopOrder() const { return false; }
+
+	/// @brief Checks that the priority can be inserted. Queues with limited priorities override it
+	/// @exception std::out_of_range Thrown when the priority can't be inserted
+	virtual void checkPriority(int /*priority*/) const {}
+
 private:
 	virtual bool isEmpty() const = 0;
 };
 
+template<typename T>
+inline size_t PriorityQueue<T>::PopN(size_t count, std::vector<T>& out)
+{
+	size_t popped = 0;
+	for (; popped < count && !this->isEmpty(); popped++)
+		out.push_back(this->Pop());
+	return popped;
+}
+
+template<typename T>
+inline void PriorityQueue<T>::insertRange(std::vector<Item<T>>& items)
+{
+	for (Item<T>& item : items)
+		this->Insert(std::move(item.data), item.priority);
+}
+
+template<typename T>
+inline void PriorityQueue<T>::Save(std::ostream& out) const
+{
+	QueueFileHeader header;
+	if (this->visitsInPopOrder())
+		header.flags |= QueueFileHeader::kPopOrder;
+
+	// One pass over the queue: the count in the header always matches the records,
+	// even if the queue is changed by other threads right after
+	std::string records;
+	this->forEach([&](const T& data, int priority) {
+		QueueRecord::Write(records, data, priority);
+		header.count++;
+	});
+
+	std::string bytes;
+	header.Write(bytes);
+	out.write(bytes.data(), std::streamsize(bytes.size()));
+	out.write(records.data(), std::streamsize(records.size()));
+
+	if (!out)
+		throw std::runtime_error("Failed to save the priority queue");
+}
+
+template<typename T>
+inline void PriorityQueue<T>::Load(std::istream& in)
+{
+	QueueFileHeader header = QueueFileHeader::Read(in);
+
+	// The count isn't trusted for the allocation until the records are read
+	constexpr uint64_t kMaxReserve = 1 << 16;
+	std::vector<Item<T>> items;
+	items.reserve(size_t(std::min(header.count, kMaxReserve)));
+
+	std::string bytes;
+	for (uint64_t i = 0; i < header.count; i++) {
+		QueueRecord record = QueueRecord::Read(in, bytes);
+		items.push_back(Item<T>(record.Element<T>(), record.priority));
+	}
+
+	// Queues that insert one by one would keep a part of the data after the error
+	for (const Item<T>& item : items)
+		this->checkPriority(item.priority);
+	insertRange(items);
+}
+
 template<typename T>
 inline PriorityQueue<T>::~PriorityQueue()
 {
 }
+
+
+#ifdef _DEBUG
+/// @brief Element for unit tests, counts how many times it was copied
+struct CopyCounter
+{
+	static inline int copies = 0;
+
+	int value = 0;
+
+	CopyCounter() {}
+	CopyCounter(int value) : value(value) {}
+
+	CopyCounter(const CopyCounter& other) : value(other.value) { copies++; }
+	CopyCounter(CopyCounter&& other) noexcept : value(other.value) {}
+
+	CopyCounter& operator=(const CopyCounter& other)
+	{
+		value = other.value;
+		copies++;
+		return *this;
+	}
+	CopyCounter& operator=(CopyCounter&& other) noexcept
+	{
+		value = other.value;
+		return *this;
+	}
+};
+#endif // _DEBUG
\ No newline at end of file
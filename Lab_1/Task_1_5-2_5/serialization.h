@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <istream>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+/// @brief Reads the serialised bytes from memory: a record loaded from the stream or mapped from the file
+class ByteReader
+{
+public:
+	ByteReader(const char* data, size_t size)
+		: data(data), end(data + size) {}
+
+	/// @brief Copies the next bytes
+	/// @exception std::runtime_error Thrown when fewer bytes are left
+	void Read(void* out, size_t size)
+	{
+		if (size > Left())
+			throw std::runtime_error("Serialized data is cut");
+		std::memcpy(out, data, size);
+		data += size;
+	}
+
+	/// @brief Reads the number in the byte order of the machine
+	template<typename Number>
+	Number ReadNumber()
+	{
+		Number value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	/// @return Next bytes, the reader moves past them
+	/// @exception std::runtime_error Thrown when fewer bytes are left
+	const char* Take(size_t size)
+	{
+		if (size > Left())
+			throw std::runtime_error("Serialized data is cut");
+		const char* taken = data;
+		data += size;
+		return taken;
+	}
+
+	size_t Left() const
+	{
+		return size_t(end - data);
+	}
+
+private:
+	const char* data;
+	const char* end;
+};
+
+/// @brief Appends the number in the byte order of the machine
+template<typename Number>
+inline void WriteNumber(std::string& out, Number value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// @brief Reads exactly size bytes from the stream.
+/// The records are small, so the bytes are taken from the stream buffer without the sentry of istream::read
+/// @exception std::runtime_error Thrown when the stream ends before
+inline void ReadStream(std::istream& in, char* out, size_t size)
+{
+	if (!in.rdbuf() || in.rdbuf()->sgetn(out, std::streamsize(size)) != std::streamsize(size)) {
+		in.setstate(std::ios::eofbit | std::ios::failbit);
+		throw std::runtime_error("Saved priority queue is cut");
+	}
+}
+
+
+/// @brief Whether T serialises itself with the members
+/// void Serialize(std::string& out) const and static T Deserialize(ByteReader& in)
+template<typename T, typename = void>
+struct HasSerializeMembers : std::false_type {};
+
+template<typename T>
+struct HasSerializeMembers<T, std::void_t<
+	decltype(std::declval<const T&>().Serialize(std::declval<std::string&>())),
+	decltype(T::Deserialize(std::declval<ByteReader&>()))>>
+	: std::is_same<decltype(T::Deserialize(std::declval<ByteReader&>())), T> {};
+
+/// @brief Converts the queue elements to bytes and back:
+/// static void Write(std::string& out, const T& value) appends the bytes,
+/// static T Read(ByteReader& in) takes them back.
+/// Trivially copyable types are copied as they are, std::string is written with its length,
+/// the types with Serialize/Deserialize members use them. Other types specialise the trait
+/// @tparam T
+template<typename T, typename = void>
+struct Serializer
+{
+	static_assert(!std::is_same<T, T>::value,
+		"Specialise Serializer<T> or give T the Serialize and Deserialize members");
+};
+
+template<typename T>
+struct Serializer<T, std::enable_if_t<std::is_trivially_copyable<T>::value &&
+	!std::is_pointer<T>::value && !HasSerializeMembers<T>::value>>
+{
+	static void Write(std::string& out, const T& value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	static T Read(ByteReader& in)
+	{
+		T value;
+		in.Read(&value, sizeof(T));
+		return value;
+	}
+};
+
+template<>
+struct Serializer<std::string>
+{
+	static void Write(std::string& out, const std::string& value)
+	{
+		WriteNumber(out, uint32_t(value.size()));
+		out.append(value);
+	}
+
+	static std::string Read(ByteReader& in)
+	{
+		uint32_t size = in.ReadNumber<uint32_t>();
+		return std::string(in.Take(size), size);
+	}
+};
+
+template<typename T>
+struct Serializer<T, std::enable_if_t<HasSerializeMembers<T>::value>>
+{
+	static void Write(std::string& out, const T& value)
+	{
+		value.Serialize(out);
+	}
+
+	static T Read(ByteReader& in)
+	{
+		return T::Deserialize(in);
+	}
+};
+
+
+/// @brief Header of the saved queue. The file is the header followed by a record per element:
+/// priority int32, element size uint32 and the element bytes written by Serializer<T>.
+/// The numbers are in the byte order of the machine that saved the queue.
+/// With the pop order flag the records go in the order the elements are popped, so the first one is the top.
+/// Otherwise the records of equal priorities still go in their pop order
+struct QueueFileHeader
+{
+	static constexpr char kMagic[4] = { 'P', 'Q', 'S', '1' };
+	static constexpr size_t kSize = 16;
+	static constexpr size_t kRecordHeaderSize = 8;
+
+	static constexpr uint32_t kPopOrder = 1;
+
+	uint32_t flags = 0;
+	uint64_t count = 0;
+
+	bool InPopOrder() const
+	{
+		return (flags & kPopOrder) != 0;
+	}
+
+	void Write(std::string& out) const
+	{
+		out.append(kMagic, sizeof(kMagic));
+		WriteNumber(out, flags);
+		WriteNumber(out, count);
+	}
+
+	/// @exception std::runtime_error Thrown when the bytes are not a saved queue
+	static QueueFileHeader Read(ByteReader& in)
+	{
+		char magic[sizeof(kMagic)];
+		in.Read(magic, sizeof(magic));
+		if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+			throw std::runtime_error("Not a saved priority queue");
+
+		QueueFileHeader header;
+		header.flags = in.ReadNumber<uint32_t>();
+		header.count = in.ReadNumber<uint64_t>();
+		return header;
+	}
+
+	/// @exception std::runtime_error Thrown when the stream is not a saved queue
+	static QueueFileHeader Read(std::istream& in)
+	{
+		char bytes[kSize];
+		ReadStream(in, bytes, sizeof(bytes));
+		ByteReader fields(bytes, sizeof(bytes));
+		return Read(fields);
+	}
+};
+
+/// @brief Saved element with its priority, the element is not deserialised yet
+struct QueueRecord
+{
+	int priority = 0;
+	const char* data = nullptr;
+	size_t size = 0;
+
+	/// @brief Deserialises the element
+	template<typename T>
+	T Element() const
+	{
+		ByteReader in(data, size);
+		return Serializer<T>::Read(in);
+	}
+
+	/// @brief Appends the record of the element
+	template<typename T>
+	static void Write(std::string& out, const T& data, int priority)
+	{
+		WriteNumber(out, int32_t(priority));
+		size_t size_at = out.size();
+		WriteNumber(out, uint32_t(0));
+		Serializer<T>::Write(out, data);
+
+		uint32_t size = uint32_t(out.size() - size_at - sizeof(uint32_t));
+		std::memcpy(&out[size_at], &size, sizeof(size));
+	}
+
+	/// @brief Takes the record from the bytes, the element stays in them
+	static QueueRecord Read(ByteReader& in)
+	{
+		QueueRecord record;
+		record.priority = in.ReadNumber<int32_t>();
+		record.size = in.ReadNumber<uint32_t>();
+		record.data = in.Take(record.size);
+		return record;
+	}
+
+	/// @brief Reads the record from the stream, the element is kept in the bytes
+	/// @exception std::runtime_error Thrown when the stream ends before the record
+	static QueueRecord Read(std::istream& in, std::string& bytes)
+	{
+		char header[QueueFileHeader::kRecordHeaderSize];
+		ReadStream(in, header, sizeof(header));
+		ByteReader fields(header, sizeof(header));
+
+		QueueRecord record;
+		record.priority = fields.ReadNumber<int32_t>();
+		record.size = fields.ReadNumber<uint32_t>();
+
+		// The size isn't trusted for the allocation, the bytes grow by chunks as they are read
+		constexpr size_t kChunk = 1 << 16;
+		bytes.clear();
+		for (size_t read = 0; read < record.size; ) {
+			size_t chunk = std::min(record.size - read, kChunk);
+			bytes.resize(read + chunk);
+			ReadStream(in, &bytes[read], chunk);
+			read += chunk;
+		}
+		record.data = bytes.data();
+		return record;
+	}
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// @brief Snapshot of the tree instrumentation.
+/// Operation counters are collected only when TREE_STATS is defined, otherwise they stay zero
+/// and the trees are compiled without any counting code. Depths are computed on request in O(N)
+struct TreeStats
+{
+	// Element comparisons made by searches, inserts and removals
+	size_t comparisons = 0;
+	// Single rotations, for the 2-3 tree - elements borrowed from a sibling
+	size_t rotations = 0;
+	// Nodes split because of overflow
+	size_t splits = 0;
+	// Nodes merged with a sibling because of underflow
+	size_t merges = 0;
+	// Nodes created by the allocator
+	size_t allocations = 0;
+	// Empty buckets the queues keep in the tree with the lazy deletion
+	size_t tombstones = 0;
+	// Rebuilds of the tree that dropped the tombstones
+	size_t compactions = 0;
+	// Number of levels, 0 for the empty tree
+	size_t max_depth = 0;
+	// Mean depth of the elements, the root level is 1
+	double average_depth = 0;
+};
+
+#ifdef TREE_STATS
+
+/// @brief Node allocator that counts the created nodes and carries the operation counters,
+/// so the node methods that get only the allocator can count too
+/// @tparam Pool Allocator of the tree nodes
+template<typename Pool>
+class StatsPool
+	: public Pool
+{
+public:
+	// Counted in the const searches too
+	mutable TreeStats stats;
+
+	template<typename... Args>
+	auto Create(Args&&... args)
+	{
+		stats.allocations++;
+		return Pool::Create(std::forward<Args>(args)...);
+	}
+};
+
+#define TREE_STATS_COUNT(pool, counter) (++(pool).stats.counter)
+
+#else
+
+// Disabled instrumentation is the allocator itself and no code at all
+template<typename Pool>
+using StatsPool = Pool;
+
+#define TREE_STATS_COUNT(pool, counter) ((void)(pool))
+
+#endif
+
+/// @brief Copies the operation counters of the allocator to the snapshot
+template<typename Pool>
+inline void CollectCounters(const Pool& pool, TreeStats& stats)
+{
+#ifdef TREE_STATS
+	stats = pool.stats;
+#else
+	(void)pool;
+	(void)stats;
+#endif
+}
+
+/// @brief Fills max_depth and average_depth of the binary tree without recursion
+/// @param root Root of the tree with left and right links, may be nullptr
+template<typename Node>
+inline void CollectDepths(const Node* root, TreeStats& stats)
+{
+	size_t nodes = 0, depths = 0;
+	stats.max_depth = 0;
+
+	std::vector<std::pair<const Node*, size_t>> stack;
+	if (root)
+		stack.push_back({ root, 1 });
+	while (!stack.empty()) {
+		const Node* node = stack.back().first;
+		size_t depth = stack.back().second;
+		stack.pop_back();
+
+		nodes++;
+		depths += depth;
+		if (depth > stats.max_depth)
+			stats.max_depth = depth;
+		if (node->left)
+			stack.push_back({ node->left, depth + 1 });
+		if (node->right)
+			stack.push_back({ node->right, depth + 1 });
+	}
+	stats.average_depth = nodes ? double(depths) / double(nodes) : 0;
+}
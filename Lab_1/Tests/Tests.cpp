@@ -0,0 +1,35 @@
+/*
+*
+ *  Tests.cpp
+ *
+ *  Author:  Yaroslav Kishchuk
+ *  Contact: Kshchuk@gmail.com
+ *
+ */
+
+// Unit tests runner. The test cases live in the headers and in Expression.cpp under _DEBUG,
+// this target is built with _DEBUG defined, so it runs them without the interactive menu.
+
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include "doctest.h"
+
+#include "Expression.h"
+#include "ArrayPriorityQueue.hpp"
+#include "LinkedListPriorityQueue.hpp"
+#include "BSTPriorityQueue.hpp"
+#include "AVLPriorityQueue.hpp"
+#include "23TreePriorityQueue.hpp"
+#include "HeapPriorityQueue.hpp"
+#include "PairingHeapPriorityQueue.hpp"
+#include "MultiQueuePriorityQueue.hpp"
+#include "BTreePriorityQueue.hpp"
+#include "RBPriorityQueue.hpp"
+#include "BucketPriorityQueue.hpp"
+#include "RadixHeapPriorityQueue.hpp"
+#include "PersistentAVLPriorityQueue.hpp"
+#include "VEBPriorityQueue.hpp"
+#include "SortedVectorPriorityQueue.hpp"
+#include "TopKPriorityQueue.hpp"
+#include "MappedQueueSnapshot.hpp"